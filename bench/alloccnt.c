@@ -0,0 +1,131 @@
+/**
+ * @file alloccnt.c
+ * @brief Allocation counter for the benchmarks
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "alloccnt.h"
+
+static __thread unsigned long nAllocs = 0;
+static __thread unsigned long nOwnAllocs = 0;
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#include <link.h>
+
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+
+/* code of liblognorm; allocations called from there are its own */
+static uintptr_t lnCodeStart = 0;
+static uintptr_t lnCodeEnd = 0;
+
+/* find the executable segments of liblognorm. If it is linked
+ * statically, it is part of the program, which comes first.
+ */
+static int
+findLiblognorm(struct dl_phdr_info *const info, size_t __attribute__((unused)) size,
+	void *const data)
+{
+	int *const nObjs = (int*) data;
+
+	if((*nObjs)++ > 0 && strstr(info->dlpi_name, "liblognorm") == NULL)
+		return 0;
+	lnCodeStart = UINTPTR_MAX;
+	lnCodeEnd = 0;
+	for(int i = 0 ; i < info->dlpi_phnum ; ++i) {
+		const ElfW(Phdr) *const ph = info->dlpi_phdr + i;
+		if(ph->p_type != PT_LOAD || !(ph->p_flags & PF_X))
+			continue;
+		const uintptr_t start = info->dlpi_addr + ph->p_vaddr;
+		if(start < lnCodeStart)
+			lnCodeStart = start;
+		if(start + ph->p_memsz > lnCodeEnd)
+			lnCodeEnd = start + ph->p_memsz;
+	}
+	return *nObjs > 1;
+}
+
+static void __attribute__((constructor))
+alloccntInit(void)
+{
+	int nObjs = 0;
+	dl_iterate_phdr(findLiblognorm, &nObjs);
+}
+
+static inline void
+countAlloc(const void *const caller)
+{
+	++nAllocs;
+	if((uintptr_t) caller >= lnCodeStart && (uintptr_t) caller < lnCodeEnd)
+		++nOwnAllocs;
+}
+
+void *
+malloc(size_t size)
+{
+	countAlloc(__builtin_return_address(0));
+	return __libc_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+	countAlloc(__builtin_return_address(0));
+	return __libc_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+	countAlloc(__builtin_return_address(0));
+	return __libc_realloc(ptr, size);
+}
+
+int
+alloccntAvailable(void)
+{
+	return 1;
+}
+#else
+int
+alloccntAvailable(void)
+{
+	return 0;
+}
+#endif
+
+unsigned long
+alloccntGet(void)
+{
+	return nAllocs;
+}
+
+unsigned long
+alloccntGetOwn(void)
+{
+	return nOwnAllocs;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file alloccnt.h
+ * @brief Allocation counter for the benchmarks
+ *
+ * Counts calls to malloc(), calloc() and realloc() made by the calling
+ * thread, including those inside liblognorm, json-c and libestr. Calls
+ * made directly by liblognorm code are also counted separately, as
+ * these do not depend on the version of the other libraries. This
+ * works by wrapping these functions and is only supported with glibc
+ * (and not together with AddressSanitizer).
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#ifndef LIBLOGNORM_ALLOCCNT_H_INCLUDED
+#define	LIBLOGNORM_ALLOCCNT_H_INCLUDED
+
+/** @return 1 if allocations are counted on this platform, else 0 */
+int alloccntAvailable(void);
+
+/** @return number of allocations of the calling thread so far */
+unsigned long alloccntGet(void);
+
+/** @return number of allocations the calling thread made directly
+ *          from liblognorm code so far */
+unsigned long alloccntGetOwn(void);
+
+#endif /* #ifndef LIBLOGNORM_ALLOCCNT_H_INCLUDED */
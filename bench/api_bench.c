@@ -0,0 +1,205 @@
+/**
+ * @file api_bench.c
+ * @brief Compares the result APIs of liblognorm.
+ *
+ * Normalizes a set of synthetic syslog-like messages in a loop, once
+ * via ln_normalize() (json events), once via ln_normalizeRecord()
+ * and once via ln_normalizeCB(), and reports the number of messages
+ * processed per second for each.
+ *
+ *//*
+ * liblognorm - a fast samples-based log normalization library
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <json.h>
+
+#include "liblognorm.h"
+
+static const char *const rulebase =
+	"version=2\n"
+	"rule=fw:%date:date-rfc3164% %host:word% kernel: IN=%in:word% OUT=%out:word% "
+		"SRC=%src:ipv4% DST=%dst:ipv4% LEN=%len:number% PROTO=%proto:word% "
+		"SPT=%spt:number% DPT=%dpt:number%\n"
+	"rule=ssh:%date:date-rfc3164% %host:word% sshd[%pid:number%]: Accepted "
+		"%method:word% for %user:word% from %ip:ipv4% port %port:number% %proto:word%\n"
+	"rule=app:%date:date-rfc3164% %host:word% app: user=%user:word% "
+		"duration=%dur:float% status=%status:word% msg=%msg:rest%\n";
+
+static const char *const msgs[] = {
+	"Oct 18 10:00:01 gw01 kernel: IN=eth0 OUT=eth1 SRC=10.0.0.1 DST=192.168.1.20 "
+		"LEN=60 PROTO=TCP SPT=51234 DPT=443",
+	"Oct 18 10:00:02 srv02 sshd[4711]: Accepted publickey for admin from 10.1.2.3 port 50022 ssh2",
+	"Oct 18 10:00:03 app03 app: user=jdoe duration=0.125 status=ok msg=request served from cache",
+	"Oct 18 10:00:04 gw01 kernel: IN=eth1 OUT=eth0 SRC=192.168.1.20 DST=10.0.0.1 "
+		"LEN=1500 PROTO=UDP SPT=53 DPT=40000",
+};
+#define NUM_MSGS (sizeof(msgs) / sizeof(msgs[0]))
+
+static size_t lens[NUM_MSGS];
+
+static double
+timeDiff(const struct timespec *const begin, const struct timespec *const end)
+{
+	return (end->tv_sec - begin->tv_sec) + (end->tv_nsec - begin->tv_nsec) / 1e9;
+}
+
+static void
+report(const char *const api, const long nIter,
+	const struct timespec *const begin, const struct timespec *const end)
+{
+	const double secs = timeDiff(begin, end);
+	printf("%-6s: %ld messages in %.3f s, %.0f msgs/s\n",
+		api, nIter, secs, (secs > 0) ? nIter / secs : 0.0);
+}
+
+static int
+benchJSON(ln_ctx ctx, const long nIter)
+{
+	for(long n = 0 ; n < nIter ; ++n) {
+		const size_t m = n % NUM_MSGS;
+		struct json_object *json = NULL;
+		if(ln_normalize(ctx, msgs[m], lens[m], &json) != 0) {
+			json_object_put(json);
+			return 1;
+		}
+		json_object_put(json);
+	}
+	return 0;
+}
+
+static int
+benchRecord(ln_ctx ctx, const long nIter)
+{
+	int r = 0;
+	ln_record *const rec = ln_newRecord();
+
+	if(rec == NULL)
+		return 1;
+	for(long n = 0 ; n < nIter && r == 0 ; ++n) {
+		const size_t m = n % NUM_MSGS;
+		if(ln_normalizeRecord(ctx, msgs[m], lens[m], rec) != 0 || !ln_recordMatched(rec))
+			r = 1;
+	}
+	ln_deleteRecord(rec);
+	return r;
+}
+
+/* the callbacks do the minimum any consumer must do: look at the data */
+static void
+cbRule(void *const cookie, const char *const rule, const unsigned id)
+{
+	(void) rule;
+	(void) id;
+	++*(long*) cookie;
+}
+
+static void
+cbField(void *const cookie, const char *const name, const int type,
+	const void *const ptr, const size_t len)
+{
+	(void) cookie;
+	(void) name;
+	(void) type;
+	(void) ptr;
+	(void) len;
+}
+
+static int
+benchCB(ln_ctx ctx, const long nIter)
+{
+	const struct ln_callbacks cbs = { .on_rule = cbRule, .on_field = cbField };
+	long matched = 0;
+
+	for(long n = 0 ; n < nIter ; ++n) {
+		const size_t m = n % NUM_MSGS;
+		if(ln_normalizeCB(ctx, msgs[m], lens[m], &cbs, &matched) != 0)
+			return 1;
+	}
+	return (matched == nIter) ? 0 : 1;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int r = 1;
+	int opt;
+	long nIter = 1000000;
+	struct timespec begin, end;
+	ln_ctx ctx;
+
+	while((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			nIter = atol(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: api_bench [-n messages]\n");
+			return 1;
+		}
+	}
+
+	if((ctx = ln_initCtx()) == NULL) {
+		fprintf(stderr, "Could not initialize liblognorm context\n");
+		return 1;
+	}
+	if(ln_loadSamplesFromString(ctx, rulebase) != 0) {
+		fprintf(stderr, "Could not load rulebase\n");
+		goto done;
+	}
+
+	for(size_t m = 0 ; m < NUM_MSGS ; ++m)
+		lens[m] = strlen(msgs[m]);
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	if(benchJSON(ctx, nIter) != 0) {
+		fprintf(stderr, "json: message did not parse\n");
+		goto done;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	report("json", nIter, &begin, &end);
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	if(benchRecord(ctx, nIter) != 0) {
+		fprintf(stderr, "record: message did not match\n");
+		goto done;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	report("record", nIter, &begin, &end);
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	if(benchCB(ctx, nIter) != 0) {
+		fprintf(stderr, "cb: message did not match\n");
+		goto done;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	report("cb", nIter, &begin, &end);
+
+	r = 0;
+done:
+	ln_exitCtx(ctx);
+	return r;
+}
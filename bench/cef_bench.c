@@ -0,0 +1,124 @@
+/**
+ * @file cef_bench.c
+ * @brief Throughput benchmark for the CEF parser.
+ *
+ * Normalizes a set of synthetic ArcSight CEF messages in a loop
+ * and reports the number of messages processed per second.
+ *
+ *//*
+ * liblognorm - a fast samples-based log normalization library
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <json.h>
+
+#include "liblognorm.h"
+
+static const char *const rulebase =
+	"version=2\n"
+	"rule=:%f:cef%\n";
+
+/* a mix of messages as seen in practice: short ones, long ones
+ * with many extensions and some with escape sequences in both
+ * the header and the extensions.
+ */
+static const char *const msgs[] = {
+	"CEF:0|Vendor|Product|1.0|100|worm successfully stopped|10| src=10.0.0.1 dst=2.1.2.2 spt=1232",
+	"CEF:0|Security|threatmanager|1.0|100|detected a \\| in message|10|src=10.0.0.1 act=blocked a \\= dst=1.1.1.1",
+	"CEF:0|ArcSight|ArcSight|7.0.0.0|agent:030|Agent [test] type [testalertng] started|Low| "
+		"eventId=1 mrt=1478123405013 categorySignificance=/Normal categoryBehavior=/Execute/Start "
+		"categoryDeviceGroup=/Application catdt=Security Mangement categoryOutcome=/Success "
+		"categoryObject=/Host/Application/Service art=1478123405020 cat=/Agent/Started "
+		"deviceSeverity=Warning rt=1478123404978 fileType=Agent cs2=<Resource ID\\=\"3DxKlG1gBABCAAgAAAAAAAA\\=\\=\"/> "
+		"c6a4=fe80:0:0:0:495d:cc3c:db1a:de71 cs2Label=Configuration Resource c6a4Label=Agent IPv6 Address "
+		"ahost=host.example.com agt=192.168.0.10 agentZoneURI=/All Zones/ArcSight System/Private Address Space Zones/RFC1918: 192.168.0.0-192.168.255.255 "
+		"av=7.3.0.7885.0 atz=Europe/Berlin aid=3DxKlG1gBABCAAgAAAAAAAA\\=\\= at=testalertng dvchost=host.example.com "
+		"dvc=192.168.0.10 deviceZoneURI=/All Zones/ArcSight System/Private Address Space Zones/RFC1918: 192.168.0.0-192.168.255.255 "
+		"dtz=Europe/Berlin _cefVer=0.1",
+	"CEF:0|Vendor\\\\Name|Product|Version|Signature ID|some name|Severity| name=line1\\nline2 other=path\\\\to\\\\file",
+};
+#define NUM_MSGS (sizeof(msgs) / sizeof(msgs[0]))
+
+static double
+timeDiff(const struct timespec *const begin, const struct timespec *const end)
+{
+	return (end->tv_sec - begin->tv_sec) + (end->tv_nsec - begin->tv_nsec) / 1e9;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int r = 1;
+	int opt;
+	long nIter = 1000000;
+	size_t lens[NUM_MSGS];
+	struct timespec begin, end;
+	ln_ctx ctx;
+
+	while((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			nIter = atol(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: cef_bench [-n messages]\n");
+			return 1;
+		}
+	}
+
+	if((ctx = ln_initCtx()) == NULL) {
+		fprintf(stderr, "Could not initialize liblognorm context\n");
+		return 1;
+	}
+	if(ln_loadSamplesFromString(ctx, rulebase) != 0) {
+		fprintf(stderr, "Could not load rulebase\n");
+		goto done;
+	}
+
+	for(size_t m = 0 ; m < NUM_MSGS ; ++m)
+		lens[m] = strlen(msgs[m]);
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for(long n = 0 ; n < nIter ; ++n) {
+		const size_t m = n % NUM_MSGS;
+		struct json_object *json = NULL;
+		if(ln_normalize(ctx, msgs[m], lens[m], &json) != 0) {
+			fprintf(stderr, "message did not parse: %s\n", msgs[m]);
+			json_object_put(json);
+			goto done;
+		}
+		json_object_put(json);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	const double secs = timeDiff(&begin, &end);
+	printf("cef: %ld messages in %.3f s, %.0f msgs/s\n",
+		nIter, secs, (secs > 0) ? nIter / secs : 0.0);
+	r = 0;
+done:
+	ln_exitCtx(ctx);
+	return r;
+}
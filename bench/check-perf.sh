@@ -0,0 +1,117 @@
+#!/bin/sh
+# Performance regression gate, run by "make check-perf".
+# Normalizes the fixed corpora in the perf directory and compares
+# instructions, allocations and parser calls per message against the
+# checked-in baseline. Fails if a metric got worse by more than the
+# tolerance (in percent). Metrics that can not be measured on this
+# system (e.g. no hardware counters) are skipped.
+# Allocations are counted in total and made directly by liblognorm.
+# The total and instructions include libfastjson, so the baseline
+# records its version (from the environment variable JSON_C_VERSION,
+# set by the Makefile). Both metrics are only compared if it matches.
+#
+# usage: check-perf.sh <perf dir> [tolerance]
+#        check-perf.sh -u <perf dir>	(write new baseline)
+#
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+scenarios="fw-kv cef syslog json"
+update=no
+if [ "x$1" = "x-u" ]; then
+	update=yes
+	shift
+fi
+perfdir=$1
+tolerance=${2:-10}
+baseline=$perfdir/baseline.txt
+results=perf-results.txt
+
+: > $results
+for s in $scenarios; do
+	if ! ./perf_check -r $perfdir/$s.rulebase -i $perfdir/$s.log > perf-out.txt; then
+		echo "perf_check failed for scenario $s"
+		exit 1
+	fi
+	grep -v '^messages ' perf-out.txt | sed -e "s/^/$s /" >> $results
+done
+rm -f perf-out.txt
+
+if [ $update = yes ]; then
+	{
+		echo "# baseline for \"make check-perf\": <scenario> <metric> <value>"
+		echo "# written by \"make update-perf-baseline\" on $(uname -sm)"
+		echo "# libfastjson ${JSON_C_VERSION:-unknown}"
+		echo "# instructions/msg depends on CPU, compiler and libfastjson"
+		echo "# version and is only present if hardware counters were available"
+		echo "# allocs/msg includes libfastjson, ln-allocs/msg only counts allocations"
+		echo "# made directly by liblognorm"
+		grep -v ' n/a$' $results
+	} > $baseline
+	echo "new baseline written to $baseline:"
+	cat $baseline
+	exit 0
+fi
+
+baseVersion=$(sed -n 's/^# libfastjson //p' $baseline)
+sameVersion=1
+if [ "x$baseVersion" != "x${JSON_C_VERSION:-unknown}" ]; then
+	echo "note: baseline was written with libfastjson $baseVersion, this is" \
+		"${JSON_C_VERSION:-unknown}; allocs/msg and instructions/msg are not compared"
+	sameVersion=0
+fi
+
+awk -v tol="$tolerance" -v sameVersion=$sameVersion '
+FNR == NR {
+	if($0 ~ /^#/ || NF < 3)
+		next;
+	base[$1 " " $2] = $3;
+	next;
+}
+{
+	key = $1 " " $2;
+	if(!(key in base)) {
+		printf("%-8s %-18s %12s %12s %8s  no baseline\n", $1, $2, "-", $3, "-");
+		next;
+	}
+	seen[key] = 1;
+	if($3 == "n/a") {
+		printf("%-8s %-18s %12s %12s %8s  skipped (not available)\n",
+			$1, $2, base[key], "n/a", "-");
+		next;
+	}
+	if(!sameVersion && ($2 == "allocs/msg" || $2 == "instructions/msg")) {
+		printf("%-8s %-18s %12s %12s %8s  skipped (other libfastjson)\n",
+			$1, $2, base[key], $3, "-");
+		next;
+	}
+	b = base[key] + 0;
+	c = $3 + 0;
+	chg = (b > 0) ? (c - b) * 100 / b : ((c > 0) ? 100 : 0);
+	status = "";
+	if(chg > tol) {
+		status = "  REGRESSION";
+		++nRegress;
+	} else if(chg < -tol) {
+		status = "  improved";
+		++nImproved;
+	}
+	printf("%-8s %-18s %12s %12s %+7.1f%%%s\n", $1, $2, base[key], $3, chg, status);
+}
+BEGIN {
+	printf("%-8s %-18s %12s %12s %8s\n", "scenario", "metric", "baseline", "current", "change");
+}
+END {
+	for(key in base)
+		if(!(key in seen))
+			printf("%s: in baseline, but not measured\n", key);
+	if(nImproved > 0)
+		printf("\n%d metric(s) improved by more than %s%%, consider running "\
+			"\"make update-perf-baseline\"\n", nImproved, tol);
+	if(nRegress > 0) {
+		printf("\nFAIL: %d metric(s) regressed by more than %s%%. If this is intended, "\
+			"run \"make update-perf-baseline\" and commit bench/perf/baseline.txt\n",
+			nRegress, tol);
+		exit 1;
+	}
+	printf("\nPASS: no regression beyond %s%%\n", tol);
+}' $baseline $results
@@ -0,0 +1,794 @@
+/**
+ * @file corpus_bench.c
+ * @brief End-to-end benchmark of ln_normalize() on synthetic corpora.
+ *
+ * A rulebase is loaded, either from a file or generated with a given
+ * number of rules. Then a corpus of messages is synthesized from it:
+ * matching messages by randomly walking the parse DAG from the root to
+ * a terminal node and instantiating each parser with a random valid
+ * value, non-matching ones by mutating matching messages. Every
+ * message is checked against the rulebase, so the corpus has exactly
+ * the requested mix. All randomness comes from a seeded generator, so
+ * the same seed gives the same rulebase and corpus on every platform.
+ *
+ * The corpus is then normalized with 1 up to N threads sharing the
+ * context. Messages/s, ns/message percentiles, allocations/message
+ * (glibc only) and the peak RSS are reported for each thread count.
+ * Optionally, hardware performance counters are read in a second pass
+ * over the same messages, without the per-message timing, and reported
+ * per message.
+ *
+ *//*
+ * liblognorm - a fast samples-based log normalization library
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <json.h>
+
+#include "liblognorm.h"
+#include "lognorm.h"
+#include "pdag.h"
+#include "parser.h"
+#include "internal.h"
+#include "alloccnt.h"
+#include "perfcnt.h"
+
+#define MAX_MSG_LEN	(64 * 1024)
+#define MAX_PATH_LEN	1024	/* parsers on one path through the pdag */
+#define MAX_NESTING	16	/* nested custom types and repeats */
+#define GEN_TRIES	20	/* attempts to create one message */
+
+/* xorshift64*, so that results do not depend on the libc */
+static uint64_t rndState;
+
+static uint64_t
+rnd(void)
+{
+	rndState ^= rndState >> 12;
+	rndState ^= rndState << 25;
+	rndState ^= rndState >> 27;
+	return rndState * 2685821657736338717ULL;
+}
+
+static unsigned
+rndRange(const unsigned lower, const unsigned upper)
+{
+	return lower + (unsigned) (rnd() % (upper - lower + 1));
+}
+
+/* message under construction */
+struct gen {
+	ln_ctx ctx;
+	char buf[MAX_MSG_LEN];
+	size_t len;
+	int overflow;
+};
+
+static void
+genAppend(struct gen *const g, const char *const str, const size_t len)
+{
+	if(g->len + len >= sizeof(g->buf)) {
+		g->overflow = 1;
+		return;
+	}
+	memcpy(g->buf + g->len, str, len);
+	g->len += len;
+}
+
+static void __attribute__((format(printf, 2, 3)))
+genPrintf(struct gen *const g, const char *const fmt, ...)
+{
+	char buf[256];
+	va_list ap;
+
+	va_start(ap, fmt);
+	const int len = vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	genAppend(g, buf, (len < (int) sizeof(buf)) ? (size_t) len : sizeof(buf) - 1);
+}
+
+/* random token of the given characters, none of them in avoid */
+static void
+genToken(struct gen *const g, const char *const chars, const unsigned minLen,
+	const unsigned maxLen, const char *const avoid)
+{
+	const size_t nChars = strlen(chars);
+	const unsigned len = rndRange(minLen, maxLen);
+
+	for(unsigned i = 0 ; i < len ; ) {
+		const char c = chars[rnd() % nChars];
+		if(avoid != NULL && strchr(avoid, c) != NULL)
+			continue;
+		genAppend(g, &c, 1);
+		++i;
+	}
+}
+
+static const char wordChars[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+static const char alphaChars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static const char *const months[] = {
+	"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+/* value of a string parameter from the parser's config, NULL if not set */
+static const char *
+confParam(const ln_parser_t *const prs, const char *const name, char *const buf, const size_t lenBuf)
+{
+	const char *r = NULL;
+	struct json_object *conf;
+	struct json_object *val;
+
+	if(prs->conf == NULL || (conf = json_tokener_parse(prs->conf)) == NULL)
+		return NULL;
+	if(json_object_object_get_ex(conf, name, &val)) {
+		snprintf(buf, lenBuf, "%s", json_object_get_string(val));
+		r = buf;
+	}
+	json_object_put(conf);
+	return r;
+}
+
+static void
+genIPv4(struct gen *const g)
+{
+	genPrintf(g, "%u.%u.%u.%u", rndRange(1, 223), rndRange(0, 255), rndRange(0, 255),
+		rndRange(1, 254));
+}
+
+static void
+genKeyValues(struct gen *const g, const char *const ass, const char *const sep,
+	const char *const term, const unsigned maxPairs)
+{
+	const unsigned n = rndRange(1, maxPairs);
+
+	for(unsigned i = 0 ; i < n ; ++i) {
+		if(i > 0)
+			genAppend(g, sep, strlen(sep));
+		genToken(g, alphaChars, 1, 8, NULL);
+		genAppend(g, ass, strlen(ass));
+		genToken(g, wordChars, 1, 12, NULL);
+		genAppend(g, term, strlen(term));
+	}
+}
+
+static void
+genJSON(struct gen *const g)
+{
+	const unsigned n = rndRange(1, 5);
+
+	genAppend(g, "{", 1);
+	for(unsigned i = 0 ; i < n ; ++i) {
+		genPrintf(g, "%s\"k%u\":", (i > 0) ? "," : "", i);
+		if(rnd() % 2) {
+			genPrintf(g, "%u", rndRange(0, 100000));
+		} else {
+			genAppend(g, "\"", 1);
+			genToken(g, wordChars, 1, 16, NULL);
+			genAppend(g, "\"", 1);
+		}
+	}
+	genAppend(g, "}", 1);
+}
+
+/* generators for the field parsers, by parser name */
+static void
+genValue(struct gen *const g, const ln_parser_t *const prs)
+{
+	const char *const type = ln_parserIDName(prs->prsid);
+	char param[256];
+	const char *extra;
+
+	if(!strcmp(type, "date-rfc3164")) {
+		genPrintf(g, "%s %2u %02u:%02u:%02u", months[rnd() % 12], rndRange(1, 28),
+			rndRange(0, 23), rndRange(0, 59), rndRange(0, 59));
+	} else if(!strcmp(type, "date-rfc5424")) {
+		genPrintf(g, "%04u-%02u-%02uT%02u:%02u:%02u.%06u%s", rndRange(2000, 2030),
+			rndRange(1, 12), rndRange(1, 28), rndRange(0, 23), rndRange(0, 59),
+			rndRange(0, 59), rndRange(0, 999999), (rnd() % 2) ? "Z" : "+02:00");
+	} else if(!strcmp(type, "number")) {
+		genPrintf(g, "%u", rndRange(0, 1000000));
+	} else if(!strcmp(type, "float")) {
+		genPrintf(g, "%s%u.%u", (rnd() % 4) ? "" : "-", rndRange(0, 100000), rndRange(0, 9999));
+	} else if(!strcmp(type, "hexnumber")) {
+		genPrintf(g, "0x%x", rndRange(0, 0xffffff));
+	} else if(!strcmp(type, "kernel-timestamp")) {
+		genPrintf(g, "[%05u.%06u]", rndRange(0, 99999), rndRange(0, 999999));
+	} else if(!strcmp(type, "whitespace")) {
+		genToken(g, " ", 1, 3, NULL);
+	} else if(!strcmp(type, "ipv4")) {
+		genIPv4(g);
+	} else if(!strcmp(type, "ipv6")) {
+		for(int i = 0 ; i < 8 ; ++i)
+			genPrintf(g, "%s%x", (i > 0) ? ":" : "", rndRange(0, 0xffff));
+	} else if(!strcmp(type, "word") || !strcmp(type, "string")) {
+		genToken(g, wordChars, 1, 16, NULL);
+	} else if(!strcmp(type, "alpha")) {
+		genToken(g, alphaChars, 1, 16, NULL);
+	} else if(!strcmp(type, "rest")) {
+		const unsigned n = rndRange(1, 8);
+		for(unsigned i = 0 ; i < n ; ++i) {
+			if(i > 0)
+				genAppend(g, " ", 1);
+			genToken(g, wordChars, 1, 10, NULL);
+		}
+	} else if(!strcmp(type, "op-quoted-string") || !strcmp(type, "quoted-string")) {
+		genAppend(g, "\"", 1);
+		genToken(g, wordChars, 1, 24, NULL);
+		genAppend(g, "\"", 1);
+	} else if(!strcmp(type, "date-iso")) {
+		genPrintf(g, "%04u-%02u-%02u", rndRange(2000, 2030), rndRange(1, 12), rndRange(1, 28));
+	} else if(!strcmp(type, "time-24hr")) {
+		genPrintf(g, "%02u:%02u:%02u", rndRange(0, 23), rndRange(0, 59), rndRange(0, 59));
+	} else if(!strcmp(type, "time-12hr")) {
+		genPrintf(g, "%02u:%02u:%02u", rndRange(1, 12), rndRange(0, 59), rndRange(0, 59));
+	} else if(!strcmp(type, "duration")) {
+		genPrintf(g, "%u:%02u:%02u", rndRange(0, 99), rndRange(0, 59), rndRange(0, 59));
+	} else if(!strcmp(type, "cisco-interface-spec")) {
+		genToken(g, alphaChars, 3, 10, NULL);
+		genAppend(g, ":", 1);
+		genIPv4(g);
+		genPrintf(g, "/%u", rndRange(1, 65535));
+	} else if(!strcmp(type, "name-value-list")) {
+		genKeyValues(g, "=", " ", "", 6);
+	} else if(!strcmp(type, "json")) {
+		genJSON(g);
+	} else if(!strcmp(type, "cee-syslog")) {
+		genAppend(g, "@cee:", 5);
+		genJSON(g);
+	} else if(!strcmp(type, "mac48")) {
+		for(int i = 0 ; i < 6 ; ++i)
+			genPrintf(g, "%s%02x", (i > 0) ? ":" : "", rndRange(0, 255));
+	} else if(!strcmp(type, "cef")) {
+		genPrintf(g, "CEF:0|Vendor|Product|1.%u|%u|", rndRange(0, 9), rndRange(100, 999));
+		genToken(g, wordChars, 4, 20, NULL);
+		genPrintf(g, "|%u|", rndRange(0, 10));
+		genKeyValues(g, "=", " ", "", 10);
+	} else if(!strcmp(type, "checkpoint-lea")) {
+		genKeyValues(g, ": ", " ", ";", 8);
+	} else if(!strcmp(type, "v2-iptables")) {
+		genPrintf(g, "IN=eth%u OUT=eth%u SRC=", rndRange(0, 3), rndRange(0, 3));
+		genIPv4(g);
+		genAppend(g, " DST=", 5);
+		genIPv4(g);
+		genPrintf(g, " LEN=%u PROTO=%s SPT=%u DPT=%u", rndRange(40, 1500),
+			(rnd() % 2) ? "TCP" : "UDP", rndRange(1, 65535), rndRange(1, 65535));
+	} else if(!strcmp(type, "string-to")) {
+		extra = confParam(prs, "extradata", param, sizeof(param));
+		genToken(g, wordChars, 1, 16, extra);
+	} else if(!strcmp(type, "char-to") || !strcmp(type, "char-sep")) {
+		extra = confParam(prs, "extradata", param, sizeof(param));
+		genToken(g, wordChars, (type[5] == 't') ? 1 : 0, 16, extra);
+	} else {
+		/* unknown parser: a word is at least a plausible guess */
+		genToken(g, wordChars, 1, 16, NULL);
+	}
+}
+
+static int walkNode(struct gen *const g, const ln_pdag *const dag, const int depth,
+	const int nesting);
+
+/* adds text matching the parser (and thus all of its sub-pdags) */
+static int
+walkParser(struct gen *const g, const ln_parser_t *const prs, const int nesting)
+{
+	if(prs->prsid == PRS_LITERAL) {
+		const char *const lit = ln_DataForDisplayLiteral(g->ctx, prs->parser_data);
+		genAppend(g, lit, strlen(lit));
+	} else if(prs->prsid == PRS_CUSTOM_TYPE) {
+		if(nesting >= MAX_NESTING)
+			return -1;
+		return walkNode(g, g->ctx->type_pdags[prs->custTypeIdx].pdag, 0, nesting + 1);
+	} else if(prs->prsid == PRS_REPEAT) {
+		const struct data_Repeat *const data = (const struct data_Repeat*) prs->parser_data;
+		const unsigned n = rndRange(1, 4);
+		if(nesting >= MAX_NESTING)
+			return -1;
+		for(unsigned i = 0 ; i < n ; ++i) {
+			if(i > 0 && walkNode(g, data->while_cond, 0, nesting + 1) != 0)
+				return -1;
+			if(walkNode(g, data->parser, 0, nesting + 1) != 0)
+				return -1;
+		}
+	} else {
+		genValue(g, prs);
+	}
+	return g->overflow ? -1 : 0;
+}
+
+/* random path from this node to a terminal node */
+static int
+walkNode(struct gen *const g, const ln_pdag *const dag, const int depth, const int nesting)
+{
+	const unsigned nChoices = dag->nparsers + (dag->flags.isTerminal ? 1 : 0);
+	unsigned choice;
+
+	if(nChoices == 0 || depth >= MAX_PATH_LEN)
+		return -1;
+	choice = rnd() % nChoices;
+	if(choice == dag->nparsers)
+		return 0;	/* end here */
+	if(walkParser(g, dag->parsers + choice, nesting) != 0)
+		return -1;
+	return walkNode(g, dag->parsers[choice].node, depth + 1, nesting);
+}
+
+/* changes a matching message so that (hopefully) no rule matches */
+static void
+mutate(struct gen *const g)
+{
+	const size_t pos = (g->len == 0) ? 0 : rnd() % g->len;
+
+	switch(rnd() % 3) {
+	case 0:	/* change a character */
+		if(g->len > 0) {
+			g->buf[pos] = "#~|^`"[rnd() % 5];
+			break;
+		}
+		/* fallthrough */
+	case 1:	/* insert a character */
+		if(g->len + 1 < sizeof(g->buf)) {
+			memmove(g->buf + pos + 1, g->buf + pos, g->len - pos);
+			g->buf[pos] = "#~|^`"[rnd() % 5];
+			++g->len;
+		}
+		break;
+	default: /* truncate */
+		g->len = pos;
+		break;
+	}
+}
+
+static int
+matches(ln_ctx ctx, const char *const msg, const size_t len)
+{
+	struct json_object *json = NULL;
+	struct json_object *unparsed;
+	int r = 0;
+
+	if(ln_normalize(ctx, msg, len, &json) == 0 && json != NULL)
+		r = !json_object_object_get_ex(json, "unparsed-data", &unparsed);
+	json_object_put(json);
+	return r;
+}
+
+struct corpus {
+	char **msgs;
+	size_t *lens;
+	size_t nMsgs;
+	size_t nMatch;
+	size_t nDiscarded;	/* generated messages that did not match as intended */
+};
+
+static int
+genCorpus(ln_ctx ctx, struct corpus *const corpus, const size_t nMsgs, const unsigned pctMiss)
+{
+	struct gen *g;
+
+	if((g = calloc(1, sizeof(struct gen))) == NULL
+	   || (corpus->msgs = calloc(nMsgs, sizeof(char*))) == NULL
+	   || (corpus->lens = calloc(nMsgs, sizeof(size_t))) == NULL) {
+		free(g);
+		return -1;
+	}
+	g->ctx = ctx;
+	for(size_t n = 0 ; n < nMsgs ; ++n) {
+		const int wantMatch = rndRange(1, 100) > pctMiss;
+		int ok = 0;
+		for(int tries = 0 ; !ok && tries < GEN_TRIES ; ++tries) {
+			g->len = 0;
+			g->overflow = 0;
+			if(walkNode(g, ctx->pdag, 0, 0) != 0 || !matches(ctx, g->buf, g->len)) {
+				++corpus->nDiscarded;
+				continue;
+			}
+			if(!wantMatch) {
+				mutate(g);
+				if(matches(ctx, g->buf, g->len)) {
+					++corpus->nDiscarded;
+					continue;
+				}
+			}
+			ok = 1;
+		}
+		if(!ok)
+			continue;
+		if((corpus->msgs[corpus->nMsgs] = malloc(g->len + 1)) == NULL) {
+			free(g);
+			return -1;
+		}
+		memcpy(corpus->msgs[corpus->nMsgs], g->buf, g->len);
+		corpus->msgs[corpus->nMsgs][g->len] = '\0';
+		corpus->lens[corpus->nMsgs++] = g->len;
+		if(wantMatch)
+			++corpus->nMatch;
+	}
+	free(g);
+	return 0;
+}
+
+/* Rulebase with nRules rules of typical syslog shape: a header, a
+ * distinct literal "program" part and a sequence of fields.
+ */
+static char *
+genRulebase(const unsigned nRules)
+{
+	static const char *const fields[] = {
+		"%%f%u:word%%", "%%f%u:number%%", "%%f%u:ipv4%%", "%%f%u:quoted-string%%",
+		"%%f%u:float%%", "%%f%u:mac48%%", "%%f%u:char-to:,%%", "%%f%u:date-iso%%",
+		"%%f%u:time-24hr%%", "%%f%u:hexnumber%%"
+	};
+	static const char *const seps[] = { " ", " key=", ", ", " [", "] " };
+	const size_t nFields = sizeof(fields) / sizeof(fields[0]);
+	const size_t lenRb = 64 + (size_t) nRules * 512;
+	char *rb;
+	size_t len;
+
+	if((rb = malloc(lenRb)) == NULL)
+		return NULL;
+	len = snprintf(rb, lenRb, "version=2\n");
+	for(unsigned i = 0 ; i < nRules ; ++i) {
+		const unsigned n = rndRange(1, 8);
+		len += snprintf(rb + len, lenRb - len,
+			"rule=gen:%%date:date-rfc3164%% %%host:word%% prog%u[%%pid:number%%]: ", i);
+		for(unsigned j = 0 ; j < rndRange(1, 3) ; ++j)
+			len += snprintf(rb + len, lenRb - len, "%s%s", (j > 0) ? " " : "",
+				months[rnd() % 12]);
+		for(unsigned j = 0 ; j < n ; ++j) {
+			const char *const sep = (j == 0) ? " " : seps[rnd() % (sizeof(seps) / sizeof(seps[0]))];
+			/* char-to must be followed by its terminator */
+			const size_t f = rnd() % nFields;
+			len += snprintf(rb + len, lenRb - len, "%s", sep);
+			len += snprintf(rb + len, lenRb - len, fields[f], j);
+			if(f == 6)
+				len += snprintf(rb + len, lenRb - len, ",");
+		}
+		if(rnd() % 4 == 0)
+			len += snprintf(rb + len, lenRb - len, " %%msg:rest%%");
+		len += snprintf(rb + len, lenRb - len, "\n");
+	}
+	return rb;
+}
+
+/* Rulebase files are loaded as version 2, so that the pdag can be
+ * walked (version 1 rulebases are processed by the v1 engine).
+ */
+static int
+loadRulebase(ln_ctx ctx, const char *const file, const unsigned nGenRules)
+{
+	int r = -1;
+	char *rb = NULL;
+	FILE *fp = NULL;
+	long len;
+
+	if(file == NULL) {
+		if((rb = genRulebase(nGenRules)) == NULL)
+			goto done;
+	} else {
+		if((fp = fopen(file, "r")) == NULL) {
+			perror(file);
+			goto done;
+		}
+		if(fseek(fp, 0, SEEK_END) != 0 || (len = ftell(fp)) < 0
+		   || fseek(fp, 0, SEEK_SET) != 0
+		   || (rb = malloc(len + sizeof("version=2\n"))) == NULL)
+			goto done;
+		strcpy(rb, "version=2\n");
+		if(fread(rb + 10, 1, len, fp) != (size_t) len)
+			goto done;
+		rb[10 + len] = '\0';
+		if(!strncmp(rb + 10, "version=2", 9))	/* already version 2 */
+			memmove(rb, rb + 10, len + 1);
+	}
+	r = ln_loadSamplesFromString(ctx, rb);
+done:
+	if(fp != NULL)
+		fclose(fp);
+	free(rb);
+	return r;
+}
+
+struct worker {
+	pthread_t tid;
+	ln_ctx ctx;
+	const struct corpus *corpus;
+	size_t first;
+	long nMsgs;
+	uint64_t *lat;		/* ns per message */
+	unsigned long allocs;
+	double counters[PERFCNT_NUM];	/* -1: not available */
+	int perfErr;
+	int err;
+};
+
+static int usePerfCounters = 0;
+
+static uint64_t
+nsNow(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *
+runWorker(void *const arg)
+{
+	struct worker *const w = (struct worker*) arg;
+	const struct corpus *const corpus = w->corpus;
+	size_t m = w->first;
+	const unsigned long allocs = alloccntGet();
+
+	for(long n = 0 ; n < w->nMsgs ; ++n) {
+		struct json_object *json = NULL;
+		const uint64_t begin = nsNow();
+		if(ln_normalize(w->ctx, corpus->msgs[m], corpus->lens[m], &json) != 0)
+			w->err = 1;
+		json_object_put(json);
+		w->lat[n] = nsNow() - begin;
+		if(++m == corpus->nMsgs)
+			m = 0;
+	}
+	w->allocs = alloccntGet() - allocs;
+
+	if(usePerfCounters) {
+		struct perfcnt pc;
+		perfcntOpen(&pc);
+		w->perfErr = pc.err;
+		m = w->first;
+		perfcntStart(&pc);
+		for(long n = 0 ; n < w->nMsgs ; ++n) {
+			struct json_object *json = NULL;
+			ln_normalize(w->ctx, corpus->msgs[m], corpus->lens[m], &json);
+			json_object_put(json);
+			if(++m == corpus->nMsgs)
+				m = 0;
+		}
+		perfcntStop(&pc, w->counters);
+		perfcntClose(&pc);
+	}
+	return NULL;
+}
+
+static int
+cmpU64(const void *const a, const void *const b)
+{
+	const uint64_t va = *(const uint64_t*) a;
+	const uint64_t vb = *(const uint64_t*) b;
+	return (va > vb) - (va < vb);
+}
+
+static uint64_t
+percentile(const uint64_t *const lat, const size_t n, const double pct)
+{
+	size_t idx = (size_t) (pct / 100.0 * n);
+	return lat[(idx >= n) ? n - 1 : idx];
+}
+
+static void
+printCounters(const struct worker *const workers, const int nThreads, const long nMsgs)
+{
+	static int errReported = 0;
+	double sum[PERFCNT_NUM];
+
+	for(int c = 0 ; c < PERFCNT_NUM ; ++c) {
+		sum[c] = 0;
+		for(int i = 0 ; i < nThreads && sum[c] >= 0 ; ++i)
+			sum[c] = (workers[i].counters[c] < 0) ? -1 : sum[c] + workers[i].counters[c];
+	}
+	printf("%7s", "");
+	for(int c = 0 ; c < PERFCNT_NUM ; ++c) {
+		if(sum[c] < 0)
+			printf(" %s/msg: n/a", perfcntName(c));
+		else
+			printf(" %s/msg: %.1f", perfcntName(c), sum[c] / ((double) nThreads * nMsgs));
+	}
+	if(sum[PERFCNT_CYCLES] > 0 && sum[PERFCNT_INSTRUCTIONS] >= 0)
+		printf(" IPC: %.2f", sum[PERFCNT_INSTRUCTIONS] / sum[PERFCNT_CYCLES]);
+	printf("\n");
+	if(workers[0].perfErr != 0 && !errReported) {
+		printf("%7s (some counters not available: %s; check "
+			"/proc/sys/kernel/perf_event_paranoid or run on bare metal)\n",
+			"", strerror(workers[0].perfErr));
+		errReported = 1;
+	}
+}
+
+static int
+benchThreads(ln_ctx ctx, const struct corpus *const corpus, const int nThreads, const long nMsgs)
+{
+	int r = 1;
+	struct worker *workers;
+	uint64_t *lat = NULL;
+	unsigned long allocs = 0;
+	struct rusage ru;
+
+	if((workers = calloc(nThreads, sizeof(struct worker))) == NULL
+	   || (lat = malloc(nThreads * nMsgs * sizeof(uint64_t))) == NULL)
+		goto done;
+	const uint64_t begin = nsNow();
+	for(int i = 0 ; i < nThreads ; ++i) {
+		workers[i].ctx = ctx;
+		workers[i].corpus = corpus;
+		workers[i].first = i * corpus->nMsgs / nThreads;
+		workers[i].nMsgs = nMsgs;
+		workers[i].lat = lat + i * nMsgs;
+		if(pthread_create(&workers[i].tid, NULL, runWorker, workers + i) != 0) {
+			fprintf(stderr, "could not create thread\n");
+			exit(1);
+		}
+	}
+	for(int i = 0 ; i < nThreads ; ++i) {
+		pthread_join(workers[i].tid, NULL);
+		if(workers[i].err) {
+			fprintf(stderr, "ln_normalize() failed\n");
+			goto done;
+		}
+		allocs += workers[i].allocs;
+	}
+	const double secs = (nsNow() - begin) / 1e9;
+	const size_t total = nThreads * nMsgs;
+	qsort(lat, total, sizeof(uint64_t), cmpU64);
+	getrusage(RUSAGE_SELF, &ru);
+
+	printf("%7d %11.0f %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %9" PRIu64 " ",
+		nThreads, (secs > 0) ? total / secs : 0.0, percentile(lat, total, 50),
+		percentile(lat, total, 90), percentile(lat, total, 99),
+		percentile(lat, total, 99.9), lat[total - 1]);
+	if(alloccntAvailable())
+		printf("%10.2f", (double) allocs / total);
+	else
+		printf("%10s", "n/a");
+	printf(" %10ld\n", ru.ru_maxrss);
+	if(usePerfCounters)
+		printCounters(workers, nThreads, nMsgs);
+	r = 0;
+done:
+	free(lat);
+	free(workers);
+	return r;
+}
+
+static int
+writeCorpus(const struct corpus *const corpus, const char *const file)
+{
+	FILE *const fp = fopen(file, "w");
+
+	if(fp == NULL) {
+		perror(file);
+		return 1;
+	}
+	for(size_t i = 0 ; i < corpus->nMsgs ; ++i)
+		fprintf(fp, "%s\n", corpus->msgs[i]);
+	fclose(fp);
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int r = 1;
+	int opt;
+	const char *rbFile = NULL;
+	const char *corpusFile = NULL;
+	unsigned nGenRules = 1000;
+	size_t nCorpus = 10000;
+	long nMsgs = 200000;
+	unsigned pctMiss = 10;
+	int maxThreads = 1;
+	uint64_t seed = 1;
+	struct corpus corpus;
+	ln_ctx ctx;
+
+	while((opt = getopt(argc, argv, "r:g:c:n:m:t:s:w:p")) != -1) {
+		switch (opt) {
+		case 'r':
+			rbFile = optarg;
+			break;
+		case 'g':
+			nGenRules = atoi(optarg);
+			break;
+		case 'c':
+			nCorpus = atol(optarg);
+			break;
+		case 'n':
+			nMsgs = atol(optarg);
+			break;
+		case 'm':
+			pctMiss = atoi(optarg);
+			break;
+		case 't':
+			maxThreads = atoi(optarg);
+			break;
+		case 's':
+			seed = strtoull(optarg, NULL, 10);
+			break;
+		case 'w':
+			corpusFile = optarg;
+			break;
+		case 'p':
+			usePerfCounters = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: corpus_bench [-r rulebase | -g rules] [-c corpus size] "
+				"[-n messages] [-m %%non-matching] [-t max threads] [-s seed] "
+				"[-w corpus file] [-p]\n");
+			return 1;
+		}
+	}
+	if(nGenRules < 1 || nCorpus < 1 || nMsgs < 1 || pctMiss > 100 || maxThreads < 1) {
+		fprintf(stderr, "invalid parameter\n");
+		return 1;
+	}
+	/* 0 is a fixed point of xorshift */
+	rndState = (seed == 0) ? 0x9e3779b97f4a7c15ULL : seed;
+
+	memset(&corpus, 0, sizeof(corpus));
+	if((ctx = ln_initCtx()) == NULL) {
+		fprintf(stderr, "Could not initialize liblognorm context\n");
+		return 1;
+	}
+	if(loadRulebase(ctx, rbFile, nGenRules) != 0) {
+		fprintf(stderr, "could not load rulebase\n");
+		goto done;
+	}
+	if(genCorpus(ctx, &corpus, nCorpus, pctMiss) != 0) {
+		fprintf(stderr, "could not create corpus\n");
+		goto done;
+	}
+	if(corpus.nMsgs == 0) {
+		fprintf(stderr, "could not synthesize any messages from the rulebase\n");
+		goto done;
+	}
+	if(corpusFile != NULL && writeCorpus(&corpus, corpusFile) != 0)
+		goto done;
+
+	if(rbFile == NULL)
+		printf("rulebase: %u generated rules, seed %" PRIu64 "\n", nGenRules, seed);
+	else
+		printf("rulebase: %s, seed %" PRIu64 "\n", rbFile, seed);
+	printf("corpus: %zu messages (%zu matching, %zu non-matching), %zu candidates discarded\n",
+		corpus.nMsgs, corpus.nMatch, corpus.nMsgs - corpus.nMatch, corpus.nDiscarded);
+	printf("%7s %11s %8s %8s %8s %8s %9s %10s %10s\n", "threads", "msgs/s", "p50 ns",
+		"p90 ns", "p99 ns", "p99.9 ns", "max ns", "allocs/msg", "RSS KiB");
+	for(int nThreads = 1 ; nThreads <= maxThreads ; ++nThreads) {
+		if(benchThreads(ctx, &corpus, nThreads, nMsgs) != 0)
+			goto done;
+	}
+	r = 0;
+done:
+	for(size_t i = 0 ; i < corpus.nMsgs ; ++i)
+		free(corpus.msgs[i]);
+	free(corpus.msgs);
+	free(corpus.lens);
+	ln_exitCtx(ctx);
+	return r;
+}
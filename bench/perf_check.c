@@ -0,0 +1,220 @@
+/**
+ * @file perf_check.c
+ * @brief Measures stable per-message cost metrics for "make check-perf".
+ *
+ * Normalizes a fixed corpus with a rulebase and reports metrics that,
+ * unlike wall time, do not depend on machine load: instructions per
+ * message (if hardware counters are available), allocations per
+ * message made directly by liblognorm (glibc only; allocations inside
+ * json-c and libestr depend on their version and are not included)
+ * and parser calls per message (from the telemetry). Each line of output is "<metric> <value>", with "n/a"
+ * for metrics that can not be measured here. check-perf.sh compares
+ * them against the checked-in baseline.
+ *
+ *//*
+ * liblognorm - a fast samples-based log normalization library
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <json.h>
+
+#include "liblognorm.h"
+#include "alloccnt.h"
+#include "perfcnt.h"
+
+struct corpus {
+	char **msgs;
+	size_t *lens;
+	size_t nMsgs;
+};
+
+static int
+readCorpus(const char *const file, struct corpus *const corpus)
+{
+	FILE *fp;
+	char line[64 * 1024];
+	size_t nAlloc = 0;
+
+	if((fp = fopen(file, "r")) == NULL) {
+		perror(file);
+		return 1;
+	}
+	while(fgets(line, sizeof(line), fp) != NULL) {
+		size_t len = strlen(line);
+		if(len > 0 && line[len - 1] == '\n')
+			line[--len] = '\0';
+		if(corpus->nMsgs == nAlloc) {
+			nAlloc = (nAlloc == 0) ? 1024 : 2 * nAlloc;
+			char **const msgs = realloc(corpus->msgs, nAlloc * sizeof(char*));
+			size_t *const lens = realloc(corpus->lens, nAlloc * sizeof(size_t));
+			if(msgs != NULL)
+				corpus->msgs = msgs;
+			if(lens != NULL)
+				corpus->lens = lens;
+			if(msgs == NULL || lens == NULL)
+				goto fail;
+		}
+		if((corpus->msgs[corpus->nMsgs] = strdup(line)) == NULL)
+			goto fail;
+		corpus->lens[corpus->nMsgs++] = len;
+	}
+	fclose(fp);
+	return 0;
+fail:
+	fclose(fp);
+	fprintf(stderr, "out of memory reading corpus\n");
+	return 1;
+}
+
+static int
+normalizeAll(ln_ctx ctx, const struct corpus *const corpus)
+{
+	for(size_t i = 0 ; i < corpus->nMsgs ; ++i) {
+		struct json_object *json = NULL;
+		if(ln_normalize(ctx, corpus->msgs[i], corpus->lens[i], &json) != 0) {
+			json_object_put(json);
+			return 1;
+		}
+		json_object_put(json);
+	}
+	return 0;
+}
+
+static long long
+getCounter(struct json_object *const json, const char *const sub, const char *const name)
+{
+	struct json_object *obj = json;
+	struct json_object *val;
+
+	if(sub != NULL && !json_object_object_get_ex(json, sub, &obj))
+		return -1;
+	if(!json_object_object_get_ex(obj, name, &val))
+		return -1;
+	return json_object_get_int64(val);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int r = 1;
+	int opt;
+	int nPasses = 3;
+	const char *rbFile = NULL;
+	const char *corpusFile = NULL;
+	struct corpus corpus;
+	struct perfcnt pc;
+	double counters[PERFCNT_NUM];
+	struct json_object *tm = NULL;
+	ln_ctx ctx;
+
+	while((opt = getopt(argc, argv, "r:i:n:")) != -1) {
+		switch (opt) {
+		case 'r':
+			rbFile = optarg;
+			break;
+		case 'i':
+			corpusFile = optarg;
+			break;
+		case 'n':
+			nPasses = atoi(optarg);
+			break;
+		default:
+			rbFile = NULL;
+			break;
+		}
+	}
+	if(rbFile == NULL || corpusFile == NULL || nPasses < 1) {
+		fprintf(stderr, "usage: perf_check -r rulebase -i corpus [-n passes]\n");
+		return 1;
+	}
+
+	memset(&corpus, 0, sizeof(corpus));
+	if((ctx = ln_initCtx()) == NULL) {
+		fprintf(stderr, "Could not initialize liblognorm context\n");
+		return 1;
+	}
+	if(ln_loadSamples(ctx, rbFile) != 0) {
+		fprintf(stderr, "could not load rulebase %s\n", rbFile);
+		goto done;
+	}
+	if(readCorpus(corpusFile, &corpus) != 0)
+		goto done;
+	if(corpus.nMsgs == 0) {
+		fprintf(stderr, "corpus %s is empty\n", corpusFile);
+		goto done;
+	}
+
+	/* warm up, so that one-time allocations (caches etc) are not counted */
+	if(normalizeAll(ctx, &corpus) != 0)
+		goto done;
+
+	perfcntOpen(&pc);
+	const unsigned long allocs = alloccntGet();
+	const unsigned long ownAllocs = alloccntGetOwn();
+	perfcntStart(&pc);
+	for(int i = 0 ; i < nPasses ; ++i)
+		normalizeAll(ctx, &corpus);
+	perfcntStop(&pc, counters);
+	const double nMsgs = (double) nPasses * corpus.nMsgs;
+	const double allocsPerMsg = (alloccntGet() - allocs) / nMsgs;
+	const double ownAllocsPerMsg = (alloccntGetOwn() - ownAllocs) / nMsgs;
+	perfcntClose(&pc);
+
+	/* parser calls are counted separately, as telemetry has a cost itself */
+	ln_setTelemetry(ctx, 1);
+	normalizeAll(ctx, &corpus);
+	if(ln_telemetrySnapshot(ctx, 0, &tm) != 0 || tm == NULL) {
+		fprintf(stderr, "could not obtain telemetry\n");
+		goto done;
+	}
+	const long long msgs = getCounter(tm, NULL, "messages");
+	const long long calls = getCounter(tm, "parser_calls", "total");
+
+	printf("messages %zu\n", corpus.nMsgs);
+	if(counters[PERFCNT_INSTRUCTIONS] < 0)
+		printf("instructions/msg n/a\n");
+	else
+		printf("instructions/msg %.0f\n", counters[PERFCNT_INSTRUCTIONS] / nMsgs);
+	if(alloccntAvailable()) {
+		printf("allocs/msg %.2f\n", allocsPerMsg);
+		printf("ln-allocs/msg %.2f\n", ownAllocsPerMsg);
+	} else {
+		printf("allocs/msg n/a\n");
+		printf("ln-allocs/msg n/a\n");
+	}
+	if(msgs > 0 && calls >= 0)
+		printf("parser-calls/msg %.2f\n", (double) calls / msgs);
+	else
+		printf("parser-calls/msg n/a\n");
+	r = 0;
+done:
+	json_object_put(tm);
+	for(size_t i = 0 ; i < corpus.nMsgs ; ++i)
+		free(corpus.msgs[i]);
+	free(corpus.msgs);
+	free(corpus.lens);
+	ln_exitCtx(ctx);
+	return r;
+}
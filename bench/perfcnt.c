@@ -0,0 +1,153 @@
+/**
+ * @file perfcnt.c
+ * @brief Hardware performance counters for the benchmarks
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "perfcnt.h"
+
+static const char *const names[PERFCNT_NUM] = {
+	"cycles", "instructions", "L1D-misses", "LLC-misses", "branch-misses"
+};
+
+const char *
+perfcntName(const int idx)
+{
+	return (idx >= 0 && idx < PERFCNT_NUM) ? names[idx] : "unknown";
+}
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+static const struct {
+	uint32_t type;
+	uint64_t config;
+} events[PERFCNT_NUM] = {
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+		| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+		| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+};
+
+int
+perfcntOpen(struct perfcnt *const pc)
+{
+	int nOpen = 0;
+	struct perf_event_attr attr;
+
+	pc->err = 0;
+	for(int i = 0 ; i < PERFCNT_NUM ; ++i) {
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = events[i].type;
+		attr.config = events[i].config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		pc->fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		if(pc->fd[i] == -1) {
+			if(pc->err == 0)
+				pc->err = errno;
+		} else {
+			++nOpen;
+		}
+	}
+	return nOpen;
+}
+
+void
+perfcntStart(struct perfcnt *const pc)
+{
+	for(int i = 0 ; i < PERFCNT_NUM ; ++i) {
+		if(pc->fd[i] != -1) {
+			ioctl(pc->fd[i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(pc->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+void
+perfcntStop(struct perfcnt *const pc, double val[PERFCNT_NUM])
+{
+	uint64_t data[3]; /* value, time enabled, time running */
+
+	for(int i = 0 ; i < PERFCNT_NUM ; ++i) {
+		if(pc->fd[i] != -1)
+			ioctl(pc->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+	}
+	for(int i = 0 ; i < PERFCNT_NUM ; ++i) {
+		val[i] = -1;
+		if(pc->fd[i] == -1 || read(pc->fd[i], data, sizeof(data)) != sizeof(data)
+		   || data[2] == 0)
+			continue;
+		val[i] = (double) data[0] * data[1] / data[2];
+	}
+}
+
+void
+perfcntClose(struct perfcnt *const pc)
+{
+	for(int i = 0 ; i < PERFCNT_NUM ; ++i) {
+		if(pc->fd[i] != -1)
+			close(pc->fd[i]);
+		pc->fd[i] = -1;
+	}
+}
+#else /* no perf events on this platform */
+int
+perfcntOpen(struct perfcnt *const pc)
+{
+	for(int i = 0 ; i < PERFCNT_NUM ; ++i)
+		pc->fd[i] = -1;
+	pc->err = ENOSYS;
+	return 0;
+}
+
+void
+perfcntStart(struct perfcnt __attribute__((unused)) *const pc)
+{
+}
+
+void
+perfcntStop(struct perfcnt __attribute__((unused)) *const pc, double val[PERFCNT_NUM])
+{
+	for(int i = 0 ; i < PERFCNT_NUM ; ++i)
+		val[i] = -1;
+}
+
+void
+perfcntClose(struct perfcnt __attribute__((unused)) *const pc)
+{
+}
+#endif
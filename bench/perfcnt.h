@@ -0,0 +1,66 @@
+/**
+ * @file perfcnt.h
+ * @brief Hardware performance counters for the benchmarks
+ *
+ * Wraps Linux perf_event_open(2). Counters are opened for the calling
+ * thread and count user space only. Where they are not available
+ * (other OS, no PMU in a VM, perf_event_paranoid too strict), each
+ * counter is reported as unavailable and the benchmarks run anyway.
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#ifndef LIBLOGNORM_PERFCNT_H_INCLUDED
+#define	LIBLOGNORM_PERFCNT_H_INCLUDED
+
+#define PERFCNT_CYCLES		0
+#define PERFCNT_INSTRUCTIONS	1
+#define PERFCNT_L1D_MISSES	2
+#define PERFCNT_LLC_MISSES	3
+#define PERFCNT_BRANCH_MISSES	4
+#define PERFCNT_NUM		5
+
+struct perfcnt {
+	int fd[PERFCNT_NUM];	/**< -1: counter not available */
+	int err;		/**< errno of the first failed open, 0 if none */
+};
+
+/**
+ * Open the counters for the calling thread. They are not yet running.
+ *
+ * @return number of available counters, 0 if none
+ */
+int perfcntOpen(struct perfcnt *pc);
+
+/** Reset and start all available counters. */
+void perfcntStart(struct perfcnt *pc);
+
+/**
+ * Stop the counters and read them. Values are scaled if the kernel
+ * had to multiplex counters. Unavailable counters are set to -1.
+ */
+void perfcntStop(struct perfcnt *pc, double val[PERFCNT_NUM]);
+
+void perfcntClose(struct perfcnt *pc);
+
+/** short name of the counter for report headers */
+const char *perfcntName(int idx);
+
+#endif /* #ifndef LIBLOGNORM_PERFCNT_H_INCLUDED */
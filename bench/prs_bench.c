@@ -0,0 +1,298 @@
+/**
+ * @file prs_bench.c
+ * @brief Microbenchmark for the individual parsers.
+ *
+ * Each parser of the lookup table is called directly via its
+ * ln_v2_parse* entry point, without the parse DAG around it, on an
+ * input it matches (hit) and one it rejects (miss). Parsers whose
+ * work grows with the matched text are run on inputs of several
+ * sizes. The parser instance is taken from a one-rule rulebase, so it
+ * is configured exactly as in production.
+ *
+ * For each case, ns/call, matched bytes/ns and memory allocations per
+ * call are reported. Allocations are counted by wrapping malloc and
+ * friends, which is only supported with glibc.
+ *
+ *//*
+ * liblognorm - a fast samples-based log normalization library
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <json.h>
+
+#include "liblognorm.h"
+#include "lognorm.h"
+#include "pdag.h"
+#include "alloccnt.h"
+
+/* The hit input is prefix + unit * n + suffix. For parsers with a
+ * unit, n is chosen to reach each of the input sizes; the others
+ * match a fixed text, so only that is benchmarked.
+ */
+struct prs_case {
+	const char *parser;
+	const char *config;	/**< additional field config (json members) */
+	const char *prefix;
+	const char *unit;	/**< NULL: fixed size input */
+	const char *suffix;
+	const char *miss;	/**< NULL: parser matches everything */
+};
+
+static const struct prs_case cases[] = {
+	{ "literal", NULL, "GET /index.html", NULL, "", "GET /index.htm!" },
+	{ "repeat", "\"parser\":{\"type\":\"number\",\"name\":\".\"},"
+		"\"while\":{\"type\":\"literal\",\"text\":\",\"}", "", "1234,", "1", "x" },
+	{ "date-rfc3164", NULL, "Oct 18 10:00:01", NULL, "", "Oct 18 10:0x:01" },
+	{ "date-rfc5424", NULL, "2026-10-18T10:00:01.123456+02:00", NULL, "", "2026-10-18X10:00:01" },
+	{ "number", NULL, "1234567890", NULL, "", "x" },
+	{ "float", NULL, "-1234.5678", NULL, "", "x" },
+	{ "hexnumber", NULL, "0x1a2b3c4d ", NULL, "", "0xzz " },
+	{ "kernel-timestamp", NULL, "[12345.123456]", NULL, "", "[12345.12x456]" },
+	{ "whitespace", NULL, "", " ", "x", "x" },
+	{ "ipv4", NULL, "192.168.100.200", NULL, "", "192.168.100.256" },
+	{ "ipv6", NULL, "2001:db8:85a3::8a2e:370:7334", NULL, "", "2001:db8:85a3::8a2e:370:g" },
+	{ "word", NULL, "", "a", " ", " x" },
+	{ "alpha", NULL, "", "a", " ", "1" },
+	{ "rest", NULL, "", "a", "", NULL },
+	{ "op-quoted-string", NULL, "\"", "a", "\"", " x" },
+	{ "quoted-string", NULL, "\"", "a", "\"", "a" },
+	{ "date-iso", NULL, "2026-10-18", NULL, "", "2026-1x-18" },
+	{ "time-24hr", NULL, "10:00:01", NULL, "", "25:00:01" },
+	{ "time-12hr", NULL, "10:00:01", NULL, "", "13:00:01" },
+	{ "duration", NULL, "1:02:03", NULL, "", "x" },
+	{ "cisco-interface-spec", NULL, "outside:192.0.2.1/50349", NULL, "", "outside 192.0.2.1" },
+	{ "json", NULL, "{\"a\":1", ",\"key\":\"value\"", "}", "{\"a\":" },
+	{ "cee-syslog", NULL, "@cee:{\"a\":1", ",\"key\":\"value\"", "}", "@cee: x" },
+	{ "mac48", NULL, "00:1a:2b:3c:4d:5e", NULL, "", "00:1a:2b:3c:4d:" },
+	{ "cef", NULL, "CEF:0|Vendor|Product|1.0|100|name|10|", "key=value ", "k=v", "CEF:0|x" },
+	{ "v2-iptables", NULL, "IN=eth0", " SRC=10.0.0.1", "", "x" },
+	{ "name-value-list", NULL, "", "key=value ", "k=v", NULL },
+	{ "checkpoint-lea", NULL, "", "key: value; ", "k: v;", NULL },
+	{ "string-to", "\"extradata\":\"END\"", "", "a", "END", "aaaa" },
+	{ "char-to", "\"extradata\":\":\"", "", "a", ":", "aaaa" },
+	{ "char-sep", "\"extradata\":\":\"", "", "a", ":", NULL },
+	{ "string", NULL, "", "a", " ", " x" }
+};
+#define NUM_CASES (sizeof(cases) / sizeof(cases[0]))
+
+static const size_t sizes[] = { 16, 256, 4096 };
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+static long nIterFixed = 0;	/* 0: calibrate */
+static int noValues = 0;
+
+static double
+timeDiff(const struct timespec *const begin, const struct timespec *const end)
+{
+	return (end->tv_sec - begin->tv_sec) + (end->tv_nsec - begin->tv_nsec) / 1e9;
+}
+
+static char *
+buildInput(const struct prs_case *const pc, const size_t size)
+{
+	const size_t lenPrefix = strlen(pc->prefix);
+	const size_t lenSuffix = strlen(pc->suffix);
+	size_t n = 0;
+	char *buf;
+
+	if(pc->unit != NULL) {
+		const size_t lenUnit = strlen(pc->unit);
+		n = (size > lenPrefix + lenSuffix + lenUnit)
+			? (size - lenPrefix - lenSuffix) / lenUnit : 1;
+	}
+	if((buf = malloc(lenPrefix + n * (pc->unit == NULL ? 0 : strlen(pc->unit))
+			 + lenSuffix + 1)) == NULL)
+		return NULL;
+	strcpy(buf, pc->prefix);
+	for(size_t i = 0 ; i < n ; ++i)
+		strcat(buf, pc->unit);
+	strcat(buf, pc->suffix);
+	return buf;
+}
+
+/* the configured parser instance of a one-rule rulebase */
+static const ln_parser_t *
+loadParser(ln_ctx ctx, const struct prs_case *const pc)
+{
+	char rb[512];
+
+	if(!strcmp(pc->parser, "literal"))
+		snprintf(rb, sizeof(rb), "version=2\nrule=:%s\n", pc->prefix);
+	else
+		snprintf(rb, sizeof(rb), "version=2\nrule=:%%{\"name\":\"f\",\"type\":\"%s\"%s%s}%%\n",
+			pc->parser, (pc->config == NULL) ? "" : ",",
+			(pc->config == NULL) ? "" : pc->config);
+	if(ln_loadSamplesFromString(ctx, rb) != 0 || ctx->pdag->nparsers != 1)
+		return NULL;
+	return ctx->pdag->parsers;
+}
+
+static inline int
+callParser(npb_t *const npb, const ln_parser_t *const prs,
+	int (*const parser)(npb_t*, size_t*, void *const, size_t*, struct json_object **),
+	size_t *const parsed)
+{
+	size_t offs = 0;
+	struct json_object *value = NULL;
+
+	npb->parsedTo = 0;
+	memset(&npb->tmMsg, 0, sizeof(npb->tmMsg));
+	*parsed = 0;
+	const int r = parser(npb, &offs, prs->parser_data, parsed, noValues ? NULL : &value);
+	if(value != NULL)
+		json_object_put(value);
+	return r;
+}
+
+/* returns 0 if the parser behaved as expected */
+static int
+benchInput(ln_ctx ctx, const ln_parser_t *const prs, const char *const what,
+	const char *const input, const int expectHit)
+{
+	int (*const parser)(npb_t*, size_t*, void *const, size_t*, struct json_object **)
+		= ln_parserInfo(prs->prsid)->parser;
+	npb_t npb;
+	size_t parsed;
+	struct timespec begin, end;
+	long nIter = (nIterFixed > 0) ? nIterFixed : 1000;
+	double secs;
+	unsigned long allocs;
+
+	memset(&npb, 0, sizeof(npb));
+	npb.ctx = ctx;
+	npb.str = input;
+	npb.strLen = strlen(input);
+	if((callParser(&npb, prs, parser, &parsed) == 0) != expectHit) {
+		fflush(stdout);
+		fprintf(stderr, "%s: %s input unexpectedly %s: '%.40s'\n", ln_parserIDName(prs->prsid),
+			what, expectHit ? "not matched" : "matched", input);
+		return 1;
+	}
+	while(1) {
+		allocs = alloccntGet();
+		clock_gettime(CLOCK_MONOTONIC, &begin);
+		for(long n = 0 ; n < nIter ; ++n)
+			callParser(&npb, prs, parser, &parsed);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		allocs = alloccntGet() - allocs;
+		secs = timeDiff(&begin, &end);
+		if(nIterFixed > 0 || secs >= 0.1)
+			break;
+		nIter *= 2;
+	}
+	const double ns = secs * 1e9 / nIter;
+	printf("%-20s %-4s %7zu %10.1f ", ln_parserIDName(prs->prsid), what, npb.strLen, ns);
+	if(expectHit && ns > 0)
+		printf("%9.3f ", parsed / ns);
+	else
+		printf("%9s ", "-");
+	if(alloccntAvailable())
+		printf("%12.2f\n", (double) allocs / nIter);
+	else
+		printf("%12s\n", "n/a");
+	return 0;
+}
+
+static int
+benchCase(const struct prs_case *const pc)
+{
+	int r = 1;
+	ln_ctx ctx;
+	const ln_parser_t *prs;
+	char *input = NULL;
+
+	if((ctx = ln_initCtx()) == NULL) {
+		fprintf(stderr, "Could not initialize liblognorm context\n");
+		return 1;
+	}
+	if((prs = loadParser(ctx, pc)) == NULL) {
+		fprintf(stderr, "%s: could not load parser\n", pc->parser);
+		goto done;
+	}
+	for(size_t s = 0 ; s < ((pc->unit == NULL) ? 1 : NUM_SIZES) ; ++s) {
+		if((input = buildInput(pc, sizes[s])) == NULL
+		   || benchInput(ctx, prs, "hit", input, 1) != 0)
+			goto done;
+		free(input);
+		input = NULL;
+	}
+	if(pc->miss != NULL && benchInput(ctx, prs, "miss", pc->miss, 0) != 0)
+		goto done;
+	r = 0;
+done:
+	free(input);
+	ln_exitCtx(ctx);
+	return r;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int r = 0;
+	int opt;
+	const char *only = NULL;
+
+	while((opt = getopt(argc, argv, "n:p:m")) != -1) {
+		switch (opt) {
+		case 'n':
+			nIterFixed = atol(optarg);
+			break;
+		case 'p':
+			only = optarg;
+			break;
+		case 'm':
+			noValues = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: prs_bench [-n calls] [-p parser] [-m]\n"
+				"  -n  calls per case, default: calibrate to at least 0.1s\n"
+				"  -p  benchmark only this parser\n"
+				"  -m  match only, do not create values\n");
+			return 1;
+		}
+	}
+
+	printf("%-20s %-4s %7s %10s %9s %12s\n",
+		"parser", "case", "bytes", "ns/call", "bytes/ns", "allocs/call");
+	/* every parser of the lookup table must have a case */
+	for(prsid_t id = 0 ; ln_parserInfo(id) != NULL ; ++id) {
+		const char *const name = ln_parserIDName(id);
+		size_t c;
+		if(only != NULL && strcmp(only, name))
+			continue;
+		for(c = 0 ; c < NUM_CASES ; ++c)
+			if(!strcmp(cases[c].parser, name))
+				break;
+		if(c == NUM_CASES) {
+			fflush(stdout);
+			fprintf(stderr, "%s: no benchmark input defined\n", name);
+			r = 1;
+		} else if(benchCase(cases + c) != 0) {
+			r = 1;
+		}
+	}
+	return r;
+}
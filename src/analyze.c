@@ -0,0 +1,763 @@
+/**
+ * @file analyze.c
+ * @brief Static worst-case complexity analysis of the parse DAG.
+ *
+ * The analysis runs over the optimized pdag, i.e. over exactly what
+ * the normalizer executes. For each node, it computes an upper bound
+ * of the parser calls that a single message may cause from there
+ * on. All parsers of a node may be called, but only the subtrees of
+ * parsers that can match the same text are entered for the same
+ * message. Whether two parsers may match the same text is decided by
+ * the set of characters they can start with (and whether they can
+ * match empty text). This is a coarse, but safe approximation.
+ *
+ * Repeat bodies and recursive types are counted once; their real
+ * cost also grows with the length of the message. Constructs that
+ * cause backtracking or worse are reported as findings.
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <libestr.h>
+
+#include "liblognorm.h"
+#include "lognorm.h"
+#include "internal.h"
+#include "pdag.h"
+#include "parser.h"
+
+#define AN_COST_MAX UINT64_MAX	/* saturated, i.e. "unbounded" */
+
+/* character classes a parser can start with */
+#define AN_DIGIT	0x01
+#define AN_HEX		0x02
+#define AN_ALPHA	0x04
+#define AN_SPACE	0x08
+#define AN_NONSPACE	0x10
+#define AN_ANY		0x20
+#define AN_EMPTY	0x40	/* can match empty text */
+
+static const struct {
+	const char *name;
+	int classes;
+	const char *chars;	/**< additional characters */
+} an_startChars[] = {
+	{ "date-rfc3164", AN_ALPHA, "" },
+	{ "date-rfc5424", AN_DIGIT, "" },
+	{ "number", AN_DIGIT, "" },
+	{ "float", AN_DIGIT, "-." },
+	{ "hexnumber", 0, "0" },
+	{ "kernel-timestamp", 0, "[" },
+	{ "whitespace", AN_SPACE, "" },
+	{ "ipv4", AN_DIGIT, "" },
+	{ "ipv6", AN_HEX, ":" },
+	{ "word", AN_NONSPACE, "" },
+	{ "alpha", AN_ALPHA, "" },
+	{ "op-quoted-string", AN_NONSPACE, "" },
+	{ "quoted-string", 0, "\"" },
+	{ "date-iso", AN_DIGIT, "" },
+	{ "time-24hr", AN_DIGIT, "" },
+	{ "time-12hr", AN_DIGIT, "" },
+	{ "duration", AN_DIGIT, "" },
+	{ "cisco-interface-spec", AN_NONSPACE, "" },
+	{ "json", 0, "{]" },
+	{ "cee-syslog", 0, "@" },
+	{ "mac48", AN_HEX, "" },
+	{ "cef", 0, "C" },
+	{ "v2-iptables", AN_NONSPACE, "" },
+	{ "string-to", AN_ANY, "" },
+	{ "char-to", AN_ANY, "" }
+	/* all others: any character or empty text */
+};
+
+/* characters text can start with; empty: text may be empty */
+struct an_first {
+	uint64_t bits[4];
+	int empty;
+};
+
+/* analysis results per node */
+struct an_info {
+	const struct ln_pdag *node;
+	int state;		/**< 0: in progress, 1: done */
+	uint64_t cost;		/**< worst-case parser calls from here on */
+	int repeatDepth;	/**< max nesting of repeat parsers from here on */
+	struct an_first first;
+	struct an_info *next;	/**< hash chain */
+};
+
+struct an_finding {
+	int problem;		/**< 1: problem, 0: warning */
+	uint64_t cost;
+	char *text;
+};
+
+#define AN_NBUCKETS 1024	/* must be power of 2 */
+struct an_ctx {
+	ln_ctx ctx;
+	struct an_info *buckets[AN_NBUCKETS];
+	int *typeState;		/**< per type: 0: not seen, 1: at its start, 2: done */
+	struct an_finding *findings;
+	int nfindings;
+	int maxfindings;
+	int nproblems;
+};
+
+static inline uint64_t
+costAdd(const uint64_t a, const uint64_t b)
+{
+	return (a > AN_COST_MAX - b) ? AN_COST_MAX : a + b;
+}
+
+static inline void
+firstAddChar(struct an_first *const f, const unsigned char c)
+{
+	f->bits[c >> 6] |= 1ull << (c & 63);
+}
+
+static inline void
+firstAdd(struct an_first *const f, const struct an_first *const add)
+{
+	for(int i = 0 ; i < 4 ; ++i)
+		f->bits[i] |= add->bits[i];
+	f->empty |= add->empty;
+}
+
+static void
+firstAddClasses(struct an_first *const f, const int classes, const char *chars)
+{
+	for(int c = 1 ; c < 256 ; ++c) {
+		if(   (classes & AN_ANY)
+		   || ((classes & AN_DIGIT) && c >= '0' && c <= '9')
+		   || ((classes & AN_HEX) && ((c >= '0' && c <= '9')
+		      || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')))
+		   || ((classes & AN_ALPHA) && ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')))
+		   || ((classes & AN_SPACE) && (c == ' ' || (c >= '\t' && c <= '\r')))
+		   || ((classes & AN_NONSPACE) && c != ' '))
+			firstAddChar(f, c);
+	}
+	for( ; *chars ; ++chars)
+		firstAddChar(f, *chars);
+	if(classes & AN_EMPTY)
+		f->empty = 1;
+}
+
+/* start classes of a parser; parsers not in the table can match anything */
+static void
+startClasses(const prsid_t prsid, int *const classes, const char **const chars)
+{
+	const char *const name = ln_parserIDName(prsid);
+
+	for(size_t i = 0 ; i < sizeof(an_startChars) / sizeof(an_startChars[0]) ; ++i) {
+		if(!strcmp(an_startChars[i].name, name)) {
+			*classes = an_startChars[i].classes;
+			*chars = an_startChars[i].chars;
+			return;
+		}
+	}
+	*classes = AN_ANY | AN_EMPTY;
+	*chars = "";
+}
+
+static int
+firstCount(const struct an_first *const f)
+{
+	int n = 0;
+	for(int i = 0 ; i < 4 ; ++i)
+		n += __builtin_popcountll(f->bits[i]);
+	return n;
+}
+
+static struct an_info *
+findInfo(struct an_ctx *const an, const struct ln_pdag *const node)
+{
+	const size_t idx = ((uintptr_t) node >> 4) & (AN_NBUCKETS - 1);
+	struct an_info *info;
+
+	for(info = an->buckets[idx] ; info != NULL ; info = info->next)
+		if(info->node == node)
+			break;
+	return info;
+}
+
+static struct an_info *
+addInfo(struct an_ctx *const an, const struct ln_pdag *const node)
+{
+	const size_t idx = ((uintptr_t) node >> 4) & (AN_NBUCKETS - 1);
+	struct an_info *info;
+
+	if((info = calloc(1, sizeof(struct an_info))) == NULL)
+		goto done;
+	info->node = node;
+	info->next = an->buckets[idx];
+	an->buckets[idx] = info;
+done:	return info;
+}
+
+static inline void
+addCStr(es_str_t **const str, const char *const cstr)
+{
+	es_addBuf(str, cstr, strlen(cstr));
+}
+
+static void
+addLocation(es_str_t **const str, const struct ln_pdag *const node)
+{
+	char buf[32];
+	const struct ln_pdag *const term = ln_pdagFirstTerminal(node);
+
+	if(term != NULL && term->rb_file != NULL) {
+		addCStr(str, " (");
+		addCStr(str, term->rb_file);
+		const int len = snprintf(buf, sizeof(buf), ":%u)", term->rb_lineno);
+		es_addBuf(str, buf, len);
+	}
+}
+
+static void
+addParser(ln_ctx ctx, es_str_t **const str, const ln_parser_t *const prs)
+{
+	ln_addParserDisplayName(ctx, prs, str);
+	addLocation(str, prs->node);
+}
+
+static void
+addNode(es_str_t **const str, const struct ln_pdag *const node, const char *const component)
+{
+	if(node->rb_id == NULL) {
+		addCStr(str, "(repeat body)");
+	} else if(node->rb_id[0] == '\0') {
+		addCStr(str, "(start)");
+	} else {
+		es_addChar(str, '\'');
+		addCStr(str, node->rb_id);
+		es_addChar(str, '\'');
+	}
+	if(component != NULL) {
+		addCStr(str, " in ");
+		addCStr(str, component);
+	}
+}
+
+/* takes ownership of str */
+static int
+addFinding(struct an_ctx *const an, const int problem, const uint64_t cost, es_str_t *str)
+{
+	int r = 0;
+
+	if(an->nfindings == an->maxfindings) {
+		const int newmax = (an->maxfindings == 0) ? 16 : 2 * an->maxfindings;
+		struct an_finding *const newf = realloc(an->findings,
+			newmax * sizeof(struct an_finding));
+		CHKN(newf);
+		an->findings = newf;
+		an->maxfindings = newmax;
+	}
+	CHKN(an->findings[an->nfindings].text = es_str2cstr(str, NULL));
+	an->findings[an->nfindings].problem = problem;
+	an->findings[an->nfindings].cost = cost;
+	++an->nfindings;
+	if(problem)
+		++an->nproblems;
+done:
+	es_deleteStr(str);
+	return r;
+}
+
+/* headline of a finding, cost is the worst-case waste */
+static es_str_t *
+newFinding(const int problem, const char *const what, const uint64_t cost)
+{
+	es_str_t *str;
+	char buf[64];
+
+	if((str = es_newStr(256)) == NULL)
+		goto done;
+	addCStr(&str, problem ? "problem: " : "warning: ");
+	addCStr(&str, what);
+	if(cost == AN_COST_MAX)
+		addCStr(&str, ", unbounded parser calls");
+	else if(cost > 0) {
+		snprintf(buf, sizeof(buf), ", up to %" PRIu64 " parser calls", cost);
+		addCStr(&str, buf);
+	}
+done:	return str;
+}
+
+static const struct an_info *analyzeNode(struct an_ctx *an, const struct ln_pdag *node,
+	const char *component);
+
+/* analysis data of a single parser */
+struct an_prs {
+	struct an_first first;
+	uint64_t inner;		/**< calls done inside the parser (types, repeat) */
+	int repeatDepth;
+	const struct an_info *child;
+};
+
+/* all knowledge is lost for cycles; assume the worst */
+static const struct an_info an_unknown = {
+	.state = 1,
+	.first = { { ~0ull, ~0ull, ~0ull, ~0ull }, 1 }
+};
+
+static int
+analyzeParser(struct an_ctx *const an, const ln_parser_t *const prs,
+	const char *const component, struct an_prs *const ap)
+{
+	int r = 0;
+
+	memset(ap, 0, sizeof(*ap));
+	if(prs->prsid == PRS_LITERAL) {
+		const char *const lit = ln_DataForDisplayLiteral(an->ctx, prs->parser_data);
+		firstAddChar(&ap->first, lit[0]);
+	} else if(prs->prsid == PRS_CUSTOM_TYPE) {
+		const struct ln_type_pdag *const type = an->ctx->type_pdags + prs->custTypeIdx;
+		const struct an_info *info;
+		CHKN(info = analyzeNode(an, type->pdag, type->name));
+		ap->first = info->first;
+		ap->inner = info->cost;
+		ap->repeatDepth = info->repeatDepth;
+	} else if(prs->prsid == PRS_REPEAT) {
+		const struct data_Repeat *const data = (const struct data_Repeat*) prs->parser_data;
+		const struct an_info *body;
+		const struct an_info *whileCond = NULL;
+		CHKN(body = analyzeNode(an, data->parser, component));
+		ap->first = body->first;
+		ap->inner = body->cost;
+		ap->repeatDepth = body->repeatDepth;
+		if(data->whileLit == NULL) {
+			CHKN(whileCond = analyzeNode(an, data->while_cond, component));
+			ap->inner = costAdd(ap->inner, whileCond->cost);
+			if(whileCond->repeatDepth > ap->repeatDepth)
+				ap->repeatDepth = whileCond->repeatDepth;
+		}
+		++ap->repeatDepth;
+	} else {
+		int classes;
+		const char *chars;
+		startClasses(prs->prsid, &classes, &chars);
+		firstAddClasses(&ap->first, classes, chars);
+	}
+	CHKN(ap->child = analyzeNode(an, prs->node, component));
+	if(ap->first.empty) {
+		/* the parser may consume nothing, so the next one starts here */
+		ap->first.empty = 0;
+		firstAdd(&ap->first, &ap->child->first);
+	}
+done:	return r;
+}
+
+/* can two parsers match text at the same position? */
+static int
+overlaps(ln_ctx ctx, const ln_parser_t *const p1, const struct an_prs *const a1,
+	const ln_parser_t *const p2, const struct an_prs *const a2)
+{
+	if(p1->prsid == PRS_LITERAL && p2->prsid == PRS_LITERAL) {
+		const char *const l1 = ln_DataForDisplayLiteral(ctx, p1->parser_data);
+		const char *const l2 = ln_DataForDisplayLiteral(ctx, p2->parser_data);
+		const size_t len1 = strlen(l1);
+		const size_t len2 = strlen(l2);
+		return !strncmp(l1, l2, (len1 < len2) ? len1 : len2);
+	}
+	if(a1->first.empty || a2->first.empty)
+		return 1;
+	for(int i = 0 ; i < 4 ; ++i)
+		if(a1->first.bits[i] & a2->first.bits[i])
+			return 1;
+	return 0;
+}
+
+static int
+reportOverlap(struct an_ctx *const an, const struct ln_pdag *const node,
+	const char *const component, const ln_parser_t *const prs,
+	const struct an_prs *const ap, const ln_parser_t *const other, const int nmore)
+{
+	int r = 0;
+	es_str_t *str;
+	char buf[64];
+	const uint64_t waste = costAdd(1 + ap->inner, ap->child->cost);
+
+	CHKN(str = newFinding(0, (prs->node == other->node)
+		? "alternative branches overlap" : "sibling parsers overlap", waste));
+	addCStr(&str, "\n\tnode.....: ");
+	addNode(&str, node, component);
+	addCStr(&str, "\n\ttried....: ");
+	addParser(an->ctx, &str, prs);
+	addCStr(&str, "\n\tthen.....: ");
+	addParser(an->ctx, &str, other);
+	if(nmore > 0) {
+		snprintf(buf, sizeof(buf), " and %d more", nmore);
+		addCStr(&str, buf);
+	}
+	addCStr(&str, "\n\treason...: if the first one matches, but the rest of "
+		"the rule does not,\n\t           the next one is tried on the same text");
+	CHKR(addFinding(an, 0, waste, str));
+done:	return r;
+}
+
+static int
+reportSameType(struct an_ctx *const an, const struct ln_pdag *const node,
+	const char *const component, const ln_parser_t *const prs,
+	const struct an_prs *const ap, const int ntimes)
+{
+	int r = 0;
+	es_str_t *str;
+	char buf[128];
+	const char *const type = an->ctx->type_pdags[prs->custTypeIdx].name;
+	uint64_t waste = 0;
+
+	for(int i = 1 ; i < ntimes ; ++i)
+		waste = costAdd(waste, 1 + ap->inner);
+	snprintf(buf, sizeof(buf), "type %s is entered %d times at the same offset",
+		type, ntimes);
+	CHKN(str = newFinding(0, buf, waste));
+	addCStr(&str, "\n\tnode.....: ");
+	addNode(&str, node, component);
+	addCStr(&str, "\n\tfirst....: ");
+	addParser(an->ctx, &str, prs);
+	CHKR(addFinding(an, 0, waste, str));
+done:	return r;
+}
+
+static int
+reportRepeat(struct an_ctx *const an, const struct ln_pdag *const node,
+	const char *const component, const ln_parser_t *const prs,
+	const struct an_prs *const ap)
+{
+	int r = 0;
+	es_str_t *str;
+	char buf[160];
+	const struct data_Repeat *const data = (const struct data_Repeat*) prs->parser_data;
+	const struct an_info *const body = findInfo(an, data->parser);
+	const struct an_info *const whileCond = (data->whileLit == NULL)
+		? findInfo(an, data->while_cond) : NULL;
+	const int endless = body->first.empty
+		&& (whileCond == NULL ? data->lenWhileLit == 0 : whileCond->first.empty);
+
+	if(endless) {
+		CHKN(str = newFinding(1, "repeat body and while condition can both match "
+			"empty text, so the repeat may never end", AN_COST_MAX));
+	} else if(ap->repeatDepth > 1) {
+		const int permissive = body->first.empty || firstCount(&body->first) >= 128;
+		snprintf(buf, sizeof(buf), "repeat nested %d levels deep%s, parser calls "
+			"grow with the message length to the power of %d", ap->repeatDepth,
+			permissive ? " with permissive body" : "", ap->repeatDepth);
+		CHKN(str = newFinding(0, buf, 0));
+	} else {
+		goto done;
+	}
+	addCStr(&str, "\n\tnode.....: ");
+	addNode(&str, node, component);
+	addCStr(&str, "\n\tparser...: ");
+	addParser(an->ctx, &str, prs);
+	CHKR(addFinding(an, endless, endless ? AN_COST_MAX : ap->inner, str));
+done:	return r;
+}
+
+static int
+analyzeNodeParsers(struct an_ctx *const an, const struct ln_pdag *const node,
+	const char *const component, struct an_info *const info)
+{
+	int r = 0;
+	struct an_prs *aps = NULL;
+	const int n = node->nparsers;
+	uint64_t maxSubtrees = 0;
+
+	info->first.empty = node->flags.isTerminal;
+	if(n == 0)
+		goto done;
+	CHKN(aps = calloc(n, sizeof(struct an_prs)));
+	for(int i = 0 ; i < n ; ++i) {
+		CHKR(analyzeParser(an, node->parsers + i, component, aps + i));
+		info->cost = costAdd(info->cost, 1 + aps[i].inner);
+		firstAdd(&info->first, &aps[i].first);
+		const int depth = (aps[i].repeatDepth > aps[i].child->repeatDepth)
+			? aps[i].repeatDepth : aps[i].child->repeatDepth;
+		if(depth > info->repeatDepth)
+			info->repeatDepth = depth;
+		if(node->parsers[i].prsid == PRS_REPEAT)
+			CHKR(reportRepeat(an, node, component, node->parsers + i, aps + i));
+	}
+
+	/* a message may enter the subtrees of all parsers that overlap */
+	for(int i = 0 ; i < n ; ++i) {
+		const ln_parser_t *const prs = node->parsers + i;
+		uint64_t subtrees = aps[i].child->cost;
+		const ln_parser_t *other = NULL;
+		int nOther = 0;
+		int nSameType = 1;
+		for(int j = 0 ; j < n ; ++j) {
+			if(j == i || !overlaps(an->ctx, prs, aps + i, node->parsers + j, aps + j))
+				continue;
+			subtrees = costAdd(subtrees, aps[j].child->cost);
+			if(j < i)
+				continue;
+			if(prs->prsid == PRS_CUSTOM_TYPE && node->parsers[j].prsid == PRS_CUSTOM_TYPE
+			   && prs->custTypeIdx == node->parsers[j].custTypeIdx) {
+				++nSameType;
+				continue;
+			}
+			if(other == NULL)
+				other = node->parsers + j;
+			else
+				++nOther;
+		}
+		if(subtrees > maxSubtrees)
+			maxSubtrees = subtrees;
+		if(other != NULL)
+			CHKR(reportOverlap(an, node, component, prs, aps + i, other, nOther));
+		if(nSameType > 1) {
+			int isFirst = 1;
+			for(int j = 0 ; j < i ; ++j)
+				if(node->parsers[j].prsid == PRS_CUSTOM_TYPE
+				   && node->parsers[j].custTypeIdx == prs->custTypeIdx)
+					isFirst = 0;
+			if(isFirst)
+				CHKR(reportSameType(an, node, component, prs, aps + i, nSameType));
+		}
+	}
+	info->cost = costAdd(info->cost, maxSubtrees);
+done:
+	free(aps);
+	return r;
+}
+
+static const struct an_info *
+analyzeNode(struct an_ctx *const an, const struct ln_pdag *const node,
+	const char *const component)
+{
+	struct an_info *info;
+
+	if((info = findInfo(an, node)) != NULL) {
+		if(info->state == 0) /* recursive type */
+			return &an_unknown;
+		return info;
+	}
+	if((info = addInfo(an, node)) == NULL)
+		return NULL;
+	if(analyzeNodeParsers(an, node, component, info) != 0)
+		return NULL;
+	info->state = 1;
+	return info;
+}
+
+static int
+reportLeftRecursion(struct an_ctx *const an, const int *const path, const int len)
+{
+	int r = 0;
+	es_str_t *str;
+	const struct ln_type_pdag *const type = an->ctx->type_pdags + path[len - 1];
+
+	CHKN(str = newFinding(1, "type re-enters itself at the same offset "
+		"(left recursion), so parsing never ends", AN_COST_MAX));
+	addCStr(&str, "\n\tcycle....: ");
+	int start = 0;
+	while(path[start] != path[len - 1])
+		++start;
+	for(int i = start ; i < len ; ++i) {
+		if(i > start)
+			addCStr(&str, " -> ");
+		addCStr(&str, an->ctx->type_pdags[path[i]].name);
+	}
+	addCStr(&str, "\n\ttype.....: ");
+	addCStr(&str, type->name);
+	addLocation(&str, type->pdag);
+	CHKR(addFinding(an, 1, AN_COST_MAX, str));
+done:	return r;
+}
+
+/* follow the types called at the start of the type path[0], i.e. at
+ * the same offset. Parsers that may match empty text are looked through.
+ */
+static int
+findLeftRecursion(struct an_ctx *const an, const struct ln_pdag *const node,
+	int *const path, const int depth, const int maxDepth)
+{
+	int r = 0;
+
+	for(int i = 0 ; i < node->nparsers ; ++i) {
+		const ln_parser_t *const prs = node->parsers + i;
+		if(prs->prsid == PRS_CUSTOM_TYPE) {
+			const int idx = (int) prs->custTypeIdx;
+			if(an->typeState[idx] == 1) {
+				path[depth] = idx;
+				/* report each cycle once, from its first type */
+				int isFirst = 1;
+				int start = 0;
+				while(path[start] != idx)
+					++start;
+				for(int k = start ; k < depth ; ++k)
+					if(path[k] < idx)
+						isFirst = 0;
+				if(isFirst)
+					CHKR(reportLeftRecursion(an, path, depth + 1));
+			} else if(an->typeState[idx] == 0 && depth < maxDepth) {
+				path[depth] = idx;
+				an->typeState[idx] = 1;
+				CHKR(findLeftRecursion(an, an->ctx->type_pdags[idx].pdag,
+					path, depth + 1, maxDepth));
+				an->typeState[idx] = 0;
+			}
+		}
+		/* look through parsers that may consume nothing */
+		const struct an_info *inner;
+		int empty;
+		if(prs->prsid == PRS_LITERAL) {
+			empty = 0;
+		} else if(prs->prsid == PRS_CUSTOM_TYPE) {
+			inner = findInfo(an, an->ctx->type_pdags[prs->custTypeIdx].pdag);
+			empty = inner == NULL || inner->first.empty;
+		} else if(prs->prsid == PRS_REPEAT) {
+			inner = findInfo(an, ((const struct data_Repeat*) prs->parser_data)->parser);
+			empty = inner == NULL || inner->first.empty;
+		} else {
+			int classes;
+			const char *chars;
+			startClasses(prs->prsid, &classes, &chars);
+			empty = (classes & AN_EMPTY) != 0;
+		}
+		if(empty)
+			CHKR(findLeftRecursion(an, prs->node, path, depth, maxDepth));
+	}
+done:	return r;
+}
+
+/* most expensive rule: follow the most expensive parser of each node */
+static const struct ln_pdag *
+heaviestRule(struct an_ctx *const an, const struct ln_pdag *node)
+{
+	while(node->nparsers > 0) {
+		const struct ln_pdag *next = NULL;
+		uint64_t max = 0;
+		for(int i = 0 ; i < node->nparsers ; ++i) {
+			const struct an_info *const child = findInfo(an, node->parsers[i].node);
+			if(child != NULL && (next == NULL || child->cost > max)) {
+				next = node->parsers[i].node;
+				max = child->cost;
+			}
+		}
+		if(next == NULL)
+			break;
+		node = next;
+	}
+	return node;
+}
+
+/* problems first, then most expensive; text makes the order deterministic */
+static int
+cmpFindings(const void *const a, const void *const b)
+{
+	const struct an_finding *const fa = (const struct an_finding*) a;
+	const struct an_finding *const fb = (const struct an_finding*) b;
+
+	if(fa->problem != fb->problem)
+		return fb->problem - fa->problem;
+	if(fa->cost != fb->cost)
+		return (fa->cost < fb->cost) ? 1 : -1;
+	return strcmp(fa->text, fb->text);
+}
+
+int
+ln_analyzeComplexity(ln_ctx ctx, FILE *const fp, const unsigned long long maxCalls,
+	int *const nProblems)
+{
+	int r = 0;
+	struct an_ctx *an = NULL;
+	int *path = NULL;
+	const struct an_info *root;
+	char limit[64] = "";
+
+	if(ctx->version == 1) {
+		fprintf(fp, "Rulebase Complexity Analysis\n"
+			    "============================\n"
+			    "not analyzed: version 1 rulebases are processed by the v1 engine\n");
+		if(nProblems != NULL)
+			*nProblems = 0;
+		goto done;
+	}
+	CHKN(an = calloc(1, sizeof(struct an_ctx)));
+	an->ctx = ctx;
+	if(ctx->nTypes > 0) {
+		CHKN(an->typeState = calloc(ctx->nTypes, sizeof(int)));
+		CHKN(path = calloc(ctx->nTypes + 1, sizeof(int)));
+	}
+	CHKN(root = analyzeNode(an, ctx->pdag, NULL));
+	for(int i = 0 ; i < ctx->nTypes ; ++i)
+		CHKN(analyzeNode(an, ctx->type_pdags[i].pdag, ctx->type_pdags[i].name));
+	for(int i = 0 ; i < ctx->nTypes ; ++i) {
+		path[0] = i;
+		an->typeState[i] = 1;
+		CHKR(findLeftRecursion(an, ctx->type_pdags[i].pdag, path, 1, ctx->nTypes));
+		an->typeState[i] = 2;
+	}
+	if(maxCalls > 0 && root->cost > maxCalls) {
+		es_str_t *str;
+		char buf[128];
+		snprintf(buf, sizeof(buf), "worst-case parser calls per message exceed "
+			"the limit of %llu", maxCalls);
+		CHKN(str = newFinding(1, buf, root->cost));
+		addCStr(&str, "\n\theaviest.: rule");
+		addLocation(&str, heaviestRule(an, ctx->pdag));
+		CHKR(addFinding(an, 1, root->cost, str));
+	}
+	if(an->nfindings > 0)
+		qsort(an->findings, an->nfindings, sizeof(struct an_finding), cmpFindings);
+
+	if(maxCalls > 0)
+		snprintf(limit, sizeof(limit), " (limit %llu)", maxCalls);
+	fprintf(fp, "Rulebase Complexity Analysis\n"
+		    "============================\n");
+	if(root->cost == AN_COST_MAX)
+		fprintf(fp, "worst-case parser calls..: unbounded%s\n", limit);
+	else
+		fprintf(fp, "worst-case parser calls..: %" PRIu64 "%s\n", root->cost, limit);
+	fprintf(fp, "problems.................: %d\n", an->nproblems);
+	fprintf(fp, "warnings.................: %d\n", an->nfindings - an->nproblems);
+	fprintf(fp, "Parser calls are counted per message. Repeat bodies and recursive "
+		"types are\ncounted once; their cost also grows with the message length.\n");
+	for(int i = 0 ; i < an->nfindings ; ++i)
+		fprintf(fp, "\n%s\n", an->findings[i].text);
+	if(nProblems != NULL)
+		*nProblems = an->nproblems;
+done:
+	if(an != NULL) {
+		for(int i = 0 ; i < AN_NBUCKETS ; ++i) {
+			struct an_info *info = an->buckets[i];
+			while(info != NULL) {
+				struct an_info *const next = info->next;
+				free(info);
+				info = next;
+			}
+		}
+		for(int i = 0 ; i < an->nfindings ; ++i)
+			free(an->findings[i].text);
+		free(an->findings);
+		free(an->typeState);
+		free(an);
+	}
+	free(path);
+	return r;
+}
@@ -237,3 +237,84 @@ ln_annotate(ln_ctx ctx, struct json_object *json, struct json_object *tagbucket)
 
 done:	return r;
 }
+
+
+int
+ln_compileAnnots(ln_ctx ctx, struct json_object *tagbucket,
+	ln_annot_field **fields, int *nfields)
+{
+	int r = 0;
+	ln_annot *annot;
+	ln_annot_op *op;
+	es_str_t *tag = NULL;
+	struct json_object *tagObj;
+	const char *tagCstr;
+	const char *cstr;
+	ln_annot_field *arr = NULL;
+	ln_annot_field *newarr;
+	int n = 0;
+
+	if(ctx->pas->aroot == NULL)
+		goto done;
+
+	/* same order as in ln_annotate(), so that later fields override
+	 * earlier ones exactly as before.
+	 */
+	for (int i = json_object_array_length(tagbucket) - 1; i >= 0; i--) {
+		CHKN(tagObj = json_object_array_get_idx(tagbucket, i));
+		CHKN(tagCstr = json_object_get_string(tagObj));
+		CHKN(tag = es_newStrFromCStr(tagCstr, strlen(tagCstr)));
+		annot = ln_findAnnot(ctx->pas, tag);
+		es_deleteStr(tag);
+		tag = NULL;
+		if(annot == NULL)
+			continue;
+		for(op = annot->oproot ; op != NULL ; op = op->next) {
+			if(op->opc != ln_annot_ADD)
+				continue; // TODO: implement remove
+			CHKN(newarr = realloc(arr, (n + 1) * sizeof(ln_annot_field)));
+			arr = newarr;
+			ln_annot_field *const field = arr + n++;
+			field->name = NULL;
+			field->value = NULL;
+			CHKN(cstr = ln_es_str2cstr(&op->value));
+			CHKN(field->value = json_object_new_string(cstr));
+			CHKN(cstr = ln_es_str2cstr(&op->name));
+			CHKN(field->name = strdup(cstr));
+		}
+	}
+
+done:
+	if(r != 0) {
+		ln_deleteAnnotFields(arr, n);
+		arr = NULL;
+		n = 0;
+	}
+	*fields = arr;
+	*nfields = n;
+	return r;
+}
+
+
+void
+ln_deleteAnnotFields(ln_annot_field *fields, int nfields)
+{
+	for(int i = 0 ; i < nfields ; ++i) {
+		free((void*)fields[i].name);
+		if(fields[i].value != NULL)
+			json_object_put(fields[i].value);
+	}
+	free(fields);
+}
+
+
+void
+ln_annotateCompiled(struct json_object *json,
+	const ln_annot_field *fields, int nfields)
+{
+	for(int i = 0 ; i < nfields ; ++i) {
+		json_object_get(fields[i].value);
+		json_object_object_add_ex(json, fields[i].name, fields[i].value,
+			JSON_C_OBJECT_KEY_IS_CONSTANT);
+	}
+}
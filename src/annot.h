@@ -35,6 +35,7 @@
 typedef struct ln_annotSet_s ln_annotSet;
 typedef struct ln_annot_s ln_annot;
 typedef struct ln_annot_op_s ln_annot_op;
+typedef struct ln_annot_field_s ln_annot_field;
 typedef enum {ln_annot_ADD=0, ln_annot_RM=1} ln_annot_opcode;
 
 /**
@@ -56,6 +57,16 @@ struct ln_annot_s {
 	ln_annot_op *oproot;
 };
 
+/**
+ * precompiled annotation field, ready to be added to an event.
+ * The value is immutable and shared by all events via its
+ * reference count.
+ */
+struct ln_annot_field_s {
+	const char *name;
+	struct json_object *value;
+};
+
 /**
  * annotation set object
  *
@@ -169,4 +180,45 @@ int ln_addAnnotOp(ln_annot *annot, ln_annot_opcode opc, es_str_t *name, es_str_t
  */
 int ln_annotate(ln_ctx ctx, struct json_object *json, struct json_object *tags);
 
+
+
+/**
+ * Precompile the annotations for a tagbucket.
+ * This resolves all tags inside the bucket to the fields they add,
+ * in the order ln_annotate() would add them. It is called once after
+ * the rulebase has been loaded, so that annotating an event does not
+ * need any lookups or allocations.
+ * @memberof ln_annot
+ *
+ * @param[in] ctx current context
+ * @param[in] tagbucket tags to resolve
+ * @param[out] fields array of fields (NULL if there are none)
+ * @param[out] nfields number of entries in fields
+ * @returns 0 on success, something else otherwise
+ */
+int ln_compileAnnots(ln_ctx ctx, struct json_object *tagbucket,
+	ln_annot_field **fields, int *nfields);
+
+
+/**
+ * Free an array of precompiled annotation fields.
+ * @memberof ln_annot
+ *
+ * @param[in] fields array to free, may be NULL
+ * @param[in] nfields number of entries in fields
+ */
+void ln_deleteAnnotFields(ln_annot_field *fields, int nfields);
+
+
+/**
+ * Annotate an event with precompiled fields.
+ * @memberof ln_annot
+ *
+ * @param[in] json event to annotate
+ * @param[in] fields fields as created by ln_compileAnnots()
+ * @param[in] nfields number of entries in fields
+ */
+void ln_annotateCompiled(struct json_object *json,
+	const ln_annot_field *fields, int nfields);
+
 #endif /* #ifndef LOGNORM_ANNOT_H_INCLUDED */
@@ -0,0 +1,335 @@
+/**
+ * @file btrack.c
+ * @brief Implementation of the backtracking analysis.
+ *
+ * Each backtrack is attributed to a (node, failing parser, matching
+ * sibling) triple. As the sibling is only known once another parser
+ * of the node matched (or all failed), backtracks are first kept on a
+ * small per-thread stack. Triples are counted in an insert-only table
+ * (see lftab.h), keyed by the two parsers (which also identify the
+ * node), so lookups do not lock.
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <libestr.h>
+
+#include "liblognorm.h"
+#include "lognorm.h"
+#include "internal.h"
+#include "pdag.h"
+#include "btrack.h"
+#include "lftab.h"
+
+#define BT_NSLOTS 4096	/* must be power of 2 */
+#define BT_MAX_PENDING 256
+#define BT_MAX_PRIO 65535	/* highest user-assignable priority */
+
+struct bt_slot {
+	const ln_parser_t *prs;		/**< failing parser */
+	const ln_parser_t *sibling;	/**< matching parser, NULL: none */
+	const struct ln_pdag *node;
+	uint64_t count;
+	uint64_t wasted;
+};
+
+struct ln_btrack_s {
+	struct ln_lftab tab;	/**< of struct bt_slot */
+	uint64_t dropped;	/**< backtracks not counted as the table was full */
+};
+
+struct bt_pending {
+	const struct ln_pdag *node;
+	const ln_parser_t *prs;
+	uint64_t wasted;
+};
+
+static __thread struct bt_pending bt_pendingStack[BT_MAX_PENDING];
+static __thread int bt_nPending = 0;
+
+static inline int
+btMatch(const void *const slot, const void *const key)
+{
+	const struct bt_slot *const bs = (const struct bt_slot*) slot;
+	const struct bt_slot *const triple = (const struct bt_slot*) key;
+
+	return bs->prs == triple->prs && bs->sibling == triple->sibling;
+}
+
+static int
+btFill(void *const slot, const void *const key)
+{
+	struct bt_slot *const bs = (struct bt_slot*) slot;
+	const struct bt_slot *const triple = (const struct bt_slot*) key;
+
+	bs->prs = triple->prs;
+	bs->sibling = triple->sibling;
+	bs->node = triple->node;
+	return 0;
+}
+
+ln_btrack*
+ln_newBtrack(void)
+{
+	ln_btrack *bt;
+
+	if((bt = calloc(1, sizeof(struct ln_btrack_s))) == NULL)
+		goto done;
+	if(ln_lftabInit(&bt->tab, BT_NSLOTS, sizeof(struct bt_slot)) != 0) {
+		free(bt);
+		bt = NULL;
+	}
+done:	return bt;
+}
+
+
+void
+ln_deleteBtrack(ln_btrack *const bt)
+{
+	if(bt == NULL)
+		goto done;
+	ln_lftabExit(&bt->tab);
+	free(bt);
+done:	return;
+}
+
+
+static void
+btCount(ln_btrack *const bt, const struct ln_pdag *const node, const ln_parser_t *const prs,
+	const ln_parser_t *const sibling, const uint64_t wasted)
+{
+	struct bt_slot *slot;
+	struct bt_slot key;
+
+	key.prs = prs;
+	key.sibling = sibling;
+	key.node = node;
+	slot = ln_lftabGet(&bt->tab, ln_lftabHashPtrs(prs, sibling), btMatch, btFill, &key);
+	if(slot == NULL) { /* table full */
+		__atomic_fetch_add(&bt->dropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	__atomic_fetch_add(&slot->count, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&slot->wasted, wasted, __ATOMIC_RELAXED);
+}
+
+
+int
+ln_btMark(void)
+{
+	return bt_nPending;
+}
+
+
+void
+ln_btPending(ln_btrack *const bt, const struct ln_pdag *const node,
+	const ln_parser_t *const prs, const uint64_t wasted)
+{
+	if(bt_nPending == BT_MAX_PENDING) {
+		/* very unlikely; the sibling remains unknown */
+		btCount(bt, node, prs, NULL, wasted);
+		return;
+	}
+	bt_pendingStack[bt_nPending].node = node;
+	bt_pendingStack[bt_nPending].prs = prs;
+	bt_pendingStack[bt_nPending].wasted = wasted;
+	++bt_nPending;
+}
+
+
+void
+ln_btResolve(ln_btrack *const bt, const int mark, const ln_parser_t *const sibling)
+{
+	while(bt_nPending > mark) {
+		--bt_nPending;
+		btCount(bt, bt_pendingStack[bt_nPending].node, bt_pendingStack[bt_nPending].prs,
+			sibling, bt_pendingStack[bt_nPending].wasted);
+	}
+}
+
+
+static inline void
+addCStr(es_str_t **const str, const char *const cstr)
+{
+	es_addBuf(str, cstr, strlen(cstr));
+}
+
+static void
+addParser(ln_ctx ctx, es_str_t **const str, const ln_parser_t *const prs)
+{
+	char buf[32];
+
+	ln_addParserDisplayName(ctx, prs, str);
+	const struct ln_pdag *const term = ln_pdagFirstTerminal(prs->node);
+	if(term != NULL && term->rb_file != NULL) {
+		addCStr(str, " (");
+		addCStr(str, term->rb_file);
+		const int len = snprintf(buf, sizeof(buf), ":%u)", term->rb_lineno);
+		es_addBuf(str, buf, len);
+	}
+}
+
+/* user-assigned priorities are configurable for all but the literal
+ * text of rules.
+ */
+static inline int
+prioConfigurable(const ln_parser_t *const prs)
+{
+	return prs->prsid != PRS_LITERAL || prs->name != NULL;
+}
+
+static void
+addSuggestion(ln_ctx ctx, es_str_t **const str, const ln_parser_t *const prs,
+	const ln_parser_t *const sibling)
+{
+	const ln_parser_t *change;
+	const char *what;
+	int prio;
+	char buf[64];
+
+	if(sibling == NULL) {
+		addCStr(str, "none, no other parser matched here");
+		return;
+	}
+	if(prioConfigurable(sibling) && (prs->prio >> 8) > 0) {
+		change = sibling;
+		prio = (prs->prio >> 8) - 1;
+		what = " to try it first";
+	} else if(prioConfigurable(prs) && (sibling->prio >> 8) < BT_MAX_PRIO) {
+		change = prs;
+		prio = (sibling->prio >> 8) + 1;
+		what = " to try it last";
+	} else {
+		addCStr(str, "none, priorities of literal text cannot be changed");
+		return;
+	}
+	snprintf(buf, sizeof(buf), "\"priority\":%d for ", prio);
+	addCStr(str, buf);
+	ln_addParserDisplayName(ctx, change, str);
+	addCStr(str, what);
+}
+
+struct bt_entry {
+	const struct bt_slot *slot;
+	uint64_t count;
+	uint64_t wasted;
+	char *text;	/**< rendered triple and suggestion */
+};
+
+/* most wasted calls first; text makes the order deterministic */
+static int
+cmpEntries(const void *const a, const void *const b)
+{
+	const struct bt_entry *const ea = (const struct bt_entry*) a;
+	const struct bt_entry *const eb = (const struct bt_entry*) b;
+
+	if(ea->wasted != eb->wasted)
+		return (ea->wasted < eb->wasted) ? 1 : -1;
+	if(ea->count != eb->count)
+		return (ea->count < eb->count) ? 1 : -1;
+	return strcmp(ea->text, eb->text);
+}
+
+static char *
+renderEntry(ln_ctx ctx, const struct bt_slot *const slot)
+{
+	es_str_t *str;
+	char *text = NULL;
+
+	if((str = es_newStr(256)) == NULL)
+		goto done;
+	addCStr(&str, "\tnode.....: ");
+	if(slot->node->rb_id == NULL || slot->node->rb_id[0] == '\0') {
+		addCStr(&str, "(start)");
+	} else {
+		es_addChar(&str, '\'');
+		addCStr(&str, slot->node->rb_id);
+		es_addChar(&str, '\'');
+	}
+	addCStr(&str, "\n\tfailing..: ");
+	addParser(ctx, &str, slot->prs);
+	addCStr(&str, "\n\tmatching.: ");
+	if(slot->sibling == NULL)
+		es_addChar(&str, '-');
+	else
+		addParser(ctx, &str, slot->sibling);
+	addCStr(&str, "\n\tsuggest..: ");
+	addSuggestion(ctx, &str, slot->prs, slot->sibling);
+	text = es_str2cstr(str, NULL);
+	es_deleteStr(str);
+done:	return text;
+}
+
+int
+ln_btWriteReport(ln_btrack *const bt, ln_ctx ctx, FILE *const fp, const int maxEntries)
+{
+	int r = 0;
+	struct bt_entry *entries = NULL;
+	int nentries = 0;
+	uint64_t count = 0;
+	uint64_t wasted = 0;
+
+	fprintf(fp, "Backtracking Hotspots\n"
+		    "=====================\n");
+	if(bt != NULL) {
+		const int nEntries = ln_lftabNumEntries(&bt->tab);
+		CHKN(entries = calloc(nEntries + 1, sizeof(struct bt_entry)));
+		for(size_t i = 0 ; i < BT_NSLOTS && nentries < nEntries ; ++i) {
+			const struct bt_slot *const slot = ln_lftabEntry(&bt->tab, i);
+			if(slot == NULL)
+				continue;
+			struct bt_entry *const entry = entries + nentries;
+			entry->slot = slot;
+			entry->count = __atomic_load_n(&slot->count, __ATOMIC_RELAXED);
+			entry->wasted = __atomic_load_n(&slot->wasted, __ATOMIC_RELAXED);
+			CHKN(entry->text = renderEntry(ctx, slot));
+			++nentries;
+			count += entry->count;
+			wasted += entry->wasted;
+		}
+		qsort(entries, nentries, sizeof(struct bt_entry), cmpEntries);
+	}
+	fprintf(fp, "backtracks...........: %" PRIu64 "\n", count);
+	fprintf(fp, "wasted parser calls..: %" PRIu64 "\n", wasted);
+	if(bt != NULL && bt->dropped > 0)
+		fprintf(fp, "not analyzed.........: %" PRIu64 " (too many distinct cases)\n",
+			bt->dropped);
+	const int nprint = (maxEntries > 0 && maxEntries < nentries) ? maxEntries : nentries;
+	fprintf(fp, "Top %d of %d cases (node, failing parser, matching parser) by wasted "
+		"parser calls.\nNote: suggested priorities change the matching order. If a "
+		"message matches via\nboth parsers, a different rule may then match it.\n",
+		nprint, nentries);
+	for(int i = 0 ; i < nprint ; ++i) {
+		fprintf(fp, "\n#%d: %" PRIu64 " backtracks, %" PRIu64 " wasted parser calls\n%s\n",
+			i + 1, entries[i].count, entries[i].wasted, entries[i].text);
+	}
+done:
+	if(entries != NULL) {
+		for(int i = 0 ; i < nentries ; ++i)
+			free(entries[i].text);
+		free(entries);
+	}
+	return r;
+}
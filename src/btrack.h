@@ -0,0 +1,105 @@
+/**
+ * @file btrack.h
+ * @brief Backtracking analysis of the normalizer
+ * @class ln_btrack btrack.h
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#ifndef LIBLOGNORM_BTRACK_H_INCLUDED
+#define	LIBLOGNORM_BTRACK_H_INCLUDED
+#include <stdio.h>
+#include <stdint.h>
+
+typedef struct ln_btrack_s ln_btrack;
+struct ln_parser_s;
+struct ln_pdag;
+
+/**
+ * Allocates and initializes a new, empty backtracking analysis.
+ * @memberof ln_btrack
+ *
+ * @return pointer to new object or NULL on error
+ */
+ln_btrack* ln_newBtrack(void);
+
+
+/**
+ * Free backtracking analysis.
+ * @memberof ln_btrack
+ *
+ * @param[in] bt object to free, may be NULL
+ */
+void ln_deleteBtrack(ln_btrack *bt);
+
+
+/**
+ * Obtain the current height of the calling thread's stack of
+ * backtracks not yet resolved. A pdag node remembers it on entry and
+ * resolves everything above it.
+ * @memberof ln_btrack
+ */
+int ln_btMark(void);
+
+
+/**
+ * Note a backtrack: a parser matched, but the subtree following it
+ * did not. Which sibling matches instead (if any) is only known
+ * later, see ln_btResolve(). This may be called concurrently by
+ * multiple threads.
+ * @memberof ln_btrack
+ *
+ * @param[in] bt backtracking analysis
+ * @param[in] node node the parser belongs to
+ * @param[in] prs parser whose subtree failed
+ * @param[in] wasted parser calls done for nothing (including prs)
+ */
+void ln_btPending(ln_btrack *bt, const struct ln_pdag *node,
+	const struct ln_parser_s *prs, uint64_t wasted);
+
+
+/**
+ * Attribute all backtracks noted since mark to the parser that
+ * eventually matched.
+ * @memberof ln_btrack
+ *
+ * @param[in] bt backtracking analysis
+ * @param[in] mark stack height as obtained by ln_btMark()
+ * @param[in] sibling matching parser, NULL if none (the node ended
+ *            the match or failed)
+ */
+void ln_btResolve(ln_btrack *bt, int mark, const struct ln_parser_s *sibling);
+
+
+/**
+ * Write the report: the (node, failing parser, matching sibling)
+ * triples that wasted most parser calls, with rule locations and
+ * suggested priority changes.
+ * @memberof ln_btrack
+ *
+ * @param[in] bt backtracking analysis, may be NULL (nothing recorded)
+ * @param[in] ctx context the parsers belong to
+ * @param[in] fp file to write to
+ * @param[in] maxEntries maximum number of triples to list, 0: all
+ * @return 0 on success, something else otherwise
+ */
+int ln_btWriteReport(ln_btrack *bt, struct ln_ctx_s *ctx, FILE *fp, int maxEntries);
+
+#endif /* #ifndef LIBLOGNORM_BTRACK_H_INCLUDED */
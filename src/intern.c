@@ -0,0 +1,147 @@
+/**
+ * @file intern.c
+ * @brief Implementation of the intern table.
+ *
+ * The values are kept in an insert-only table (see lftab.h), so readers
+ * do not lock. Once the entry limit is reached, no further values are
+ * added, which also bounds memory use if a field turns out not to be
+ * low-cardinality at all.
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <json.h>
+
+#include "intern.h"
+#include "lftab.h"
+
+#define INTERN_NSLOTS 4096	/* must be power of 2 */
+#define INTERN_MAX_LEN 64	/* longer values are unlikely to recur */
+
+struct intern_slot {
+	struct json_object *val;
+	uint32_t hash;
+	uint32_t len;
+};
+
+struct intern_key {
+	const char *str;
+	size_t len;
+	uint32_t hash;
+};
+
+struct ln_intern_s {
+	struct ln_lftab tab;
+};
+
+static inline uint32_t
+internHash(const char *const str, const size_t len)
+{
+	uint32_t h = 2166136261u; /* FNV-1a */
+	for(size_t i = 0 ; i < len ; ++i) {
+		h ^= (unsigned char) str[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static inline int
+internMatch(const void *const slot, const void *const key)
+{
+	const struct intern_slot *const is = (const struct intern_slot*) slot;
+	const struct intern_key *const ik = (const struct intern_key*) key;
+
+	return is->hash == ik->hash && is->len == ik->len
+		&& !memcmp(json_object_get_string(is->val), ik->str, ik->len);
+}
+
+static int
+internFill(void *const slot, const void *const key)
+{
+	struct intern_slot *const is = (struct intern_slot*) slot;
+	const struct intern_key *const ik = (const struct intern_key*) key;
+
+	if((is->val = json_object_new_string_len(ik->str, ik->len)) == NULL)
+		return -1;
+	is->hash = ik->hash;
+	is->len = (uint32_t) ik->len;
+	return 0;
+}
+
+ln_intern*
+ln_newIntern(void)
+{
+	ln_intern *it;
+
+	if((it = calloc(1, sizeof(struct ln_intern_s))) == NULL)
+		goto done;
+	if(ln_lftabInit(&it->tab, INTERN_NSLOTS, sizeof(struct intern_slot)) != 0) {
+		free(it);
+		it = NULL;
+	}
+done:	return it;
+}
+
+
+void
+ln_deleteIntern(ln_intern *it)
+{
+	if(it == NULL)
+		goto done;
+
+	for(size_t i = 0 ; i < INTERN_NSLOTS ; ++i) {
+		const struct intern_slot *const is = ln_lftabEntry(&it->tab, i);
+		if(is != NULL)
+			json_object_put(is->val);
+	}
+	ln_lftabExit(&it->tab);
+	free(it);
+done:	return;
+}
+
+
+struct json_object*
+ln_internStr(ln_intern *it, const char *str, size_t len)
+{
+	const struct intern_slot *is;
+	struct intern_key key;
+
+	if(len > INTERN_MAX_LEN)
+		return json_object_new_string_len(str, len);
+
+	key.str = str;
+	key.len = len;
+	key.hash = internHash(str, len);
+	is = ln_lftabGet(&it->tab, key.hash, internMatch, internFill, &key);
+	if(is == NULL) /* table full */
+		return json_object_new_string_len(str, len);
+	return json_object_get(is->val);
+}
+
+
+int
+ln_internNumEntries(ln_intern *it)
+{
+	return (it == NULL) ? 0 : ln_lftabNumEntries(&it->tab);
+}
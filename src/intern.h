@@ -0,0 +1,73 @@
+/**
+ * @file intern.h
+ * @brief Table of shared json strings for recurring field values
+ * @class ln_intern intern.h
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#ifndef LIBLOGNORM_INTERN_H_INCLUDED
+#define	LIBLOGNORM_INTERN_H_INCLUDED
+#include <stddef.h>
+
+typedef struct ln_intern_s ln_intern;
+
+/**
+ * Allocates and initializes a new, empty intern table.
+ * @memberof ln_intern
+ *
+ * @return pointer to new table or NULL on error
+ */
+ln_intern* ln_newIntern(void);
+
+
+/**
+ * Free intern table and release all strings held by it.
+ * Strings still referenced by events stay valid.
+ * @memberof ln_intern
+ *
+ * @param[in] it table to free, may be NULL
+ */
+void ln_deleteIntern(ln_intern *it);
+
+
+/**
+ * Obtain a json string for the given value.
+ * Recurring values are served from the table as shared json string,
+ * with its reference count incremented. If the value is too long or
+ * the table is full, a new string is created instead. Lookups do not
+ * lock, so this may be called concurrently by multiple threads.
+ * @memberof ln_intern
+ *
+ * @param[in] it intern table
+ * @param[in] str value (need not be NUL-terminated)
+ * @param[in] len length of value
+ * @return json string object (caller owns one reference) or NULL on error
+ */
+struct json_object* ln_internStr(ln_intern *it, const char *str, size_t len);
+
+
+/**
+ * Number of distinct values currently held by the table.
+ * @memberof ln_intern
+ */
+int ln_internNumEntries(ln_intern *it);
+
+#endif /* #ifndef LIBLOGNORM_INTERN_H_INCLUDED */
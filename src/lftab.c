@@ -0,0 +1,87 @@
+/**
+ * @file lftab.c
+ * @brief Implementation of the insert-only hash table.
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "lftab.h"
+
+int
+ln_lftabInit(struct ln_lftab *const tab, const size_t nSlots, const size_t slotSize)
+{
+	tab->used = calloc(nSlots, 1);
+	tab->slots = calloc(nSlots, slotSize);
+	if(tab->used == NULL || tab->slots == NULL) {
+		free(tab->used);
+		free(tab->slots);
+		return -1;
+	}
+	tab->slotSize = slotSize;
+	tab->mask = nSlots - 1;
+	tab->nEntries = 0;
+	tab->maxEntries = (int) (nSlots / 2);
+	pthread_mutex_init(&tab->mut, NULL);
+	return 0;
+}
+
+
+void
+ln_lftabExit(struct ln_lftab *const tab)
+{
+	pthread_mutex_destroy(&tab->mut);
+	free(tab->used);
+	free(tab->slots);
+}
+
+
+void *
+ln_lftabAdd(struct ln_lftab *const tab, const size_t hash, const ln_lftabMatch match,
+	const ln_lftabFill fill, const void *const key)
+{
+	void *slot = NULL;
+	size_t idx;
+
+	if(__atomic_load_n(&tab->nEntries, __ATOMIC_RELAXED) >= tab->maxEntries)
+		return NULL;
+
+	pthread_mutex_lock(&tab->mut);
+	/* someone else may have added it in the mean time; as we hold the
+	 * lock, the probe also ends at the slot to fill */
+	for(idx = hash & tab->mask ; tab->used[idx] ; idx = (idx + 1) & tab->mask) {
+		if(match(tab->slots + idx * tab->slotSize, key)) {
+			slot = tab->slots + idx * tab->slotSize;
+			goto done;
+		}
+	}
+	if(tab->nEntries < tab->maxEntries
+	   && fill(tab->slots + idx * tab->slotSize, key) == 0) {
+		slot = tab->slots + idx * tab->slotSize;
+		__atomic_store_n(tab->used + idx, 1, __ATOMIC_RELEASE);
+		__atomic_store_n(&tab->nEntries, tab->nEntries + 1, __ATOMIC_RELAXED);
+	}
+done:
+	pthread_mutex_unlock(&tab->mut);
+	return slot;
+}
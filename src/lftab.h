@@ -0,0 +1,146 @@
+/**
+ * @file lftab.h
+ * @brief Insert-only hash table with lock-free lookups
+ *
+ * An open addressing hash of fixed size for tables that are read far
+ * more often than added to, like the intern table. Entries are only
+ * ever added, never removed or moved, until the table is destroyed.
+ * So readers can probe it without locking: a slot is published by
+ * setting its used flag last, with release semantics.
+ * Only inserts are serialized by a mutex. At most half of the slots
+ * are filled, which keeps probe sequences short; once this limit is
+ * reached, no further entries are added.
+ *
+ * Slots are of a size given by the user, who also provides functions
+ * to match a key against a slot and to fill a new slot for a key.
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#ifndef LIBLOGNORM_LFTAB_H_INCLUDED
+#define	LIBLOGNORM_LFTAB_H_INCLUDED
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+struct ln_lftab {
+	unsigned char *used;	/**< per slot: set last when filled */
+	unsigned char *slots;	/**< slotSize bytes per slot */
+	size_t slotSize;
+	size_t mask;		/**< number of slots - 1 */
+	int nEntries;
+	int maxEntries;
+	pthread_mutex_t mut;
+};
+
+/** check if a filled slot holds key */
+typedef int (*ln_lftabMatch)(const void *slot, const void *key);
+/** fill a free slot for key; returns 0 on success */
+typedef int (*ln_lftabFill)(void *slot, const void *key);
+
+/**
+ * Initialize an empty table.
+ *
+ * @param[in] tab table to initialize
+ * @param[in] nSlots number of slots, must be a power of 2
+ * @param[in] slotSize size of a slot
+ * @return 0 on success, something else otherwise
+ */
+int ln_lftabInit(struct ln_lftab *tab, size_t nSlots, size_t slotSize);
+
+/**
+ * Free the memory of a table. Anything the slots refer to must have
+ * been released by the caller.
+ */
+void ln_lftabExit(struct ln_lftab *tab);
+
+/**
+ * Add key to the table, unless another thread did so in the mean time.
+ *
+ * @return the slot of key, NULL if the table is full or fill failed
+ */
+void *ln_lftabAdd(struct ln_lftab *tab, size_t hash, ln_lftabMatch match,
+	ln_lftabFill fill, const void *key);
+
+/** hash for keys that consist of two pointers */
+static inline size_t
+ln_lftabHashPtrs(const void *const a, const void *const b)
+{
+	uint64_t h = (uintptr_t) a * 0x9E3779B97F4A7C15ull;
+	h ^= (uintptr_t) b;
+	h *= 0xC2B2AE3D27D4EB4Full;
+	return (size_t) (h >> 32);
+}
+
+static inline size_t
+ln_lftabNumSlots(const struct ln_lftab *const tab)
+{
+	return tab->mask + 1;
+}
+
+static inline int
+ln_lftabNumEntries(struct ln_lftab *const tab)
+{
+	return __atomic_load_n(&tab->nEntries, __ATOMIC_RELAXED);
+}
+
+/** obtain slot idx, NULL if it is not filled (yet) */
+static inline void *
+ln_lftabEntry(struct ln_lftab *const tab, const size_t idx)
+{
+	if(!__atomic_load_n(tab->used + idx, __ATOMIC_ACQUIRE))
+		return NULL;
+	return tab->slots + idx * tab->slotSize;
+}
+
+/**
+ * Find key without locking, probing from its hash slot.
+ *
+ * @return the slot of key, NULL if not present
+ */
+static inline void *
+ln_lftabFind(struct ln_lftab *const tab, const size_t hash, const ln_lftabMatch match,
+	const void *const key)
+{
+	void *slot;
+
+	for(size_t idx = hash & tab->mask ; (slot = ln_lftabEntry(tab, idx)) != NULL
+	    ; idx = (idx + 1) & tab->mask) {
+		if(match(slot, key))
+			return slot;
+	}
+	return NULL;
+}
+
+/**
+ * Find key, add it if not present. This may be called concurrently by
+ * multiple threads.
+ *
+ * @return the slot of key, NULL if it is not present and can not be added
+ */
+static inline void *
+ln_lftabGet(struct ln_lftab *const tab, const size_t hash, const ln_lftabMatch match,
+	const ln_lftabFill fill, const void *const key)
+{
+	void *const slot = ln_lftabFind(tab, hash, match, key);
+	return (slot != NULL) ? slot : ln_lftabAdd(tab, hash, match, fill, key);
+}
+
+#endif /* #ifndef LIBLOGNORM_LFTAB_H_INCLUDED */
@@ -34,6 +34,7 @@
 #include "samp.h"
 #include "v1_liblognorm.h"
 #include "v1_ptree.h"
+#include "internal.h"
 
 #define CHECK_CTX \
 	if(ctx->objID != LN_ObjID_CTX) { \
@@ -100,6 +101,162 @@ ln_setCtxOpts(ln_ctx ctx, const unsigned opts) {
 }
 
 
+int
+ln_setFieldProjection(ln_ctx ctx, const char *const *names, const int nnames)
+{
+	int r = 0;
+	struct json_object *projection = NULL;
+
+	CHECK_CTX;
+	if(names != NULL) {
+		CHKN(projection = json_object_new_object());
+		for(int i = 0 ; i < nnames ; ++i) {
+			struct json_object *const val = json_object_new_boolean(1);
+			if(val == NULL) {
+				json_object_put(projection);
+				FAIL(LN_NOMEM);
+			}
+			json_object_object_add(projection, names[i], val);
+		}
+	}
+	if(ctx->projection != NULL)
+		json_object_put(ctx->projection);
+	ctx->projection = projection;
+	/* apply to already loaded rules; later loads apply it on optimize */
+	if(ctx->pdag != NULL)
+		ln_pdagApplyProjection(ctx);
+done:
+	return r;
+}
+
+
+int
+ln_setWorkBudget(ln_ctx ctx, const unsigned maxParserCalls, const unsigned maxBacktracks,
+	const size_t maxBytes, const unsigned long long deadlineUsec)
+{
+	int r = 0;
+
+	CHECK_CTX;
+	ctx->budget.parserCalls = maxParserCalls;
+	ctx->budget.backtracks = maxBacktracks;
+	ctx->budget.bytes = maxBytes;
+	ctx->budget.deadlineNs = deadlineUsec * 1000;
+	ctx->budget.active = maxParserCalls != 0 || maxBacktracks != 0
+		|| maxBytes != 0 || deadlineUsec != 0;
+done:
+	return r;
+}
+
+
+int
+ln_setTelemetry(ln_ctx ctx, const int enabled)
+{
+	int r = 0;
+
+	CHECK_CTX;
+	if(enabled && ctx->telemetry == NULL) {
+		CHKN(ctx->telemetry = ln_newTelemetry());
+	}
+	/* publishes ctx->telemetry to normalizing threads */
+	__atomic_store_n(&ctx->telemetryOn, enabled ? 1 : 0, __ATOMIC_RELEASE);
+done:
+	return r;
+}
+
+
+int
+ln_setLatencySampling(ln_ctx ctx, const unsigned every)
+{
+	int r = 0;
+
+	CHECK_CTX;
+	__atomic_store_n(&ctx->latencySampling, every, __ATOMIC_RELAXED);
+done:
+	return r;
+}
+
+
+int
+ln_setPathProfiling(ln_ctx ctx, const int enabled)
+{
+	int r = 0;
+
+	CHECK_CTX;
+	if(enabled && ctx->pathprof == NULL) {
+		CHKN(ctx->pathprof = ln_newPathProf());
+	}
+	/* publishes ctx->pathprof to normalizing threads */
+	__atomic_store_n(&ctx->pathprofOn, enabled ? 1 : 0, __ATOMIC_RELEASE);
+done:
+	return r;
+}
+
+
+int
+ln_writeFoldedStacks(ln_ctx ctx, FILE *const fp)
+{
+	int r = 0;
+
+	CHECK_CTX;
+	r = ln_ppWriteFolded(ctx->pathprof, ctx, fp);
+done:
+	return r;
+}
+
+
+int
+ln_setBacktrackAnalysis(ln_ctx ctx, const int enabled)
+{
+	int r = 0;
+
+	CHECK_CTX;
+	if(enabled && ctx->btrack == NULL) {
+		CHKN(ctx->btrack = ln_newBtrack());
+	}
+	/* publishes ctx->btrack to normalizing threads */
+	__atomic_store_n(&ctx->btrackOn, enabled ? 1 : 0, __ATOMIC_RELEASE);
+done:
+	return r;
+}
+
+
+int
+ln_writeBacktrackReport(ln_ctx ctx, FILE *const fp, const int maxEntries)
+{
+	int r = 0;
+
+	CHECK_CTX;
+	r = ln_btWriteReport(ctx->btrack, ctx, fp, maxEntries);
+done:
+	return r;
+}
+
+
+int
+ln_telemetrySnapshot(ln_ctx ctx, const int reset, struct json_object **json_p)
+{
+	int r = 0;
+	struct ln_tm_shard sum;
+	struct json_object *latency;
+
+	*json_p = NULL;
+	CHECK_CTX;
+	if(ctx->telemetry == NULL)
+		memset(&sum, 0, sizeof(sum));
+	else
+		ln_tmSum(ctx->telemetry, &sum, reset);
+	CHKN(*json_p = ln_tmToJSON(&sum));
+	if((r = ln_pdagLatencyToJSON(ctx, reset, &latency)) != 0) {
+		json_object_put(*json_p);
+		*json_p = NULL;
+		goto done;
+	}
+	json_object_object_add(*json_p, "latency", latency);
+done:
+	return r;
+}
+
+
 int
 ln_exitCtx(ln_ctx ctx)
 {
@@ -124,6 +281,15 @@ ln_exitCtx(ln_ctx ctx)
 		es_deleteStr(ctx->rulePrefix);
 	if(ctx->pas != NULL)
 		ln_deleteAnnotSet(ctx->pas);
+	ln_deleteIntern(ctx->intern);
+	if(ctx->projection != NULL)
+		json_object_put(ctx->projection);
+	if(ctx->ruleIDs != NULL)
+		json_object_put(ctx->ruleIDs);
+	free(ctx->terminals);
+	ln_deleteTelemetry(ctx->telemetry);
+	ln_deletePathProf(ctx->pathprof);
+	ln_deleteBtrack(ctx->btrack);
 	free(ctx);
 done:
 	return r;
@@ -61,6 +61,7 @@
 #ifndef LIBLOGNORM_H_INCLUDED
 #define LIBLOGNORM_H_INCLUDED
 #include <stdlib.h>	/* we need size_t */
+#include <stdio.h>	/* we need FILE */
 #include <json.h>
 
 /* error codes */
@@ -145,6 +146,15 @@ int ln_exitCtx(ln_ctx ctx);
 					          (not just in error case) */
 #define LN_CTXOPT_ADD_RULE		0x08 /**< add mockup rule */
 #define LN_CTXOPT_ADD_RULE_LOCATION	0x10 /**< add rule location (file, lineno) to metadata */
+#define LN_CTXOPT_ADD_RULE_ID		0x20 /**< add numeric rule id to metadata */
+
+/* Each rule has a numeric id, which stays the same as long as the rule
+ * is not changed. It is either given explicitly ("id=<n>" in the tag
+ * list of the rule, 1 <= n <= LN_RULEID_MAX_EXPLICIT) or derived from
+ * the match description; derived ids are always above
+ * LN_RULEID_MAX_EXPLICIT. 0 means "no rule".
+ */
+#define LN_RULEID_MAX_EXPLICIT 0x7fffffffu
 /**
  * Set options on ctx.
  *
@@ -155,6 +165,251 @@ void
 ln_setCtxOpts(ln_ctx ctx, unsigned opts);
 
 
+/**
+ * Extract only the given fields.
+ *
+ * By default, all named fields of the matching rule are extracted. With
+ * a field projection set, only fields whose name is contained in names
+ * are extracted (and thus present in events and records). All other
+ * parsers only check that the message matches, without creating a value.
+ * This applies to the fields of rules. Values of user-defined types are
+ * built completely if their field is wanted. Fields named "." (whose
+ * members are merged into the event) are always extracted.
+ *
+ * The projection can be set before or after loading the rulebase. It
+ * must not be changed while messages are being normalized.
+ *
+ * @param[in] ctx The library context to modify.
+ * @param[in] names array of wanted field names, NULL to extract all
+ *                  fields again
+ * @param[in] nnames number of entries in names
+ *
+ * @return Returns zero on success, something else otherwise.
+ */
+int ln_setFieldProjection(ln_ctx ctx, const char *const *names, int nnames);
+
+
+/* reasons why normalization of a message was aborted, see ln_setWorkBudget() */
+#define LN_BUDGET_PARSER_CALLS	1 /**< too many parser calls */
+#define LN_BUDGET_BACKTRACKS	2 /**< too many backtracks */
+#define LN_BUDGET_BYTES		3 /**< too many bytes matched by parsers */
+#define LN_BUDGET_DEADLINE	4 /**< took too long */
+/**
+ * Limit the work done per message.
+ *
+ * A pathological message can make the normalizer explore a huge number
+ * of paths through the parse DAG. With a work budget, normalization of
+ * a message is aborted as soon as one of the limits is exceeded. The
+ * message is then reported as not matched, i.e. with "unparsed-data".
+ * The event gets metadata "budget-exceeded" with the name of the limit
+ * ("parser_calls", "backtracks", "bytes" or "deadline"), for records
+ * use ln_recordBudgetExceeded(). With telemetry on, aborted messages
+ * are counted per limit.
+ *
+ * The limits are inclusive: a message may take at most maxParserCalls
+ * parser calls and maxBacktracks backtracks, and its parser calls may
+ * match at most maxBytes bytes in total. Bytes are counted for every
+ * successful parser call, so text that is matched again after
+ * backtracking is counted again. The parser call limit is checked
+ * before each parser call; the backtrack and byte limits are checked
+ * before each parser call and again before a rule is accepted as
+ * match, so a matched message never exceeds them. The deadline is
+ * checked every 64 parser calls with the monotonic clock, so it may be
+ * overrun by the time these take.
+ *
+ * The budget can be set before or after loading the rulebase. It must
+ * not be changed while messages are being normalized. It does not apply
+ * to v1 rulebases.
+ *
+ * @param[in] ctx The library context to modify.
+ * @param[in] maxParserCalls parser calls per message, 0: unlimited
+ * @param[in] maxBacktracks backtracks per message, 0: unlimited
+ * @param[in] maxBytes bytes matched per message, 0: unlimited
+ * @param[in] deadlineUsec time per message in microseconds, 0: unlimited
+ *
+ * @return Returns zero on success, something else otherwise.
+ */
+int ln_setWorkBudget(ln_ctx ctx, unsigned maxParserCalls, unsigned maxBacktracks,
+	size_t maxBytes, unsigned long long deadlineUsec);
+
+
+/**
+ * Switch runtime telemetry on or off.
+ *
+ * With telemetry on, the normalizer counts messages, parser calls
+ * (overall and per parser type), timestamp cache hits as well as
+ * path length, backtracking and parser call histograms. Counters are
+ * kept per context and are sharded per thread, so concurrent
+ * normalization scales. When off, the cost is a single check per
+ * message and parser call.
+ *
+ * Telemetry may be switched while other threads normalize messages,
+ * but this function itself must not be called concurrently. Counters
+ * are kept when it is switched off.
+ *
+ * @param[in] ctx The library context.
+ * @param[in] enabled non-zero to switch telemetry on, 0 to switch it off
+ *
+ * @return Returns zero on success, something else otherwise.
+ */
+int ln_setTelemetry(ln_ctx ctx, int enabled);
+
+/**
+ * Set latency sampling.
+ *
+ * While telemetry is on (see ln_setTelemetry()), every Nth message of
+ * each thread is timed with the monotonic clock. The time spent in the
+ * normalization call is attributed to the rule that matched, or to
+ * "unparsed". Per rule, a log-linear histogram is kept, from which the
+ * 50th and 99th percentiles are derived with a relative error of at
+ * most 12.5%; the maximum is exact. Timing costs two clock reads per
+ * sampled message, so for production use N should be large enough
+ * to make this negligible. Sampling is off by default.
+ *
+ * This may be called while other threads normalize messages.
+ *
+ * @param[in] ctx The library context.
+ * @param[in] every sampling interval N, 0 switches sampling off
+ *
+ * @return Returns zero on success, something else otherwise.
+ */
+int ln_setLatencySampling(ln_ctx ctx, unsigned every);
+
+/**
+ * Switch execution path profiling on or off.
+ *
+ * With profiling on, the normalizer records which parsers it calls
+ * via which path through the parse DAG, including paths that are
+ * abandoned by backtracking. Calls are aggregated per distinct path
+ * over all messages; ln_writeFoldedStacks() outputs the result. This
+ * is meant for analysing rulebases: it is much more costly than
+ * telemetry, as each parser call involves a hash lookup.
+ *
+ * Profiling may be switched while other threads normalize messages,
+ * but this function itself must not be called concurrently. The
+ * profile is kept when it is switched off.
+ *
+ * @param[in] ctx The library context.
+ * @param[in] enabled non-zero to switch profiling on, 0 to switch it off
+ *
+ * @return Returns zero on success, something else otherwise.
+ */
+int ln_setPathProfiling(ln_ctx ctx, int enabled);
+
+/**
+ * Write the execution path profile in folded-stack format.
+ *
+ * This is the input format of flame graph tools (e.g. flamegraph.pl).
+ * Each line is one path: the parsers called along it, separated by
+ * semicolons, followed by a space and the number of calls of the last
+ * parser via this path. So the width of a frame in the flame graph is
+ * the number of parser calls done in it and in all paths below it.
+ * Parsers are named like in the rule, e.g. "%ip:ipv4%"; unnamed
+ * literals by their text in single quotes. A frame for a parser whose subtree failed
+ * to match at least once is marked "[backtracked N]", where N is the
+ * number of times this happened.
+ *
+ * @param[in] ctx The library context.
+ * @param[in] fp file to write to
+ *
+ * @return Returns zero on success, something else otherwise.
+ */
+int ln_writeFoldedStacks(ln_ctx ctx, FILE *fp);
+
+/**
+ * Switch backtracking analysis on or off.
+ *
+ * With the analysis on, each backtrack (a parser matched, but no rule
+ * could be matched after it) is attributed to the node, the failing
+ * parser and the parser of the same node that eventually matched
+ * instead, if any. Per such case, the backtracks and the parser calls
+ * wasted by them are counted. ln_writeBacktrackReport() lists the
+ * worst cases. This is meant for analysing rulebases.
+ *
+ * The analysis may be switched while other threads normalize
+ * messages, but this function itself must not be called concurrently.
+ * Counts are kept when it is switched off.
+ *
+ * @param[in] ctx The library context.
+ * @param[in] enabled non-zero to switch the analysis on, 0 to switch it off
+ *
+ * @return Returns zero on success, something else otherwise.
+ */
+int ln_setBacktrackAnalysis(ln_ctx ctx, int enabled);
+
+/**
+ * Write the backtracking report.
+ *
+ * Cases are listed by wasted parser calls, worst first. For each one,
+ * the node (as the rule part leading to it), the failing and the
+ * matching parser with the location of a rule following each of them
+ * is given. Where possible, a priority change is suggested that makes
+ * the matching parser be tried first, which avoids the backtrack.
+ * Note that this changes which rule matches messages that can be
+ * matched via both parsers.
+ *
+ * @param[in] ctx The library context.
+ * @param[in] fp file to write to
+ * @param[in] maxEntries maximum number of cases to list, 0 for all
+ *
+ * @return Returns zero on success, something else otherwise.
+ */
+int ln_writeBacktrackReport(ln_ctx ctx, FILE *fp, int maxEntries);
+
+/**
+ * Analyze the worst-case complexity of the loaded rulebase.
+ *
+ * This is a static analysis of the parse DAG, done without any
+ * message. It computes an upper bound of the parser calls a single
+ * message can cause and reports constructs which make the normalizer
+ * backtrack or worse:
+ *
+ * - sibling parsers (or alternative branches) which can match the
+ *   same text, so that the second one is tried if the rule after the
+ *   first one does not match
+ * - the same custom type entered several times at the same offset
+ * - repeat parsers nested inside each other, whose cost grows
+ *   polynomially with the message length
+ * - repeats whose body and while condition can both match empty
+ *   text, which never end (problem)
+ * - custom types re-entering themselves at the same offset, i.e. left
+ *   recursion, which never ends (problem)
+ * - more worst-case parser calls than maxCalls (problem)
+ *
+ * Each finding comes with the location of a rule it affects. The
+ * analysis is coarse: it errs on the side of reporting. It is meant
+ * as a gate for rulebase changes, e.g. in CI, so that a single bad
+ * rule does not go unnoticed.
+ *
+ * @param[in] ctx The library context, with rulebase loaded.
+ * @param[in] fp file to write the report to
+ * @param[in] maxCalls parser call limit per message, 0 for none
+ * @param[out] nProblems number of problems found, may be NULL
+ *
+ * @return Returns zero on success, something else otherwise.
+ */
+int ln_analyzeComplexity(ln_ctx ctx, FILE *fp, unsigned long long maxCalls, int *nProblems);
+
+/**
+ * Obtain the current telemetry counters.
+ *
+ * This can be called at any time, also while other threads normalize
+ * messages. If telemetry was never enabled, all counters are zero.
+ * The "latency" member contains the sampled latencies (see
+ * ln_setLatencySampling()).
+ *
+ * @param[in] ctx The library context.
+ * @param[in] reset if non-zero, counters are reset to zero. No count
+ *                  is lost: each one is either contained in this
+ *                  snapshot or in the next one.
+ * @param[out] json_p The counters as json object. <b>Must be
+ *                    destructed if no longer needed.</b>
+ *
+ * @return Returns zero on success, something else otherwise.
+ */
+int ln_telemetrySnapshot(ln_ctx ctx, int reset, struct json_object **json_p);
+
+
 /**
  * Set a debug message handler (callback).
  *
@@ -264,4 +519,241 @@ int ln_loadSamplesFromString(ln_ctx ctx, const char *string);
  */
 int ln_normalize(ln_ctx ctx, const char *str, const size_t strLen, struct json_object **json_p);
 
+/**
+ * Classify a message: find the matching rule, but extract no fields.
+ *
+ * All parsers are run in validate-only mode, so exactly the same rules
+ * match as with ln_normalize(), but no values, annotations or metadata
+ * are created. This is meant for routing and filtering, where only the
+ * rule and its tags are of interest. Nothing is allocated. Only v2
+ * rulebases are supported.
+ *
+ * @param[in] ctx The library context to use.
+ * @param[in] str The message string.
+ * @param[in] strLen The length of the message in bytes.
+ * @param[out] rule_id Numeric id of the matched rule or 0 if the
+ *                     message did not match.
+ * @param[out] tags The event.tags array of the matched rule or NULL if
+ *                  it has none or the message did not match. Owned by
+ *                  the rulebase, do not modify or release it. May be
+ *                  NULL if not needed.
+ *
+ * @return Returns zero on success, something else otherwise. Note that
+ *         a message which does not match any rule is not an error.
+ */
+int ln_classify(ln_ctx ctx, const char *str, const size_t strLen,
+	unsigned *rule_id, struct json_object **tags);
+
+
+/**
+ * Flat normalization result.
+ *
+ * A record holds the outcome of ln_normalizeRecord(): the matched
+ * rule, its tags and the extracted fields as flat array of typed
+ * slots. Field values which are taken verbatim from the message
+ * (e.g. by word, number or ipv4) are not copied but reference the
+ * message itself, so the message must be kept unmodified as long as
+ * the record is used. Converted values (e.g. numbers with
+ * "format":"number" or structured values) are held by the record.
+ *
+ * A record is meant to be reused for many messages: all of its
+ * memory is kept and the previous result is discarded on each call
+ * to ln_normalizeRecord(). A record must only be used by one thread
+ * at a time.
+ */
+typedef struct ln_record_s ln_record;
+
+/* field types, see ln_recordFieldType() */
+#define LN_FIELD_STRING	0 /**< string, use ln_recordFieldStr() */
+#define LN_FIELD_INT	1 /**< integer, use ln_recordFieldInt() */
+#define LN_FIELD_DOUBLE	2 /**< floating point, use ln_recordFieldDouble() */
+#define LN_FIELD_BOOL	3 /**< boolean, use ln_recordFieldInt() */
+#define LN_FIELD_JSON	4 /**< object, array or null, use ln_recordFieldJSON() */
+
+/**
+ * Create a new, empty result record.
+ *
+ * @return new record or NULL if out of memory
+ */
+ln_record *ln_newRecord(void);
+
+/**
+ * Free a result record. rec may be NULL.
+ */
+void ln_deleteRecord(ln_record *rec);
+
+/**
+ * Normalize a message into a flat result record.
+ *
+ * This works like ln_normalize(), but does not build a json event.
+ * Instead, the result is stored in rec, replacing its previous
+ * content. A json event can still be obtained via ln_recordToJSON().
+ * Only v2 rulebases are supported.
+ *
+ * @param[in] ctx The library context to use.
+ * @param[in] str The message string. It is referenced by the record.
+ * @param[in] strLen The length of the message in bytes.
+ * @param[in] rec The record to store the result in.
+ *
+ * @return Returns zero on success, something else otherwise. Note that
+ *         a message which does not match any rule is not an error,
+ *         use ln_recordMatched() to check.
+ */
+int ln_normalizeRecord(ln_ctx ctx, const char *str, const size_t strLen, ln_record *rec);
+
+/**
+ * Check if the message matched a rule.
+ *
+ * @return 1 if matched, 0 otherwise
+ */
+int ln_recordMatched(const ln_record *rec);
+
+/**
+ * Obtain up to which offset the message could be parsed. For matched
+ * messages, this is the message length.
+ */
+size_t ln_recordParsedTo(const ln_record *rec);
+
+/**
+ * Check if the work budget was exceeded (see ln_setWorkBudget()).
+ *
+ * @return the LN_BUDGET_* limit that was exceeded, 0 if none
+ */
+int ln_recordBudgetExceeded(const ln_record *rec);
+
+/**
+ * Obtain the identifier of the matched rule, as also used in the
+ * parse DAG statistics.
+ *
+ * @return rule identifier or NULL if the message did not match
+ */
+const char *ln_recordRuleID(const ln_record *rec);
+
+/**
+ * Obtain the numeric id of the matched rule.
+ *
+ * @return rule id or 0 if the message did not match
+ */
+unsigned ln_recordRuleNum(const ln_record *rec);
+
+/**
+ * Obtain the tags of the matched rule.
+ *
+ * @return number of tags (0 if none or not matched)
+ */
+int ln_recordNumTags(const ln_record *rec);
+
+/**
+ * Obtain tag number i (0 <= i < ln_recordNumTags()).
+ */
+const char *ln_recordTag(const ln_record *rec, int i);
+
+/**
+ * Obtain the number of fields in the record. Fields are given in
+ * message order. Field names need not be unique.
+ */
+int ln_recordNumFields(const ln_record *rec);
+
+/**
+ * Obtain the name of field i (0 <= i < ln_recordNumFields()).
+ */
+const char *ln_recordFieldName(const ln_record *rec, int i);
+
+/**
+ * Obtain the type (one of LN_FIELD_*) of field i.
+ */
+int ln_recordFieldType(const ln_record *rec, int i);
+
+/**
+ * Obtain the value of a LN_FIELD_STRING field. The value is NOT
+ * NUL-terminated if it references the message.
+ *
+ * @param[out] len length of the value in bytes
+ * @return value or NULL if field i is not a string
+ */
+const char *ln_recordFieldStr(const ln_record *rec, int i, size_t *len);
+
+/**
+ * Obtain the value of a LN_FIELD_INT or LN_FIELD_BOOL field.
+ */
+long long ln_recordFieldInt(const ln_record *rec, int i);
+
+/**
+ * Obtain the value of a LN_FIELD_DOUBLE field.
+ */
+double ln_recordFieldDouble(const ln_record *rec, int i);
+
+/**
+ * Obtain the json value of field i. This is available for all field
+ * types except strings which reference the message. The value is
+ * owned by the record and is valid until the record is reused.
+ *
+ * @return json value or NULL
+ */
+struct json_object *ln_recordFieldJSON(const ln_record *rec, int i);
+
+/**
+ * Create a json event from a record. The event is exactly the one
+ * ln_normalize() would have created for the message, except that the
+ * execution path (LN_CTXOPT_ADD_EXEC_PATH) is not available. The
+ * message must still be valid when this is called.
+ *
+ * @param[in] rec The record to convert.
+ * @param[out] json_p The new event. <b>Must be destructed if no longer
+ *                    needed.</b>
+ *
+ * @return Returns zero on success, something else otherwise.
+ */
+int ln_recordToJSON(const ln_record *rec, struct json_object **json_p);
+
+
+/**
+ * Callbacks for ln_normalizeCB(). Each of them may be NULL. All data
+ * passed to them is only valid during the call.
+ */
+struct ln_callbacks {
+	/** message matched rule (identifier as by ln_recordRuleID, numeric id) */
+	void (*on_rule)(void *cookie, const char *rule, unsigned id);
+	/** tag of the matched rule, called for each tag */
+	void (*on_tag)(void *cookie, const char *tag);
+	/** field of the event, called for each field in message order,
+	 * followed by fields added by annotations. The value depends on
+	 * the type (LN_FIELD_*):
+	 * - LN_FIELD_STRING: ptr points to len bytes, NOT NUL-terminated
+	 * - LN_FIELD_INT, LN_FIELD_BOOL: ptr points to a long long
+	 * - LN_FIELD_DOUBLE: ptr points to a double
+	 * - LN_FIELD_JSON: ptr is the struct json_object*, len is 0
+	 */
+	void (*on_field)(void *cookie, const char *name, int type, const void *ptr, size_t len);
+	/** message did not match, it could be parsed up to offset parsedTo */
+	void (*on_unparsed)(void *cookie, size_t parsedTo);
+};
+
+/**
+ * Normalize a message and report the result via callbacks.
+ *
+ * This uses the same matching as ln_normalize(), but no json event is
+ * created. Fields taken verbatim from the message are reported as
+ * pointers into the message. Only parsers which do not return strings
+ * (e.g. numbers with "format":"number", user-defined types) still
+ * create values internally. If the message matched, on_rule is called
+ * first, then on_tag for each tag and then on_field for each field.
+ * Otherwise only on_unparsed is called. Metadata (see ln_setCtxOpts)
+ * is not reported.
+ *
+ * This function can be called concurrently by multiple threads, each
+ * thread keeps its own internal result record.
+ *
+ * @param[in] ctx The library context to use.
+ * @param[in] str The message string.
+ * @param[in] strLen The length of the message in bytes.
+ * @param[in] cb The callbacks to call.
+ * @param[in] cookie Opaque pointer passed to the callbacks.
+ *
+ * @return Returns zero on success, something else otherwise. Note that
+ *         a message which does not match any rule is not an error.
+ */
+int ln_normalizeCB(ln_ctx ctx, const char *str, const size_t strLen,
+	const struct ln_callbacks *cb, void *cookie);
+
 #endif /* #ifndef LOGNORM_H_INCLUDED */
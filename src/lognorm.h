@@ -30,6 +30,7 @@
 #include "liblognorm.h"
 #include "pdag.h"
 #include "annot.h"
+#include "intern.h"
 
 /* some limits */
 #define MAX_FIELDNAME_LEN 1024
@@ -43,6 +44,15 @@ struct ln_type_pdag {
 	ln_pdag *pdag;
 };
 
+/* work budget per message, 0 means unlimited (see ln_setWorkBudget) */
+struct ln_budget {
+	unsigned parserCalls;
+	unsigned backtracks;
+	size_t bytes;
+	uint64_t deadlineNs;
+	int active;	/**< boolean: any limit set? */
+};
+
 struct ln_ctx_s {
 	unsigned objID;	/**< a magic number to prevent some memory addressing errors */
 	void (*dbgCB)(void *cookie, const char *msg, size_t lenMsg);
@@ -53,6 +63,20 @@ struct ln_ctx_s {
 	void *errmsgCookie; /**< cookie to be passed to error message callback */
 	ln_pdag *pdag; /**< parse dag being used by this context */
 	ln_annotSet *pas; /**< associated set of annotations */
+	ln_intern *intern; /**< shared strings for "intern" fields, NULL if unused */
+	struct json_object *projection; /**< wanted field names (as keys), NULL: all */
+	struct json_object *ruleIDs; /**< rule ids in use ("%u" -> "file:line"), load time only */
+	struct ln_pdag **terminals; /**< distinct terminals of the main pdag, set by ln_pdagOptimize */
+	int nTerminals;		/**< number of entries in terminals */
+	int maxTerminals;	/**< allocated size of terminals */
+	ln_telemetry *telemetry; /**< runtime statistics, NULL if never enabled */
+	int telemetryOn; /**< boolean: update telemetry? */
+	unsigned latencySampling; /**< time every Nth message (with telemetry), 0: never */
+	ln_pathprof *pathprof; /**< aggregated execution paths, NULL if never enabled */
+	int pathprofOn; /**< boolean: update path profile? */
+	ln_btrack *btrack; /**< backtracking analysis, NULL if never enabled */
+	int btrackOn; /**< boolean: update backtracking analysis? */
+	struct ln_budget budget; /**< work budget per message */
 	unsigned nNodes; /**< number of nodes in our parse tree */
 	unsigned char debug; /**< boolean: are we in debug mode? */
 	es_str_t *rulePrefix; /**< work variable for loading rule bases
@@ -62,6 +62,8 @@ static int outputSummaryLine = 0;
 static int outputNbrUnparsed = 0;
 static int addErrLineNbr = 0;	/**< add line number info to unparsed events */
 static int flatTags = 0;	/**< print event.tags in JSON? */
+static int useRecord = 0;	/**< normalize via ln_normalizeRecord()? */
+static int useCallback = 0;	/**< normalize via ln_normalizeCB()? */
 static FILE *fpDOT;
 static es_str_t *encFmt = NULL; /**< a format string for encoder use */
 static es_str_t *mandatoryTag = NULL; /**< tag which must be given so that mesg will
@@ -139,24 +141,22 @@ outputEvent(struct json_object *json, const char *const rawmsg)
 	es_deleteStr(str);
 }
 
-/* test if the tag exists */
+/* test if the tag is contained in the tagbucket (may be NULL) */
 static int
-eventHasTag(struct json_object *json, const char *tag)
+tagsContain(struct json_object *tagbucket, const char *tag)
 {
-	struct json_object *tagbucket, *tagObj;
+	struct json_object *tagObj;
 	int i;
 	const char *tagCstr;
-	
+
 	if (tag == NULL)
 		return 1;
-	if (json_object_object_get_ex(json, "event.tags", &tagbucket)) {
-		if (json_object_get_type(tagbucket) == json_type_array) {
-			for (i = json_object_array_length(tagbucket) - 1; i >= 0; i--) {
-				tagObj = json_object_array_get_idx(tagbucket, i);
-				tagCstr = json_object_get_string(tagObj);
-				if (!strcmp(tag, tagCstr))
-					return 1;
-			}
+	if (tagbucket != NULL && json_object_get_type(tagbucket) == json_type_array) {
+		for (i = json_object_array_length(tagbucket) - 1; i >= 0; i--) {
+			tagObj = json_object_array_get_idx(tagbucket, i);
+			tagCstr = json_object_get_string(tagObj);
+			if (!strcmp(tag, tagCstr))
+				return 1;
 		}
 	}
 	if (verbose > 1)
@@ -164,6 +164,18 @@ eventHasTag(struct json_object *json, const char *tag)
 	return 0;
 }
 
+/* test if the tag exists */
+static int
+eventHasTag(struct json_object *json, const char *tag)
+{
+	struct json_object *tagbucket = NULL;
+
+	if (tag == NULL)
+		return 1;
+	json_object_object_get_ex(json, "event.tags", &tagbucket);
+	return tagsContain(tagbucket, tag);
+}
+
 static void
 amendLineNbr(json_object *const json, const int line_nbr)
 {
@@ -208,6 +220,69 @@ read_line(FILE *fp)
 	return line;
 }
 
+/* callbacks for -ouseCallback: build the event from what is reported */
+struct cbEvent {
+	struct json_object *json;
+	const char *line;
+};
+
+static void
+cbTag(void *const cookie, const char *const tag)
+{
+	struct cbEvent *const ev = (struct cbEvent*) cookie;
+	struct json_object *tags;
+
+	if(!json_object_object_get_ex(ev->json, "event.tags", &tags)) {
+		tags = json_object_new_array();
+		json_object_object_add(ev->json, "event.tags", tags);
+	}
+	json_object_array_add(tags, json_object_new_string(tag));
+}
+
+static void
+cbField(void *const cookie, const char *const name, const int type,
+	const void *const ptr, const size_t len)
+{
+	struct cbEvent *const ev = (struct cbEvent*) cookie;
+	struct json_object *value;
+
+	switch(type) {
+	case LN_FIELD_STRING:
+		value = json_object_new_string_len(ptr, len);
+		break;
+	case LN_FIELD_INT:
+		value = json_object_new_int64(*(const long long*) ptr);
+		break;
+	case LN_FIELD_BOOL:
+		value = json_object_new_boolean(*(const long long*) ptr);
+		break;
+	case LN_FIELD_DOUBLE:
+		value = json_object_new_double(*(const double*) ptr);
+		break;
+	default:
+		value = json_object_get((struct json_object*) ptr);
+		break;
+	}
+	json_object_object_add(ev->json, name, value);
+}
+
+static void
+cbUnparsed(void *const cookie, const size_t parsedTo)
+{
+	struct cbEvent *const ev = (struct cbEvent*) cookie;
+
+	json_object_object_add(ev->json, "originalmsg",
+		json_object_new_string(ev->line));
+	json_object_object_add(ev->json, "unparsed-data",
+		json_object_new_string(ev->line + parsedTo));
+}
+
+static const struct ln_callbacks lognormalizerCBs = {
+	.on_tag = cbTag,
+	.on_field = cbField,
+	.on_unparsed = cbUnparsed
+};
+
 /* normalize input data
  */
 static void
@@ -221,15 +296,48 @@ normalize(void)
 	long long unsigned numWrongTag = 0;
 	char *mandatoryTagCstr = NULL;
 	int line_nbr = 0;	/* must be int to keep compatible with older json-c */
+	ln_record *rec = NULL;
 
 	if (mandatoryTag != NULL) {
 		mandatoryTagCstr = es_str2cstr(mandatoryTag, NULL);
 	}
+	/* raw output needs no event, just the rule and its tags */
+	const int classifyOnly = outfmt == f_raw && ctx->version != 1
+		&& !useRecord && !useCallback;
+	if(useRecord && (rec = ln_newRecord()) == NULL) {
+		complain("cannot create result record");
+		exit(1);
+	}
 
 	while((line = read_line(fp)) != NULL) {
 		++line_nbr;
 		if(verbose > 0) fprintf(stderr, "To normalize: '%s'\n", line);
-		ln_normalize(ctx, line, strlen(line), &json);
+		if(classifyOnly) {
+			unsigned rule_id;
+			struct json_object *tags;
+			if(ln_classify(ctx, line, strlen(line), &rule_id, &tags) != 0) {
+				/* error, nothing to output */
+			} else if(!tagsContain(tags, mandatoryTagCstr)) {
+				numWrongTag++;
+			} else if(rule_id != 0) {
+				numParsed++;
+				if(recOutput & OUTPUT_PARSED_RECS)
+					outputEvent(NULL, line);
+			} else {
+				numUnparsed++;
+				if(recOutput & OUTPUT_UNPARSED_RECS)
+					outputEvent(NULL, line);
+			}
+		} else if(useCallback) {
+			struct cbEvent ev = { json_object_new_object(), line };
+			ln_normalizeCB(ctx, line, strlen(line), &lognormalizerCBs, &ev);
+			json = ev.json;
+		} else if(useRecord) {
+			if(ln_normalizeRecord(ctx, line, strlen(line), rec) == 0)
+				ln_recordToJSON(rec, &json);
+		} else {
+			ln_normalize(ctx, line, strlen(line), &json);
+		}
 		if(json != NULL) {
 			if(eventHasTag(json, mandatoryTagCstr)) {
 				struct json_object *dummy;
@@ -264,6 +372,7 @@ normalize(void)
 			numParsed+numUnparsed, numParsed, numUnparsed);
 	}
 	free(mandatoryTagCstr);
+	ln_deleteRecord(rec);
 }
 
 
@@ -301,12 +410,70 @@ handle_generic_option(const char* opt) {
 		ln_setCtxOpts(ctx, LN_CTXOPT_ADD_RULE);
 	} else if (strcmp("addRuleLocation", opt) == 0) {
 		ln_setCtxOpts(ctx, LN_CTXOPT_ADD_RULE_LOCATION);
+	} else if (strcmp("addRuleID", opt) == 0) {
+		ln_setCtxOpts(ctx, LN_CTXOPT_ADD_RULE_ID);
+	} else if (strcmp("useRecord", opt) == 0) {
+		useRecord = 1;
+	} else if (strcmp("useCallback", opt) == 0) {
+		useCallback = 1;
 	} else {
 		fprintf(stderr, "invalid -o option '%s'\n", opt);
 		exit(1);
 	}
 }
 
+/* set field projection from a comma-separated list of names */
+static void
+setProjection(const char *const list)
+{
+	char *const buf = strdup(list);
+	const char **names = NULL;
+	int nnames = 0;
+	char *name;
+
+	if(buf == NULL || (names = calloc(strlen(list) / 2 + 1, sizeof(char*))) == NULL) {
+		complain("out of memory");
+		exit(1);
+	}
+	for(name = strtok(buf, ",") ; name != NULL ; name = strtok(NULL, ","))
+		names[nnames++] = name;
+	if(ln_setFieldProjection(ctx, names, nnames) != 0) {
+		complain("cannot set field projection");
+		exit(1);
+	}
+	free(names);
+	free(buf);
+}
+
+/* set work budget from "calls[,backtracks[,bytes[,usec]]]" */
+static void
+setWorkBudget(const char *const spec)
+{
+	unsigned long long limits[4] = { 0, 0, 0, 0 };
+	const char *p = spec;
+	char *end;
+
+	for(int i = 0 ; i < 4 ; ++i) {
+		limits[i] = strtoull(p, &end, 10);
+		if(end == p || (*end != ',' && *end != '\0')) {
+			complain("invalid work budget, use calls[,backtracks[,bytes[,usec]]]");
+			exit(1);
+		}
+		if(*end == '\0')
+			break;
+		p = end + 1;
+	}
+	if(*end != '\0') {
+		complain("invalid work budget, use calls[,backtracks[,bytes[,usec]]]");
+		exit(1);
+	}
+	if(ln_setWorkBudget(ctx, (unsigned) limits[0], (unsigned) limits[1],
+			    (size_t) limits[2], limits[3]) != 0) {
+		complain("cannot set work budget");
+		exit(1);
+	}
+}
+
 static void usage(void)
 {
 fprintf(stderr,
@@ -319,12 +486,19 @@ fprintf(stderr,
 	"                 Raw is exactly like the input. It is useful in combination\n"
 	"                 with -p/-P options to extract known good/bad messages\n"
 	"    -E<format>   Encoder-specific format (used for CSV, read docs)\n"
+	"    -k<names>    Extract only the given fields (comma-separated list)\n"
+	"    -b<calls>[,<backtracks>[,<bytes>[,<usec>]]]\n"
+	"                 Work budget per message, 0 is unlimited. Messages\n"
+	"                 exceeding it are aborted as unparsed\n"
 	"    -T           Include 'event.tags' in JSON format\n"
 	"    -oallowRegex Allow regexp matching (read docs about performance penalty)\n"
 	"    -oaddRule    Add a mockup of the matching rule.\n"
 	"    -oaddRuleLocation Add location of matching rule to metadata\n"
+	"    -oaddRuleID  Add numeric id of matching rule to metadata\n"
 	"    -oaddExecPath Add exec_path attribute to output\n"
 	"    -oaddOriginalMsg Always add original message to output, not just in error case\n"
+	"    -ouseRecord  Normalize via the flat result record API (for testing)\n"
+	"    -ouseCallback Normalize via the callback API, without metadata (for testing)\n"
 	"    -p           Print back only if the message has been parsed successfully\n"
 	"    -P           Print back only if the message has NOT been parsed successfully\n"
 	"    -L           Add source file line number information to unparsed line output\n"
@@ -335,6 +509,12 @@ fprintf(stderr,
 	"    -d<filename> Save DOT file to the filename\n"
 	"    -s<filename> Print parse dag statistics and exit\n"
 	"    -S<filename> Print extended parse dag statistics and exit (includes -s)\n"
+	"    -j<filename> Print runtime telemetry as json\n"
+	"    -f<filename> Print execution paths in folded-stack format (flame graphs)\n"
+	"    -B<filename> Print backtracking hotspots\n"
+	"    -A<limit>    Analyze worst-case complexity of rulebase and exit,\n"
+	"                 exit code 1 on problems or more parser calls than limit\n"
+	"    -l<N>        Time every Nth message for latency statistics\n"
 	"    -x<filename> Print statistics as dot file (called only)\n"
 	"\n"
 	);
@@ -348,7 +528,13 @@ int main(int argc, char *argv[])
 	int ret = 0;
 	FILE *fpStats = NULL;
 	FILE *fpStatsDOT = NULL;
+	FILE *fpTelemetry = NULL;
+	FILE *fpFolded = NULL;
+	FILE *fpBacktrack = NULL;
 	int extendedStats = 0;
+	int latencySampling = -1; /* -1: not set */
+	int analyze = 0;
+	unsigned long long maxCalls = 0;
 
 	if((ctx = ln_initCtx()) == NULL) {
 		complain("Could not initialize liblognorm context");
@@ -356,7 +542,7 @@ int main(int argc, char *argv[])
 		goto exit;
 	}
 
-	while((opt = getopt(argc, argv, "d:s:S:e:r:R:E:vVpPt:To:hHULx:")) != -1) {
+	while((opt = getopt(argc, argv, "d:s:S:e:r:R:E:vVpPt:To:hHULx:k:j:l:f:B:A:b:")) != -1) {
 		switch (opt) {
 		case 'V':
 			printVersion();
@@ -388,9 +574,13 @@ int main(int argc, char *argv[])
 			break;
 		case 'S': /* generate pdag statistic file */
 			extendedStats = 1;
+			ln_setTelemetry(ctx, 1);
 			/* INTENTIONALLY NO BREAK! - KEEP order! */
 			/*FALLTHROUGH*/
 		case 's': /* generate pdag statistic file */
+			ln_setTelemetry(ctx, 1);
+			if(latencySampling == -1)
+				latencySampling = 1;
 			if(!strcmp(optarg, "-")) {
 				fpStats = stdout;
 			} else {
@@ -402,6 +592,57 @@ int main(int argc, char *argv[])
 				}
 			}
 			break;
+		case 'j': /* runtime telemetry as json */
+			if(!strcmp(optarg, "-")) {
+				fpTelemetry = stdout;
+			} else {
+				if((fpTelemetry = fopen(optarg, "w")) == NULL) {
+					perror(optarg);
+					complain("Cannot open telemetry file");
+					ret = 1;
+					goto exit;
+				}
+			}
+			ln_setTelemetry(ctx, 1);
+			break;
+		case 'f': /* execution paths as folded stacks */
+			if(!strcmp(optarg, "-")) {
+				fpFolded = stdout;
+			} else {
+				if((fpFolded = fopen(optarg, "w")) == NULL) {
+					perror(optarg);
+					complain("Cannot open folded stacks file");
+					ret = 1;
+					goto exit;
+				}
+			}
+			ln_setPathProfiling(ctx, 1);
+			break;
+		case 'B': /* backtracking hotspots */
+			if(!strcmp(optarg, "-")) {
+				fpBacktrack = stdout;
+			} else {
+				if((fpBacktrack = fopen(optarg, "w")) == NULL) {
+					perror(optarg);
+					complain("Cannot open backtracking report file");
+					ret = 1;
+					goto exit;
+				}
+			}
+			ln_setBacktrackAnalysis(ctx, 1);
+			break;
+		case 'A': /* complexity analysis */
+			analyze = 1;
+			maxCalls = strtoull(optarg, NULL, 10);
+			break;
+		case 'l': /* latency sampling */
+			latencySampling = atoi(optarg);
+			if(latencySampling < 0) {
+				complain("-l requires a number >= 0");
+				ret = 1;
+				goto exit;
+			}
+			break;
 		case 'v':
 			verbose++;
 			break;
@@ -462,6 +703,12 @@ int main(int argc, char *argv[])
 		case 'o':
 			handle_generic_option(optarg);
 			break;
+		case 'k': /* field projection */
+			setProjection(optarg);
+			break;
+		case 'b': /* work budget */
+			setWorkBudget(optarg);
+			break;
 		case 'h':
 		default:
 			usage();
@@ -512,6 +759,20 @@ int main(int argc, char *argv[])
 
 	if(verbose > 2) ln_displayPDAG(ctx);
 
+	if(analyze) {
+		int nProblems;
+		if(ln_analyzeComplexity(ctx, stdout, maxCalls, &nProblems) != 0) {
+			complain("complexity analysis failed");
+			ret = 1;
+		} else {
+			ret = (nProblems > 0);
+		}
+		goto exit;
+	}
+
+	if(latencySampling > 0)
+		ln_setLatencySampling(ctx, latencySampling);
+
 	normalize();
 
 	if(fpStats != NULL) {
@@ -522,6 +783,28 @@ int main(int argc, char *argv[])
 		ln_fullPDagStatsDOT(ctx, fpStatsDOT);
 	}
 
+	if(fpTelemetry != NULL) {
+		struct json_object *json;
+		if(ln_telemetrySnapshot(ctx, 0, &json) == 0) {
+			fprintf(fpTelemetry, "%s\n", json_object_to_json_string(json));
+			json_object_put(json);
+		}
+		if(fpTelemetry != stdout)
+			fclose(fpTelemetry);
+	}
+
+	if(fpFolded != NULL) {
+		ln_writeFoldedStacks(ctx, fpFolded);
+		if(fpFolded != stdout)
+			fclose(fpFolded);
+	}
+
+	if(fpBacktrack != NULL) {
+		ln_writeBacktrackReport(ctx, fpBacktrack, 20);
+		if(fpBacktrack != stdout)
+			fclose(fpBacktrack);
+	}
+
 exit:
 	if (ctx) ln_exitCtx(ctx);
 	if (encFmt != NULL)
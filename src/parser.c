@@ -34,6 +34,7 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <time.h>
+#include <pthread.h>
 
 #include "liblognorm.h"
 #include "lognorm.h"
@@ -75,6 +76,18 @@ hParseInt(const unsigned char **buf, size_t *lenBuf)
 	return i;
 }
 
+/* create the json string for a value taken verbatim from the message.
+ * If the current parser instance has "intern" set, recurring values
+ * are served as shared strings from the context's intern table.
+ */
+static inline struct json_object *
+newValueStr(npb_t *const npb, const char *const str, const size_t len)
+{
+	if(npb->intern)
+		return ln_internStr(npb->ctx->intern, str, len);
+	return json_object_new_string_len(str, len);
+}
+
 /* parser _parse interface
  *
  * All parsers receive
@@ -303,6 +316,109 @@ done:
 }
 
 
+/* Timestamp parse cache.
+ * Log bursts usually carry the very same (second-granularity) timestamp
+ * over and over again. So we keep the last few successfully parsed
+ * timestamps per thread, keyed by their raw bytes, and hand out the
+ * parsed length and unix timestamp on a hit instead of parsing again.
+ * Each date parser has its own cache, because what may follow the
+ * timestamp differs between them.
+ */
+#define TSCACHE_NENTRIES 4
+#define TSCACHE_MAXLEN 48
+struct tscache_entry {
+	size_t len;		/**< length of timestamp, 0 == entry unused */
+	char ts[TSCACHE_MAXLEN];/**< raw timestamp bytes (the key) */
+	int haveUnixTS;		/**< unix timestamps below are valid */
+	int64_t unixTS;
+	int64_t unixTS_ms;
+	time_t validUntil;	/**< unixTS is only valid before this time (0 = forever) */
+};
+struct tscache {
+	struct tscache_entry entries[TSCACHE_NENTRIES];
+	int next;		/**< next entry to be replaced (round robin) */
+	int isRFC3164;		/**< end-of-timestamp rules are RFC3164 ones */
+};
+static __thread struct tscache tscache_rfc5424;
+static __thread struct tscache tscache_rfc3164 = { .isRFC3164 = 1 };
+
+/* check if a cached timestamp is also the one that would be parsed
+ * from str. The cached bytes already match, so we only need to make
+ * sure the parser would have stopped at the same position.
+ */
+static inline int
+tscacheEndMatches(const struct tscache *const cache, const struct tscache_entry *const e,
+	const char *const str, const size_t lenStr)
+{
+	if(e->len == lenStr)
+		return 1;
+	if(!cache->isRFC3164) {
+		return str[e->len] == ' ';
+	} else {
+		/* RFC3164 may end in an (optional) colon, in which case
+		 * parsing has definitely stopped. Otherwise, the seconds
+		 * must not continue and no colon must follow.
+		 */
+		return e->ts[e->len-1] == ':'
+			|| (!myisdigit(str[e->len]) && str[e->len] != ':');
+	}
+}
+
+/**
+ * Look up a timestamp at the start of str.
+ * @param[in] needUnixTS if set, only entries with valid unix timestamp are
+ *            returned (stale ones are dropped)
+ * @return matching cache entry or NULL if there is none
+ */
+static struct tscache_entry *
+tscacheLookup(npb_t *const npb, struct tscache *const cache, const char *const str,
+	const size_t lenStr, const int needUnixTS)
+{
+	struct tscache_entry *e = NULL;
+	for(int i = 0 ; i < TSCACHE_NENTRIES ; ++i) {
+		struct tscache_entry *const curr = &cache->entries[i];
+		if(   curr->len == 0
+		   || curr->len > lenStr
+		   || memcmp(curr->ts, str, curr->len)
+		   || !tscacheEndMatches(cache, curr, str, lenStr))
+			continue;
+		if(needUnixTS && (!curr->haveUnixTS
+		   || (curr->validUntil != 0 && time(NULL) >= curr->validUntil))) {
+			curr->len = 0; /* stale, will be re-added on parse */
+			continue;
+		}
+		e = curr;
+		break;
+	}
+	if(npb->tm != NULL) {
+		ln_tmAdd(&npb->tm->tscache_lookups, 1);
+		if(e != NULL)
+			ln_tmAdd(&npb->tm->tscache_hits, 1);
+	}
+	return e;
+}
+
+/* add a freshly parsed timestamp to the cache. Timestamps that
+ * are too long for the cache are silently not cached.
+ */
+static void
+tscacheAdd(struct tscache *const cache, const char *const str, const size_t len,
+	const int haveUnixTS, const int64_t unixTS, const int64_t unixTS_ms,
+	const time_t validUntil)
+{
+	if(len > TSCACHE_MAXLEN)
+		return;
+	struct tscache_entry *const e = &cache->entries[cache->next];
+	cache->next = (cache->next + 1) % TSCACHE_NENTRIES;
+	memcpy(e->ts, str, len);
+	e->len = len;
+	e->haveUnixTS = haveUnixTS;
+	e->unixTS = unixTS;
+	e->unixTS_ms = unixTS_ms;
+	e->validUntil = validUntil;
+}
+
+
 struct data_RFC5424Date {
 	enum FMT_MODE fmt_mode;
 };
@@ -327,10 +443,22 @@ PARSER_Parse(RFC5424Date)
 	size_t len;
 	size_t orglen;
 	/* end variables to temporarily hold time information while we parse */
+	int64_t timestamp = 0;
+	int64_t timestamp_ms = 0;
+	const struct tscache_entry *cached;
 
 	pszTS = (unsigned char*) npb->str + *offs;
 	len = orglen = npb->strLen - *offs;
 
+	cached = tscacheLookup(npb, &tscache_rfc5424, npb->str + *offs, orglen,
+		data->fmt_mode != FMT_AS_STRING);
+	if(cached != NULL) {
+		*parsed = cached->len;
+		timestamp = cached->unixTS;
+		timestamp_ms = cached->unixTS_ms;
+		goto emit_value;
+	}
+
 	year = hParseInt(&pszTS, &len);
 
 	/* We take the liberty to accept slightly malformed timestamps e.g. in
@@ -411,26 +539,32 @@ PARSER_Parse(RFC5424Date)
 	/* we had success, so update parse pointer */
 	*parsed = orglen - len;
 
+	if(data->fmt_mode != FMT_AS_STRING) {
+		timestamp = syslogTime2time_t(year, month, day,
+			hour, minute, second, OffsetHour, OffsetMinute, OffsetMode);
+		timestamp_ms = timestamp * 1000;
+		/* simulate pow(), do not use math lib! */
+		int div = 1;
+		if(secfracPrecision == 1) {
+			secfrac *= 100;
+		} else if(secfracPrecision == 2) {
+			secfrac *= 10;
+		} else if(secfracPrecision > 3) {
+			for(int i = 0 ; i < (secfracPrecision - 3) ; ++i)
+				div *= 10;
+		}
+		timestamp_ms += secfrac / div;
+	}
+	tscacheAdd(&tscache_rfc5424, npb->str + *offs, *parsed,
+		data->fmt_mode != FMT_AS_STRING, timestamp, timestamp_ms, 0);
+
+emit_value:
 	if(value != NULL) {
 		if(data->fmt_mode == FMT_AS_STRING) {
-			*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+			*value = newValueStr(npb, npb->str+(*offs), *parsed);
+		} else if(data->fmt_mode == FMT_AS_TIMESTAMP_UX_MS) {
+			*value = json_object_new_int64(timestamp_ms);
 		} else {
-			int64_t timestamp = syslogTime2time_t(year, month, day,
-				hour, minute, second, OffsetHour, OffsetMinute, OffsetMode);
-			if(data->fmt_mode == FMT_AS_TIMESTAMP_UX_MS) {
-				timestamp *= 1000;
-				/* simulate pow(), do not use math lib! */
-				int div = 1;
-				if(secfracPrecision == 1) {
-					secfrac *= 100;
-				} else if(secfracPrecision == 2) {
-					secfrac *= 10;
-				} else if(secfracPrecision > 3) {
-					for(int i = 0 ; i < (secfracPrecision - 3) ; ++i)
-						div *= 10;
-				}
-				timestamp += secfrac / div;
-			}
 			*value = json_object_new_int64(timestamp);
 		}
 	}
@@ -501,9 +635,20 @@ PARSER_Parse(RFC3164Date)
 	int hour; /* 24 hour clock */
 	int minute;
 	int second;
+	int64_t timestamp = 0;
+	const struct tscache_entry *cached;
 
 	p = (unsigned char*) npb->str + *offs;
 	orglen = len = npb->strLen - *offs;
+
+	cached = tscacheLookup(npb, &tscache_rfc3164, npb->str + *offs, orglen,
+		data->fmt_mode != FMT_AS_STRING);
+	if(cached != NULL) {
+		*parsed = cached->len;
+		timestamp = cached->unixTS;
+		goto emit_value;
+	}
+
 	/* If we look at the month (Jan, Feb, Mar, Apr, May, Jun, Jul, Aug, Sep, Oct, Nov, Dec),
 	 * we may see the following character sequences occur:
 	 *
@@ -704,23 +849,34 @@ PARSER_Parse(RFC3164Date)
 
 	/* we had success, so update parse pointer */
 	*parsed = orglen - len;
+	if(data->fmt_mode == FMT_AS_STRING) {
+		tscacheAdd(&tscache_rfc3164, npb->str + *offs, *parsed, 0, 0, 0, 0);
+	} else {
+		/* we assume year == current year, so let's obtain current year */
+		struct tm tm;
+		const time_t curr = time(NULL);
+		gmtime_r(&curr, &tm);
+		year = tm.tm_year + 1900;
+		timestamp = syslogTime2time_t(year, month, day,
+			hour, minute, second, 0, 0, '+');
+		/* the result depends on the current year, so the cache entry
+		 * must expire when the next one begins.
+		 */
+		tscacheAdd(&tscache_rfc3164, npb->str + *offs, *parsed, 1,
+			timestamp, timestamp * 1000,
+			syslogTime2time_t(year + 1, 1, 1, 0, 0, 0, 0, 0, '+'));
+	}
+
+emit_value:
 	if(value != NULL) {
 		if(data->fmt_mode == FMT_AS_STRING) {
-			*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+			*value = newValueStr(npb, npb->str+(*offs), *parsed);
+		} else if(data->fmt_mode == FMT_AS_TIMESTAMP_UX_MS) {
+			/* we do not have more precise info, just bring
+			 * into common format!
+			 */
+			*value = json_object_new_int64(timestamp * 1000);
 		} else {
-			/* we assume year == current year, so let's obtain current year */
-			struct tm tm;
-			const time_t curr = time(NULL);
-			gmtime_r(&curr, &tm);
-			year = tm.tm_year + 1900;
-			int64_t timestamp = syslogTime2time_t(year, month, day,
-				hour, minute, second, 0, 0, '+');
-			if(data->fmt_mode == FMT_AS_TIMESTAMP_UX_MS) {
-				/* we do not have more precise info, just bring
-				 * into common format!
-				 */
-				timestamp *= 1000;
-			}
 			*value = json_object_new_int64(timestamp);
 		}
 	}
@@ -816,7 +972,7 @@ PARSER_Parse(Number)
 	*parsed = i - *offs;
 	if(value != NULL) {
 		if(fmt_mode == FMT_AS_STRING) {
-			*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+			*value = newValueStr(npb, npb->str+(*offs), *parsed);
 		} else {
 			*value = json_object_new_int64(val);
 		}
@@ -928,7 +1084,7 @@ PARSER_Parse(Float)
 	*parsed = i - *offs;
 	if(value != NULL) {
 		if(data->fmt_mode == FMT_AS_STRING) {
-			*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+			*value = newValueStr(npb, npb->str+(*offs), *parsed);
 		} else {
 			char *serialized = strndup(npb->str+(*offs), *parsed);
 			*value = json_object_new_double_s(val, serialized);
@@ -1027,7 +1183,7 @@ PARSER_Parse(HexNumber)
 	*parsed = i - *offs;
 	if(value != NULL) {
 		if(data->fmt_mode == FMT_AS_STRING) {
-			*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+			*value = newValueStr(npb, npb->str+(*offs), *parsed);
 		} else {
 			*value = json_object_new_int64((int64_t) val);
 		}
@@ -1137,7 +1293,7 @@ PARSER_Parse(KernelTimestamp)
 	/* success, persist */
 	*parsed = i - *offs;
 	if(value != NULL) {
-		*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+		*value = newValueStr(npb, npb->str+(*offs), *parsed);
 	}
 	r = 0; /* success */
 done:
@@ -1170,7 +1326,7 @@ PARSER_Parse(Whitespace)
 	/* success, persist */
 	*parsed = i - *offs;
 	if(value != NULL) {
-		*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+		*value = newValueStr(npb, npb->str+(*offs), *parsed);
 	}
 	r = 0; /* success */
 done:
@@ -1203,7 +1359,7 @@ PARSER_Parse(Word)
 	/* success, persist */
 	*parsed = i - *offs;
 	if(value != NULL) {
-		*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+		*value = newValueStr(npb, npb->str+(*offs), *parsed);
 	}
 	r = 0; /* success */
 done:
@@ -1257,7 +1413,7 @@ PARSER_Parse(StringTo)
 	/* success, persist */
 	*parsed = i - *offs;
 	if(value != NULL) {
-		*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+		*value = newValueStr(npb, npb->str+(*offs), *parsed);
 	}
 	r = 0; /* success */
 done:
@@ -1317,7 +1473,7 @@ PARSER_Parse(Alpha)
 	/* success, persist */
 	*parsed = i - *offs;
 	if(value != NULL) {
-		*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+		*value = newValueStr(npb, npb->str+(*offs), *parsed);
 	}
 	r = 0; /* success */
 done:
@@ -1367,7 +1523,7 @@ PARSER_Parse(CharTo)
 	/* success, persist */
 	*parsed = i - *offs;
 	if(value != NULL) {
-		*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+		*value = newValueStr(npb, npb->str+(*offs), *parsed);
 	}
 	r = 0;
 done:
@@ -1442,7 +1598,7 @@ PARSER_Parse(Literal)
 	*parsed = j; /* we must always return how far we parsed! */
 	if(lit[j] == '\0') {
 		if(value != NULL) {
-			*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+			*value = newValueStr(npb, npb->str+(*offs), *parsed);
 		}
 		r = 0;
 	}
@@ -1540,7 +1696,7 @@ PARSER_Parse(CharSeparated)
 	/* success, persist */
 	*parsed = i - *offs;
 	if(value != NULL) {
-		*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+		*value = newValueStr(npb, npb->str+(*offs), *parsed);
 	}
 	r = 0; /* success */
 	return r;
@@ -1586,7 +1742,7 @@ PARSER_Parse(Rest)
 	/* success, persist */
 	*parsed = npb->strLen - *offs;
 	if(value != NULL) {
-		*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+		*value = newValueStr(npb, npb->str+(*offs), *parsed);
 	}
 	r = 0;
 	return r;
@@ -1678,7 +1834,7 @@ PARSER_Parse(QuotedString)
 	*parsed = i + 1 - *offs; /* "eat" terminal double quote */
 	/* create JSON value to save quoted string contents */
 	if(value != NULL) {
-		*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+		*value = newValueStr(npb, npb->str+(*offs), *parsed);
 	}
 	r = 0; /* success */
 done:
@@ -1733,7 +1889,7 @@ PARSER_Parse(ISODate)
 	/* success, persist */
 	*parsed = 10;
 	if(value != NULL) {
-		*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+		*value = newValueStr(npb, npb->str+(*offs), *parsed);
 	}
 	r = 0; /* success */
 done:
@@ -1928,7 +2084,7 @@ PARSER_Parse(Duration)
 	/* success, persist */
 	*parsed = (i + 5) - *offs;
 	if(value != NULL) {
-		*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+		*value = newValueStr(npb, npb->str+(*offs), *parsed);
 	}
 	r = 0; /* success */
 done:
@@ -1972,7 +2128,7 @@ PARSER_Parse(Time24hr)
 	/* success, persist */
 	*parsed = 8;
 	if(value != NULL) {
-		*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+		*value = newValueStr(npb, npb->str+(*offs), *parsed);
 	}
 	r = 0; /* success */
 done:
@@ -2016,7 +2172,7 @@ PARSER_Parse(Time12hr)
 	/* success, persist */
 	*parsed = 8;
 	if(value != NULL) {
-		*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+		*value = newValueStr(npb, npb->str+(*offs), *parsed);
 	}
 	r = 0; /* success */
 done:
@@ -2088,7 +2244,7 @@ PARSER_Parse(IPv4)
 	/* if we reach this point, we found a valid IP address */
 	*parsed = i - *offs;
 	if(value != NULL) {
-		*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+		*value = newValueStr(npb, npb->str+(*offs), *parsed);
 	}
 	r = 0; /* success */
 done:
@@ -2195,321 +2351,855 @@ chk_ok:	/* we are finished parsing, check if things are ok */
 	/* if we reach this point, we found a valid IP address */
 	*parsed = i - *offs;
 	if(value != NULL) {
-		*value = json_object_new_string_len(npb->str+(*offs), *parsed);
+		*value = newValueStr(npb, npb->str+(*offs), *parsed);
 	}
 	r = 0; /* success */
 done:
 	return r;
 }
 
-/* check if a char is valid inside a name of the iptables motif.
- * We try to keep the set as slim as possible, because the iptables
- * parser may otherwise create a very broad match (especially the
- * inclusion of simple words like "DF" cause grief here).
- * Note: we have taken the permitted set from iptables log samples.
- * Report bugs if we missed some additional rules.
+/* Key-value engine.
+ * All parsers that extract lists of name/value pairs (name-value-list,
+ * v2-iptables, checkpoint-lea and the CEF extensions) use this common
+ * scanner. The specifics of each motif (name characters, assignator,
+ * separators, quoting and escaping) are described by a dialect.
+ * The scanner validates the list in a single pass and records names
+ * and values as spans (offsets into the message). Only if the whole
+ * list matches, the json object is built from these spans. So mismatches
+ * stay cheap and nothing needs to be copied while scanning.
  */
+enum kv_valmode {
+	KV_VAL_WORD,		/**< up to next separator, may be quoted, backslash escapes */
+	KV_VAL_TO_SPACE,	/**< up to next whitespace, no escapes */
+	KV_VAL_TERMINATED,	/**< up to valTerm, which must be present */
+	KV_VAL_CEF		/**< CEF extension value, runs up to the name of the next pair */
+};
+enum kv_sepmode {
+	KV_SEP_RUN,		/**< one or more separators, list ends if none follows */
+	KV_SEP_ONE_SP,		/**< at most a single SP between pairs */
+	KV_SEP_LEADING_SP	/**< any number of SP in front of each pair */
+};
+struct kv_dialect {
+	int (*isNameChar)(const char c); /**< NULL means anything up to assignator */
+	char ass;		/**< assignator (between name and value) */
+	char sep;		/**< pair separator for KV_SEP_RUN, 0 means whitespace */
+	char valTerm;		/**< value terminator for KV_VAL_TERMINATED */
+	char stopChar;		/**< list ends at a pair starting with this, 0 means none */
+	enum kv_valmode valMode;
+	enum kv_sepmode sepMode;
+	int minPairs;		/**< minimum number of pairs for a match */
+	unsigned nameRequired : 1;	/**< empty names are not permitted */
+	unsigned flagNames : 1;		/**< names without assignator (and value) are permitted */
+	unsigned quoting : 1;		/**< values may be quoted by " or ' */
+	unsigned skipSPAfterAss : 1;	/**< SP between assignator and value is ignored */
+	unsigned partialMatch : 1;	/**< list ends (successfully) at first bad pair */
+	unsigned cefEscapes : 1;	/**< values contain CEF escape sequences */
+};
+
+struct kv_pair {
+	size_t iName;
+	size_t lenName;
+	size_t iVal;
+	size_t lenVal;
+	int hasVal;		/**< 0 for flag names */
+};
+#define KV_INLINE_PAIRS 32
+struct kv_pairs {
+	int nPairs;
+	int maxPairs;
+	struct kv_pair *pairs;	/**< points to inlineBuf unless it overflowed */
+	struct kv_pair inlineBuf[KV_INLINE_PAIRS];
+};
+
+static inline void
+kvPairsInit(struct kv_pairs *const pairs)
+{
+	pairs->nPairs = 0;
+	pairs->maxPairs = KV_INLINE_PAIRS;
+	pairs->pairs = pairs->inlineBuf;
+}
+
+static inline void
+kvPairsDestruct(struct kv_pairs *const pairs)
+{
+	if(pairs->pairs != pairs->inlineBuf)
+		free(pairs->pairs);
+}
+
+static int
+kvPairsAdd(struct kv_pairs *const pairs, const struct kv_pair *const pair)
+{
+	int r = 0;
+	if(pairs->nPairs == pairs->maxPairs) {
+		struct kv_pair *newPairs;
+		const int newMax = pairs->maxPairs * 2;
+		CHKN(newPairs = malloc(newMax * sizeof(struct kv_pair)));
+		memcpy(newPairs, pairs->pairs, pairs->nPairs * sizeof(struct kv_pair));
+		kvPairsDestruct(pairs);
+		pairs->pairs = newPairs;
+		pairs->maxPairs = newMax;
+	}
+	pairs->pairs[pairs->nPairs++] = *pair;
+done:
+	return r;
+}
+
 static inline int
-isValidIPTablesNameChar(const char c)
+kvIsSep(const struct kv_dialect *const d, const char c)
 {
-	/* right now, upper case only is valid */
-	return ('A' <= c && c <= 'Z') ? 1 : 0;
+	return (d->sep == 0) ? isspace(c) : (c == d->sep);
 }
 
-/* helper to iptables parser, parses out a a single name=value pair
+/* find the next occurrence of c which is not escaped by a backslash.
+ * Backslashes are only counted from iBegin on. Note that an escaped
+ * backslash does not escape the char following it.
+ * @return index of c or strLen if there is none
+ */
+static size_t
+kvFindUnescaped(const char *const str, const size_t strLen,
+	const size_t iBegin, const char c)
+{
+	size_t i = iBegin;
+	const char *p;
+	while((p = memchr(str + i, c, strLen - i)) != NULL) {
+		const size_t iFound = p - str;
+		size_t nBackslash = 0;
+		while(iFound - nBackslash > iBegin && str[iFound - nBackslash - 1] == '\\')
+			++nBackslash;
+		if(nBackslash % 2 == 0)
+			return iFound;
+		i = iFound + 1;
+	}
+	return strLen;
+}
+
+/* CEF extension values are not quoted and may contain spaces. They
+ * end with the last word in front of the next unescaped equal sign,
+ * which is the name of the next pair.
  */
 static int
-parseIPTablesNameValue(npb_t *const npb,
-	size_t *const __restrict__ offs,
-	struct json_object *const __restrict__ valroot)
+kvScanCEFValue(const char *const str, const size_t strLen, size_t *const offs)
 {
-	int r = LN_WRONGPARSER;
+	int r = 0;
 	size_t i = *offs;
-	char *name = NULL;
-
-	const size_t iName = i;
-	while(i < npb->strLen && isValidIPTablesNameChar(npb->str[i]))
-		++i;
-	if(i == iName || (i < npb->strLen && npb->str[i] != '=' && npb->str[i] != ' '))
-		goto done; /* no name at all! */
-
-	const ssize_t lenName = i - iName;
-
-	ssize_t iVal = -1;
-	size_t lenVal = i - iVal;
-	if(i < npb->strLen && npb->str[i] != ' ') {
-		/* we have a real value (not just a flag name like "DF") */
-		++i; /* skip '=' */
-		iVal = i;
-		while(i < npb->strLen && !isspace(npb->str[i]))
-			++i;
-		lenVal = i - iVal;
+	size_t iLastWordBegin;
+	int hadSP = 0;
+	int inEscape = 0;
+	for(iLastWordBegin = 0 ; i < strLen ; ++i) {
+		if(inEscape) {
+			if(str[i] != '=' &&
+			   str[i] != '\\' &&
+			   str[i] != 'r' &&
+			   str[i] != 'n' &&
+			   str[i] != '/')
+			FAIL(LN_WRONGPARSER);
+			inEscape = 0;
+		} else {
+			if(str[i] == '=') {
+				break;
+			} else if(str[i] == '\\') {
+				inEscape = 1;
+			} else if(str[i] == ' ') {
+				hadSP = 1;
+			} else {
+				if(hadSP) {
+					iLastWordBegin = i;
+					hadSP = 0;
+				}
+			}
+		}
 	}
 
-	/* parsing OK */
-	*offs = i;
-	r = 0;
-
-	if(valroot == NULL)
-		goto done;
-
-	CHKN(name = malloc(lenName+1));
-	memcpy(name, npb->str+iName, lenName);
-	name[lenName] = '\0';
-	json_object *json;
-	if(iVal == -1) {
-		json = NULL;
+	/* Note: iLastWordBegin can never be at offset zero, because
+	 * the CEF header starts there!
+	 */
+	if(i < strLen) {
+		*offs = (iLastWordBegin == 0) ? i : iLastWordBegin - 1;
 	} else {
-		CHKN(json = json_object_new_string_len(npb->str+iVal, lenVal));
+		*offs = i;
 	}
-	json_object_object_add(valroot, name, json);
 done:
-	free(name);
 	return r;
 }
 
-/**
- * Parser for iptables logs (the structured part).
- * This parser is named "v2-iptables" because of a traditional
- * parser named "iptables", which we do not want to replace, at
- * least right now (we may re-think this before the first release).
- * For performance reasons, this works in two stages. In the first
- * stage, we only detect if the motif is correct. The second stage is
- * only called when we know it is. In it, we go once again over the
- * message again and actually extract the data. This is done because
- * data extraction is relatively expensive and in most cases we will
- * have much more frequent mismatches than matches.
- * Note that this motif must have at least one field, otherwise it
- * could detect things that are not iptables to be it. Further limits
- * may be imposed in the future as we see additional need.
- * added 2015-04-30 rgerhards
+/* scan a single name/value pair. *offs is only updated on success.
  */
-PARSER_Parse(v2IPTables)
+static int
+kvScanPair(npb_t *const npb, size_t *const __restrict__ offs,
+	const struct kv_dialect *const __restrict__ d,
+	struct kv_pair *const __restrict__ pair)
+{
+	int r = LN_WRONGPARSER;
+	const char *const str = npb->str;
+	const size_t strLen = npb->strLen;
 	size_t i = *offs;
-	int nfields = 0;
 
-	/* stage one */
-	while(i < npb->strLen) {
-		CHKR(parseIPTablesNameValue(npb, &i, NULL));
-		++nfields;
-		/* exactly one SP is permitted between fields */
-		if(i < npb->strLen && npb->str[i] == ' ')
+	pair->iName = i;
+	if(d->isNameChar == NULL) {
+		const char *const pAss = memchr(str + i, d->ass, strLen - i);
+		if(pAss == NULL)
+			goto done;
+		i = pAss - str;
+	} else {
+		while(i < strLen && d->isNameChar(str[i]))
 			++i;
 	}
+	pair->lenName = i - pair->iName;
+	if(d->nameRequired && pair->lenName == 0)
+		goto done;
 
-	if(nfields < 2) {
-		FAIL(LN_WRONGPARSER);
+	if(i == strLen || str[i] != d->ass) {
+		/* this can only be a flag (name without value) */
+		if(!d->flagNames || (i < strLen && str[i] != ' '))
+			goto done;
+		pair->hasVal = 0;
+		*offs = i;
+		r = 0;
+		goto done;
 	}
+	++i; /* skip assignator */
+	pair->hasVal = 1;
 
-	/* success, persist */
-	*parsed = i - *offs;
-	r = 0;
-
-	/* stage two */
-	if(value == NULL)
-		goto done;
+	if(d->skipSPAfterAss) {
+		while(i < strLen && str[i] == ' ')
+			++i;
+	}
 
-	i = *offs;
-	CHKN(*value = json_object_new_object());
-	while(i < npb->strLen) {
-		CHKR(parseIPTablesNameValue(npb, &i, *value));
-		while(i < npb->strLen && isspace(npb->str[i]))
+	switch(d->valMode) {
+	case KV_VAL_WORD:
+		if(d->quoting && i < strLen && (str[i] == '"' || str[i] == '\'')) {
+			const char quote = str[i++];
+			pair->iVal = i;
+			i = kvFindUnescaped(str, strLen, i, quote);
+			if(i == strLen)
+				goto done; /* no closing quote */
+			pair->lenVal = i - pair->iVal;
+			++i; /* skip closing quote */
+		} else {
+			pair->iVal = i;
+			if(d->sep == 0) {
+				int nBackslash = 0;
+				while(i < strLen && (!isspace(str[i]) || nBackslash % 2 == 1)) {
+					nBackslash = (str[i] == '\\') ? nBackslash + 1 : 0;
+					++i;
+				}
+			} else {
+				i = kvFindUnescaped(str, strLen, i, d->sep);
+			}
+			pair->lenVal = i - pair->iVal;
+		}
+		break;
+	case KV_VAL_TO_SPACE:
+		pair->iVal = i;
+		while(i < strLen && !isspace(str[i]))
 			++i;
+		pair->lenVal = i - pair->iVal;
+		break;
+	case KV_VAL_TERMINATED:
+		pair->iVal = i;
+		const char *const pTerm = memchr(str + i, d->valTerm, strLen - i);
+		if(pTerm == NULL)
+			goto done;
+		i = pTerm - str;
+		pair->lenVal = i - pair->iVal;
+		++i; /* skip terminator */
+		break;
+	case KV_VAL_CEF:
+		pair->iVal = i;
+		CHKR(kvScanCEFValue(str, strLen, &i));
+		pair->lenVal = i - pair->iVal;
+		if(i < strLen)
+			++i; /* skip past value */
+		break;
+	default:
+		goto done;
 	}
 
+	*offs = i;
+	r = 0;
 done:
-	if(r != 0 && value != NULL && *value != NULL) {
-		json_object_put(*value);
-		*value = NULL;
-	}
 	return r;
 }
 
 /**
- * Parse JSON. This parser tries to find JSON data inside a message.
- * If it finds valid JSON, it will extract it. Extra data after the
- * JSON is permitted.
- * Note: the json-c JSON parser treats whitespace after the actual
- * json to be part of the json. So in essence, any whitespace is
- * processed by this parser. We use the same semantics to keep things
- * neatly in sync. If json-c changes for some reason or we switch to
- * an alternate json lib, we probably need to be sure to keep that
- * behaviour, and probably emulate it.
- * added 2015-04-28 by rgerhards, v1.1.2
+ * Scan a list of name/value pairs.
+ * @param[in,out] offs on entry, where to start, on exit: end of list
+ * @param[out] pairs spans of the pairs found, NULL if not needed
+ * @return 0 if the list matches, LN_WRONGPARSER otherwise
  */
-PARSER_Parse(JSON)
-	const size_t i = *offs;
-	struct json_tokener *tokener = NULL;
+static int
+kvScan(npb_t *const npb, size_t *const __restrict__ offs,
+	const struct kv_dialect *const __restrict__ d,
+	struct kv_pairs *const __restrict__ pairs)
+{
+	int r = 0;
+	const char *const str = npb->str;
+	const size_t strLen = npb->strLen;
+	size_t i = *offs;
+	int nPairs = 0;
+	int stopped = 0;
+	struct kv_pair pair;
 
-	if(npb->str[i] != '{' && npb->str[i] != ']') {
-		/* this can't be json, see RFC4627, Sect. 2
-		 * see this bug in json-c:
-		 * https://github.com/json-c/json-c/issues/181
-		 * In any case, it's better to do this quick check,
-		 * even if json-c did not have the bug because this
-		 * check here is much faster than calling the parser.
-		 */
-		goto done;
+	while(i < strLen) {
+		if(d->sepMode == KV_SEP_LEADING_SP) {
+			while(i < strLen && str[i] == ' ')
+				++i;
+			if(i == strLen)
+				break; /* OK if just trailing space */
+		}
+		if(d->stopChar != '\0' && str[i] == d->stopChar) {
+			stopped = 1;
+			break;
+		}
+		if(kvScanPair(npb, &i, d, &pair) != 0) {
+			if(d->partialMatch)
+				break;
+			FAIL(LN_WRONGPARSER);
+		}
+		++nPairs;
+		if(pairs != NULL) {
+			CHKR(kvPairsAdd(pairs, &pair));
+		}
+
+		if(d->sepMode == KV_SEP_RUN) {
+			if(i < strLen && !kvIsSep(d, str[i]))
+				break;
+			while(i < strLen && kvIsSep(d, str[i]))
+				++i;
+		} else if(d->sepMode == KV_SEP_ONE_SP) {
+			if(i < strLen && str[i] == ' ')
+				++i;
+		}
 	}
 
-	if((tokener = json_tokener_new()) == NULL)
-		goto done;
+	if(!stopped && nPairs < d->minPairs)
+		FAIL(LN_WRONGPARSER);
 
-	struct json_object *const json
-		= json_tokener_parse_ex(tokener, npb->str+i, (int) (npb->strLen - i));
+	*offs = i;
+done:
+	return r;
+}
 
-	if(json == NULL)
+/* create the json string for a CEF header field or extension value,
+ * resolving escape sequences. Short values are unescaped on the stack.
+ */
+static json_object *
+kvCEFValue2JSON(const char *const val, const size_t lenVal)
+{
+	char buf[256];
+	char *unescaped;
+	json_object *json = NULL;
+
+	if(lenVal == 0 || memchr(val, '\\', lenVal) == NULL)
+		return json_object_new_string_len(val, lenVal);
+
+	unescaped = (lenVal < sizeof(buf)) ? buf : malloc(lenVal + 1);
+	if(unescaped == NULL)
 		goto done;
+	size_t iDst = 0;
+	for(size_t iSrc = 0 ; iSrc < lenVal ; ++iSrc) {
+		if(val[iSrc] == '\\') {
+			++iSrc; /* we know the next char must exist! */
+			switch(val[iSrc]) {
+			case '=':	unescaped[iDst] = '=';
+					break;
+			case 'n':	unescaped[iDst] = '\n';
+					break;
+			case 'r':	unescaped[iDst] = '\r';
+					break;
+			case '\\':	unescaped[iDst] = '\\';
+					break;
+			case '/':	unescaped[iDst] = '/';
+					break;
+			default:	/* e.g. "\|" inside a header field */
+					unescaped[iDst] = val[iSrc];
+					break;
+			}
+		} else {
+			unescaped[iDst] = val[iSrc];
+		}
+		++iDst;
+	}
+	json = json_object_new_string_len(unescaped, iDst);
+	if(unescaped != buf)
+		free(unescaped);
+done:
+	return json;
+}
 
-	/* success, persist */
-	*parsed =  (i + tokener->char_offset) - *offs;
-	r = 0; /* success */
+/* add the pairs found by kvScan() to valroot */
+static int
+kvPairs2JSON(npb_t *const npb, const struct kv_dialect *const __restrict__ d,
+	const struct kv_pairs *const __restrict__ pairs,
+	struct json_object *const __restrict__ valroot)
+{
+	int r = 0;
+	char nameBuf[128];
+	char *name = nameBuf;
 
-	if(value == NULL) {
-		json_object_put(json);
-	} else {
-		*value = json;
+	for(int k = 0 ; k < pairs->nPairs ; ++k) {
+		const struct kv_pair *const pair = &pairs->pairs[k];
+		if(pair->lenName >= sizeof(nameBuf)) {
+			CHKN(name = malloc(pair->lenName + 1));
+		}
+		memcpy(name, npb->str + pair->iName, pair->lenName);
+		name[pair->lenName] = '\0';
+
+		json_object *json = NULL;
+		if(pair->hasVal) {
+			if(d->cefEscapes)
+				json = kvCEFValue2JSON(npb->str + pair->iVal, pair->lenVal);
+			else
+				json = newValueStr(npb, npb->str + pair->iVal, pair->lenVal);
+			CHKN(json);
+		}
+		json_object_object_add(valroot, name, json);
+		if(name != nameBuf) {
+			free(name);
+			name = nameBuf;
+		}
 	}
 
 done:
-	if(tokener != NULL)
-		json_tokener_free(tokener);
+	if(name != nameBuf)
+		free(name);
 	return r;
 }
 
-
-/* check if a char is valid inside a name of a NameValue list
- * The set of valid characters may be extended if there is good
- * need to do so. We have selected the current set carefully, but
- * may have overlooked some cases.
+/**
+ * Parse a name/value list with the key-value engine and, if requested,
+ * create a json object from it.
  */
-static inline int
-isValidNameChar(const char c)
+static int
+kvParse(npb_t *const npb, size_t *const offs, const struct kv_dialect *const d,
+	size_t *const parsed, struct json_object **value)
 {
-	return (isalnum(c)
-		|| c == '.'
-		|| c == '_'
-		|| c == '-'
-		) ? 1 : 0;
+	int r;
+	size_t i = *offs;
+	struct kv_pairs pairs;
+
+	kvPairsInit(&pairs);
+	CHKR(kvScan(npb, &i, d, (value == NULL) ? NULL : &pairs));
+	if(value != NULL) {
+		CHKN(*value = json_object_new_object());
+		CHKR(kvPairs2JSON(npb, d, &pairs, *value));
+	}
+	*parsed = i - *offs;
+
+done:
+	if(r != 0 && value != NULL && *value != NULL) {
+		json_object_put(*value);
+		*value = NULL;
+	}
+	kvPairsDestruct(&pairs);
+	return r;
 }
-/* helper to NameValue parser, parses out a a single name=value pair
- *
- * name must be alphanumeric characters, value must be non-whitespace
- * characters, if quoted than with symmetric quotes. Supported formats
- * - name=value
- * - name="value"
- * - name='value'
- * Note "name=" is valid and means a field with empty value.
- * TODO: so far, quote characters are not permitted WITHIN quoted values.
+
+
+/* check if a char is valid inside a name of the iptables motif.
+ * We try to keep the set as slim as possible, because the iptables
+ * parser may otherwise create a very broad match (especially the
+ * inclusion of simple words like "DF" cause grief here).
+ * Note: we have taken the permitted set from iptables log samples.
+ * Report bugs if we missed some additional rules.
  */
 static int
-parseNameValue(npb_t *const npb,
-	size_t *const __restrict__ offs,
-	struct json_object *const __restrict__ valroot,
-        const char sep, const char ass)
+isValidIPTablesNameChar(const char c)
+{
+	/* right now, upper case only is valid */
+	return ('A' <= c && c <= 'Z') ? 1 : 0;
+}
+
+static const struct kv_dialect kv_dialect_iptables = {
+	.isNameChar = isValidIPTablesNameChar,
+	.ass = '=',
+	.valMode = KV_VAL_TO_SPACE,
+	.sepMode = KV_SEP_ONE_SP,
+	.minPairs = 2,
+	.nameRequired = 1,
+	.flagNames = 1
+};
+
+/**
+ * Parser for iptables logs (the structured part).
+ * This parser is named "v2-iptables" because of a traditional
+ * parser named "iptables", which we do not want to replace, at
+ * least right now (we may re-think this before the first release).
+ * Names without a value (like "DF") are flags and stored as json null.
+ * Note that this motif must have at least two fields, otherwise it
+ * could detect things that are not iptables to be it. Further limits
+ * may be imposed in the future as we see additional need.
+ * added 2015-04-30 rgerhards
+ */
+PARSER_Parse(v2IPTables)
+	r = kvParse(npb, offs, &kv_dialect_iptables, parsed, value);
+	return r;
+}
+
+/* JSON tokenizer cache. Creating a new tokenizer for each parser call
+ * is costly, so we keep one per thread and just reset it before use.
+ * It is freed when the thread terminates. The key is deleted when the
+ * library is unloaded.
+ */
+static pthread_key_t tokener_key;
+static pthread_once_t tokener_key_once = PTHREAD_ONCE_INIT;
+static int tokener_key_created = 0;
+
+static void
+tokenerDestruct(void *const tokener)
+{
+	json_tokener_free((struct json_tokener*) tokener);
+}
+
+static void
+tokenerKeyCreate(void)
+{
+	tokener_key_created = (pthread_key_create(&tokener_key, tokenerDestruct) == 0);
+}
+
+/* threads that are still running keep their tokenizer, only the one of
+ * the unloading thread can be freed here.
+ */
+static void __attribute__((destructor))
+tokenerKeyDelete(void)
+{
+	struct json_tokener *tokener;
+
+	if(!tokener_key_created)
+		return;
+	if((tokener = pthread_getspecific(tokener_key)) != NULL)
+		json_tokener_free(tokener);
+	pthread_key_delete(tokener_key);
+}
+
+/* obtain this thread's tokenizer, ready for a new parse.
+ * @return tokenizer or NULL on out of memory
+ */
+static struct json_tokener *
+getTokener(void)
+{
+	struct json_tokener *tokener;
+
+	pthread_once(&tokener_key_once, tokenerKeyCreate);
+	tokener = pthread_getspecific(tokener_key);
+	if(tokener == NULL) {
+		if((tokener = json_tokener_new()) == NULL)
+			goto done;
+		pthread_setspecific(tokener_key, tokener);
+	} else {
+		json_tokener_reset(tokener);
+	}
+done:
+	return tokener;
+}
+
+
+/* JSON scanner for "raw" format. It just validates the JSON and finds
+ * its end, without creating any objects. We follow the json-c
+ * tokener in permitting trailing commas inside objects and arrays.
+ * The maximum nesting depth is also the same as json-c's default.
+ */
+#define JSON_SCAN_MAX_DEPTH 32
+static int
+jsonScanValue(const char *const str, const size_t strLen, size_t *const offs,
+	const int depth);
+
+static inline void
+jsonScanWhitespace(const char *const str, const size_t strLen, size_t *const offs)
+{
+	while(*offs < strLen && isspace(str[*offs]))
+		++(*offs);
+}
+
+static int
+jsonScanString(const char *const str, const size_t strLen, size_t *const offs)
 {
+	size_t i = *offs + 1; /* skip opening quote */
 	int r = LN_WRONGPARSER;
+
+	while(i < strLen && str[i] != '"') {
+		if(str[i] == '\\') {
+			++i;
+			if(i == strLen)
+				goto done;
+			if(str[i] == 'u') {
+				for(int j = 1 ; j < 5 ; ++j) {
+					if(i + j >= strLen || !isxdigit(str[i + j]))
+						goto done;
+				}
+				i += 4;
+			} else if(strchr("\"\\/bfnrt", str[i]) == NULL) {
+				goto done;
+			}
+		}
+		++i;
+	}
+	if(i == strLen)
+		goto done;
+
+	*offs = i + 1;
+	r = 0;
+done:
+	return r;
+}
+
+static int
+jsonScanNumber(const char *const str, const size_t strLen, size_t *const offs)
+{
 	size_t i = *offs;
-	char *name = NULL;
-
-	const size_t iName = i;
-	/*
-	If the assignator character is specified, search for it
-	If it's not, check key name validity
-	*/
-	while(i < npb->strLen && ((ass != 0) ? (npb->str[i] != ass) : isValidNameChar(npb->str[i])))
+	int r = LN_WRONGPARSER;
+
+	if(str[i] == '-')
+		++i;
+	if(i == strLen || !myisdigit(str[i]))
+		goto done;
+	while(i < strLen && myisdigit(str[i]))
+		++i;
+	if(i < strLen && str[i] == '.') {
 		++i;
-	if(i == iName || ((ass != 0) ? (npb->str[i] != ass) : (npb->str[i] != '=')))
-		goto done; /* no name at all! */
+		if(i == strLen || !myisdigit(str[i]))
+			goto done;
+		while(i < strLen && myisdigit(str[i]))
+			++i;
+	}
+	if(i < strLen && (str[i] == 'e' || str[i] == 'E')) {
+		++i;
+		if(i < strLen && (str[i] == '+' || str[i] == '-'))
+			++i;
+		if(i == strLen || !myisdigit(str[i]))
+			goto done;
+		while(i < strLen && myisdigit(str[i]))
+			++i;
+	}
 
-	const size_t lenName = i - iName;
-	++i; /* skip assignator */
+	*offs = i;
+	r = 0;
+done:
+	return r;
+}
 
-	char quoting = npb->str[i];
-	if(i < npb->strLen && (quoting == '"' || quoting == '\''))
-		i++;
-	else
-		quoting = 0;	//no quoting detected
-
-	const size_t iVal = i;
-	if(quoting) {
-		// wait on an unescaped matching quoting
-
-		/*
-		 * Fix by HSoszynski & KGuillemot to handle escaped quote & backslash infinitly
-		 * Continue while we don't encounter the ending quote, and while it's not escaped
-		 * a" => end
-		 * a\" => continue
-		 * a\\" => end
-		 * a\\\" => continue
-		 * ...
-		 */
-		int continuous_backslash = 0;
-		while(i < npb->strLen && (npb->str[i] != quoting || continuous_backslash%2 == 1 )) {
-			if ( npb->str[i] == '\\' ) {
-				continuous_backslash++;
-			} else {
-				continuous_backslash = 0;
-			}
+/* scan object or array members, *offs is at the opening bracket */
+static int
+jsonScanContainer(const char *const str, const size_t strLen, size_t *const offs,
+	const int depth)
+{
+	const char closing = (str[*offs] == '{') ? '}' : ']';
+	size_t i = *offs + 1;
+	int r = LN_WRONGPARSER;
+
+	if(depth > JSON_SCAN_MAX_DEPTH)
+		goto done;
+
+	jsonScanWhitespace(str, strLen, &i);
+	while(i < strLen && str[i] != closing) {
+		if(closing == '}') {
+			if(str[i] != '"')
+				goto done;
+			CHKR(jsonScanString(str, strLen, &i));
+			jsonScanWhitespace(str, strLen, &i);
+			if(i == strLen || str[i] != ':')
+				goto done;
 			++i;
 		}
-	}
-	else {
-		/* We seek characters as long as:
-		- we have characters remaining
-		- the character is NOT a whitespace (default separator)
-		- the character is NOT the separator set explicitely by the user (sep)
-		- the character IS the separator (sep), BUT is escaped
-		*/
-		/*
-		 * Fix by HSoszynski & KGuillemot to handle escaped separator & backslash infinitly
-		 * Continue while we don't encounter the ending separator, and while it's not escaped
-		 * a, => end
-		 * a\, => continue
-		 * a\\, => end
-		 * a\\\, => continue
-		 * ...
-		 */
-		int continuous_backslash = 0;
-		while(i < npb->strLen
-			&& ((sep == 0 ? (!isspace(npb->str[i])) : (npb->str[i] != sep))
-				|| continuous_backslash%2 == 1)) {
-			if ( npb->str[i] == '\\' ) {
-				continuous_backslash++;
-			} else {
-				continuous_backslash = 0;
-			}
+		CHKR(jsonScanValue(str, strLen, &i, depth));
+		jsonScanWhitespace(str, strLen, &i);
+		if(i < strLen && str[i] == ',') {
 			++i;
+			jsonScanWhitespace(str, strLen, &i);
+		} else if(i < strLen && str[i] != closing) {
+			goto done;
 		}
 	}
-
-	// in case of quoting, ensure we skip it
-	if(i < npb->strLen && npb->str[i] == quoting)
-		++i;
-	else if(quoting)
+	if(i == strLen)
 		goto done;
 
+	*offs = i + 1;
+	r = 0;
+done:
+	return r;
+}
 
-	const size_t lenVal = i - iVal - (quoting ? 1 : 0);
+static int
+jsonScanValue(const char *const str, const size_t strLen, size_t *const offs,
+	const int depth)
+{
+	size_t i = *offs;
+	int r = LN_WRONGPARSER;
+
+	jsonScanWhitespace(str, strLen, &i);
+	if(i == strLen)
+		goto done;
+
+	switch(str[i]) {
+	case '{':
+	case '[':
+		CHKR(jsonScanContainer(str, strLen, &i, depth + 1));
+		break;
+	case '"':
+		CHKR(jsonScanString(str, strLen, &i));
+		break;
+	case 't':
+		if(strLen - i < 4 || strncmp(str + i, "true", 4))
+			goto done;
+		i += 4;
+		break;
+	case 'f':
+		if(strLen - i < 5 || strncmp(str + i, "false", 5))
+			goto done;
+		i += 5;
+		break;
+	case 'n':
+		if(strLen - i < 4 || strncmp(str + i, "null", 4))
+			goto done;
+		i += 4;
+		break;
+	default:
+		CHKR(jsonScanNumber(str, strLen, &i));
+		break;
+	}
 
-	/* parsing OK */
 	*offs = i;
 	r = 0;
+done:
+	return r;
+}
+
 
-	if(valroot == NULL)
+struct data_JSON {
+	int fmtRaw;	/**< return JSON text as string, do not parse it */
+};
+/**
+ * Parse JSON. This parser tries to find JSON data inside a message.
+ * If it finds valid JSON, it will extract it. Extra data after the
+ * JSON is permitted.
+ * Note: the json-c JSON parser treats whitespace after the actual
+ * json to be part of the json. So in essence, any whitespace is
+ * processed by this parser. We use the same semantics to keep things
+ * neatly in sync. If json-c changes for some reason or we switch to
+ * an alternate json lib, we probably need to be sure to keep that
+ * behaviour, and probably emulate it.
+ * In raw format, the JSON is only validated and delimited, and the
+ * value is its text (without trailing whitespace).
+ * added 2015-04-28 by rgerhards, v1.1.2
+ */
+PARSER_Parse(JSON)
+	const size_t i = *offs;
+	struct data_JSON *const data = (struct data_JSON*) pdata;
+	struct json_tokener *tokener;
+
+	if(npb->str[i] != '{' && npb->str[i] != ']') {
+		/* this can't be json, see RFC4627, Sect. 2
+		 * see this bug in json-c:
+		 * https://github.com/json-c/json-c/issues/181
+		 * In any case, it's better to do this quick check,
+		 * even if json-c did not have the bug because this
+		 * check here is much faster than calling the parser.
+		 */
 		goto done;
+	}
+
+	if(data->fmtRaw) {
+		size_t end = i;
+		CHKR(jsonScanValue(npb->str, npb->strLen, &end, 0));
+		size_t iWhitespace = end;
+		jsonScanWhitespace(npb->str, npb->strLen, &iWhitespace);
+		*parsed = iWhitespace - *offs;
+		if(value != NULL) {
+			CHKN(*value = json_object_new_string_len(npb->str+i, end - i));
+		}
+		r = 0; /* success */
+		goto done;
+	}
+
+	if((tokener = getTokener()) == NULL)
+		goto done;
+
+	struct json_object *const json
+		= json_tokener_parse_ex(tokener, npb->str+i, (int) (npb->strLen - i));
+
+	if(json == NULL)
+		goto done;
+
+	/* success, persist */
+	*parsed =  (i + tokener->char_offset) - *offs;
+	r = 0; /* success */
+
+	if(value == NULL) {
+		json_object_put(json);
+	} else {
+		*value = json;
+	}
+
+done:
+	return r;
+}
+
+/* common constructor for the JSON-based parsers
+ * @param[in] parserName name for error messages
+ */
+static int
+constructJSONFmt(ln_ctx ctx, json_object *const json, struct data_JSON **pdata,
+	const char *const parserName)
+{
+	int r = 0;
+	struct data_JSON *data;
+
+	CHKN(data = (struct data_JSON*) calloc(1, sizeof(struct data_JSON)));
+
+	if(json == NULL)
+		goto done;
+
+	struct json_object_iterator it = json_object_iter_begin(json);
+	struct json_object_iterator itEnd = json_object_iter_end(json);
+	while (!json_object_iter_equal(&it, &itEnd)) {
+		const char *key = json_object_iter_peek_name(&it);
+		struct json_object *const val = json_object_iter_peek_value(&it);
+		if(!strcmp(key, "format")) {
+			const char *fmtmode = json_object_get_string(val);
+			if(!strcmp(fmtmode, "raw")) {
+				data->fmtRaw = 1;
+			} else if(!strcmp(fmtmode, "object")) {
+				data->fmtRaw = 0;
+			} else {
+				ln_errprintf(ctx, 0, "invalid value for %s:format %s",
+					parserName, fmtmode);
+			}
+		} else {
+			if(!(strcmp(key, "name") == 0 && strcmp(json_object_get_string(val), "-") == 0)) {
+				ln_errprintf(ctx, 0, "invalid param for %s %s", parserName, key);
+			}
+		}
+		json_object_iter_next(&it);
+	}
 
-	CHKN(name = malloc(lenName+1));
-	memcpy(name, npb->str+iName, lenName);
-	name[lenName] = '\0';
-	json_object *json;
-	CHKN(json = json_object_new_string_len(npb->str+iVal, lenVal));
-	json_object_object_add(valroot, name, json);
 done:
-	free(name);
+	*pdata = data;
 	return r;
 }
+PARSER_Construct(JSON)
+{
+	return constructJSONFmt(ctx, json, (struct data_JSON**) pdata, "json");
+}
+PARSER_Destruct(JSON)
+{
+	free(pdata);
+}
+
 
+/* check if a char is valid inside a name of a NameValue list
+ * The set of valid characters may be extended if there is good
+ * need to do so. We have selected the current set carefully, but
+ * may have overlooked some cases.
+ */
+static inline int
+isValidNameChar(const char c)
+{
+	return (isalnum(c)
+		|| c == '.'
+		|| c == '_'
+		|| c == '-'
+		) ? 1 : 0;
+}
 /**
  * Parse CEE syslog.
  * This essentially is a JSON parser, with additional restrictions:
@@ -2521,7 +3211,8 @@ done:
  */
 PARSER_Parse(CEESyslog)
 	size_t i = *offs;
-	struct json_tokener *tokener = NULL;
+	struct data_JSON *const data = (struct data_JSON*) pdata;
+	struct json_tokener *tokener;
 	struct json_object *json = NULL;
 
 	if(npb->strLen < i + 7  || /* "@cee:{}" is minimum text */
@@ -2540,7 +3231,22 @@ PARSER_Parse(CEESyslog)
 		goto done;
 		/* note: we do not permit arrays in CEE mode */
 
-	if((tokener = json_tokener_new()) == NULL)
+	if(data->fmtRaw) {
+		size_t end = i;
+		CHKR(jsonScanValue(npb->str, npb->strLen, &end, 0));
+		size_t iWhitespace = end;
+		jsonScanWhitespace(npb->str, npb->strLen, &iWhitespace);
+		if(iWhitespace != npb->strLen)
+			goto done;
+		*parsed =  npb->strLen;
+		if(value != NULL) {
+			CHKN(*value = json_object_new_string_len(npb->str+i, end - i));
+		}
+		r = 0; /* success */
+		goto done;
+	}
+
+	if((tokener = getTokener()) == NULL)
 		goto done;
 
 	json = json_tokener_parse_ex(tokener, npb->str+i, (int) (npb->strLen - i));
@@ -2561,78 +3267,45 @@ PARSER_Parse(CEESyslog)
 	}
 
 done:
-	if(tokener != NULL)
-		json_tokener_free(tokener);
 	if(json != NULL)
 		json_object_put(json);
 	return r;
 }
+PARSER_Construct(CEESyslog)
+{
+	return constructJSONFmt(ctx, json, (struct data_JSON**) pdata, "cee-syslog");
+}
+PARSER_Destruct(CEESyslog)
+{
+	free(pdata);
+}
 
 
 struct data_NameValue {
-	char sep;       /* separator (between key/value couples) */
-	char ass;	/* assignator (between key and value) */
+	struct kv_dialect dialect;
 };
 
 /**
  * Parser for name/value pairs.
  * On entry must point to alnum char. All following chars must be
- * name/value pairs delimited by whitespace up until the end of string.
- * For performance reasons, this works in two stages. In the first
- * stage, we only detect if the motif is correct. The second stage is
- * only called when we know it is. In it, we go once again over the
- * message again and actually extract the data. This is done because
- * data extraction is relatively expensive and in most cases we will
- * have much more frequent mismatches than matches.
+ * name/value pairs delimited by whitespace (or the configured separator)
+ * up until the end of string. Processing stops at the first element
+ * which is not a name/value pair, everything up to it is matched.
+ * Supported formats are
+ * - name=value
+ * - name="value"
+ * - name='value'
+ * Note "name=" is valid and means a field with empty value.
+ * Quote characters and separators may be escaped by a backslash.
  * added 2015-04-25 rgerhards
  */
 PARSER_Parse(NameValue)
-	size_t i = *offs;
-        struct data_NameValue *const data = (struct data_NameValue*) pdata;
-        const char sep = data->sep;
-        const char ass = data->ass;
-
-        LN_DBGPRINTF(npb->ctx, "in parse_NameValue, separator is '%c'(0x%02x) assignator is '%c'(0x%02x)"
-			,sep, sep, ass, ass);
+	struct data_NameValue *const data = (struct data_NameValue*) pdata;
 
-	/* stage one */
-	while(i < npb->strLen) {
-		if (parseNameValue(npb, &i, NULL, sep, ass) == 0 ) {
-			// Check if there is at least one time the separator after value
-			if( i < npb->strLen && !(sep == 0 ? (isspace(npb->str[i])) : (npb->str[i] == sep)) )
-				break;
-			while(i < npb->strLen && (sep == 0 ? (isspace(npb->str[i])) : (npb->str[i] == sep)))
-				++i;
-		} else {
-			break;
-		}
-	}
-
-	/* success, persist */
-	*parsed = i - *offs;
-	r = 0; /* success */
-
-	/* stage two */
-	if(value == NULL)
-		goto done;
-
-	i = *offs;
-	CHKN(*value = json_object_new_object());
-	while(i < npb->strLen) {
-		if (parseNameValue(npb, &i, *value, sep, ass) == 0 ) {
-			// Check if there is at least one time the separator after value
-			if( i < npb->strLen && !(sep == 0 ? (isspace(npb->str[i])) : (npb->str[i] == sep)) )
-				break;
-			while(i < npb->strLen && ((sep == 0) ? (isspace(npb->str[i])) : (npb->str[i] == sep)))
-				++i;
-		} else {
-			break;
-		}
-	}
-
-	/* TODO: fix mem leak if alloc json fails */
+	LN_DBGPRINTF(npb->ctx, "in parse_NameValue, separator is '%c'(0x%02x) assignator is '%c'(0x%02x)"
+		, data->dialect.sep, data->dialect.sep, data->dialect.ass, data->dialect.ass);
 
-done:
+	r = kvParse(npb, offs, &data->dialect, parsed, value);
 	return r;
 }
 
@@ -2643,12 +3316,14 @@ PARSER_Construct(NameValue)
         struct data_NameValue *data = (struct data_NameValue*) calloc(1, sizeof(struct data_NameValue));
         struct json_object *obj;
         const char *str;
+	char sep = 0;
+	char ass = 0;
 
         if(json_object_object_get_ex(json, "extradata", &obj) != 0) {
 		LN_DBGPRINTF(ctx, "found 'extradata' in fields, assigning to 'separator'");
                 if(json_object_get_string_len(obj) == 1) {
                         str = json_object_get_string(obj);
-                        data->sep = str[0];
+                        sep = str[0];
                 }
 		else {
 			ln_errprintf(ctx, 0, "name-value-list's extradata should only be 1 character");
@@ -2661,7 +3336,7 @@ PARSER_Construct(NameValue)
 		LN_DBGPRINTF(ctx, "found 'separator' in fields");
                 if(json_object_get_string_len(obj) == 1) {
                         str = json_object_get_string(obj);
-                        data->sep = str[0];
+                        sep = str[0];
                 }
 		else {
 			ln_errprintf(ctx, 0, "name-value-list's 'separator' field should only be 1 character");
@@ -2674,7 +3349,7 @@ PARSER_Construct(NameValue)
 		LN_DBGPRINTF(ctx, "found 'assignator' in fields");
                 if(json_object_get_string_len(obj) == 1) {
                         str = json_object_get_string(obj);
-                        data->ass = str[0];
+                        ass = str[0];
                 }
 		else {
 			ln_errprintf(ctx, 0, "name-value-list's 'assignator' field should only be 1 character");
@@ -2683,6 +3358,18 @@ PARSER_Construct(NameValue)
 		}
         }
 
+	/* If the assignator is specified, the name is everything in
+	 * front of it. If not, the name must consist of valid name chars.
+	 */
+	data->dialect.isNameChar = (ass == 0) ? isValidNameChar : NULL;
+	data->dialect.ass = (ass == 0) ? '=' : ass;
+	data->dialect.sep = sep;
+	data->dialect.valMode = KV_VAL_WORD;
+	data->dialect.sepMode = KV_SEP_RUN;
+	data->dialect.nameRequired = 1;
+	data->dialect.quoting = 1;
+	data->dialect.partialMatch = 1;
+
 	*pdata = data;
 done:
 	if(r != 0)
@@ -2746,7 +3433,7 @@ PARSER_Parse(MAC48)
 	r = 0; /* success */
 
 	if(value != NULL) {
-		CHKN(*value = json_object_new_string_len(npb->str+i, 17));
+		CHKN(*value = newValueStr(npb, npb->str+i, 17));
 	}
 
 done:
@@ -2754,180 +3441,56 @@ done:
 }
 
 
-/* This parses the extension value and updates the index
- * to point to the end of it.
- */
-static int
-cefParseExtensionValue(npb_t *const npb,
-	size_t *__restrict__ iEndVal)
-{
-	int r = 0;
-	size_t i = *iEndVal;
-	size_t iLastWordBegin;
-	/* first find next unquoted equal sign and record begin of
-	 * last word in front of it - this is the actual end of the
-	 * current name/value pair and the begin of the next one.
-	 */
-	int hadSP = 0;
-	int inEscape = 0;
-	for(iLastWordBegin = 0 ; i < npb->strLen ; ++i) {
-		if(inEscape) {
-			if(npb->str[i] != '=' &&
-			   npb->str[i] != '\\' &&
-			   npb->str[i] != 'r' &&
-			   npb->str[i] != 'n' && 
-			   npb->str[i] != '/')
-			FAIL(LN_WRONGPARSER);
-			inEscape = 0;
-		} else {
-			if(npb->str[i] == '=') {
-				break;
-			} else if(npb->str[i] == '\\') {
-				inEscape = 1;
-			} else if(npb->str[i] == ' ') {
-				hadSP = 1;
-			} else {
-				if(hadSP) {
-					iLastWordBegin = i;
-					hadSP = 0;
-				}
-			}
-		}
-	}
-
-	/* Note: iLastWordBegin can never be at offset zero, because
-	 * the CEF header starts there!
-	 */
-	if(i < npb->strLen) {
-		*iEndVal = (iLastWordBegin == 0) ? i : iLastWordBegin - 1;
-	} else {
-		*iEndVal = i;
-	}
-done:
-	return r;
-}
-
-/* must be positioned on first char of name, returns index
- * of end of name.
+/* check if a char is valid inside a CEF extension name.
  * Note: ArcSight violates the CEF spec ifself: they generate
  * leading underscores in their extension names, which are
  * definitely not alphanumeric. We still accept them...
  * They also seem to use dots.
  */
 static int
-cefParseName(npb_t *const npb,
-	size_t *const __restrict__ i)
+isValidCEFNameChar(const char c)
 {
-	int r = 0;
-	while(*i < npb->strLen && npb->str[*i] != '=') {
-		if(!(isalnum(npb->str[*i]) || npb->str[*i] == '_' || npb->str[*i] == '.'))
-			FAIL(LN_WRONGPARSER);
-		++(*i);
-	}
-done:
-	return r;
+	return (isalnum(c) || c == '_' || c == '.') ? 1 : 0;
 }
 
-/* parse CEF extensions. They are basically name=value
+/* CEF extensions are basically name=value
  * pairs with the ugly exception that values may contain
  * spaces but need NOT to be quoted. Thankfully, at least
  * names are specified as being alphanumeric without spaces
- * in them. So we must add a lookahead parser to check if
+ * in them. So the value scanner does a lookahead to check if
  * a word is a name (and thus the begin of a new pair) or
- * not. This is done by subroutines.
+ * not.
  */
-static int
-cefParseExtensions(npb_t *const npb,
-	size_t *const __restrict__ offs,
-	json_object *const __restrict__ jroot)
-{
-	int r = 0;
-	size_t i = *offs;
-	size_t iName, lenName;
-	size_t iValue, lenValue;
-	char *name = NULL;
-	char *value = NULL;
-
-	while(i < npb->strLen) {
-		while(i < npb->strLen && npb->str[i] == ' ')
-			++i;
-		iName = i;
-		CHKR(cefParseName(npb, &i));
-
-		if(npb->str[i] != '=')
-			FAIL(LN_WRONGPARSER);
-		lenName = i - iName;
-		
-		/* Init if the last value is empty */
-		lenValue = 0;
-		if(i < npb->strLen){
-			++i; /* skip '=' */
-
-			iValue = i;
-			CHKR(cefParseExtensionValue(npb, &i));
-			lenValue = i - iValue;
-
-			++i; /* skip past value */
-		}
-
-		if(jroot != NULL) {
-			CHKN(name = malloc(sizeof(char) * (lenName + 1)));
-			memcpy(name, npb->str+iName, lenName);
-			name[lenName] = '\0';
-			CHKN(value = malloc(sizeof(char) * (lenValue + 1)));
-			/* copy value but escape it */
-			size_t iDst = 0;
-			for(size_t iSrc = 0 ; iSrc < lenValue ; ++iSrc) {
-				if(npb->str[iValue+iSrc] == '\\') {
-					++iSrc; /* we know the next char must exist! */
-					switch(npb->str[iValue+iSrc]) {
-					case '=':	value[iDst] = '=';
-							break;
-					case 'n':	value[iDst] = '\n';
-							break;
-					case 'r':	value[iDst] = '\r';
-							break;
-					case '\\':	value[iDst] = '\\';
-							break;
-					case '/':	value[iDst] = '/';
-							break;
-					default:	break;
-					}
-				} else {
-					value[iDst] = npb->str[iValue+iSrc];
-				}
-				++iDst;
-			}
-			value[iDst] = '\0';
-			json_object *json;
-			CHKN(json = json_object_new_string(value));
-			json_object_object_add(jroot, name, json);
-			free(name); name = NULL;
-			free(value); value = NULL;
-		}
-	}
-
-	*offs = npb->strLen; /* this parser consume everything or fails */
+static const struct kv_dialect kv_dialect_cef = {
+	.isNameChar = isValidCEFNameChar,
+	.ass = '=',
+	.valMode = KV_VAL_CEF,
+	.sepMode = KV_SEP_LEADING_SP,
+	.cefEscapes = 1
+};
 
-done:
-	free(name);
-	free(value);
-	return r;
-}
+/* names of the CEF header fields, in the order they appear
+ * inside the message.
+ */
+#define CEF_NUM_HDR_FIELDS 6
+static const char *const cefHdrFieldNames[CEF_NUM_HDR_FIELDS] = {
+	"DeviceVendor", "DeviceProduct", "DeviceVersion",
+	"SignatureID", "Name", "Severity"
+};
 
 /* gets a CEF header field. Must be positioned on the
  * first char after the '|' in front of field.
  * Note that '|' may be escaped as "\|", which also means
  * we need to supprot "\\" (see CEF spec for details).
- * We return the string in *val, if val is non-null. In
- * that case we allocate memory that the caller must free.
- * This is necessary because there are potentially escape
- * sequences inside the string.
+ * If span is non-NULL, the field is returned as offset and
+ * length into npb->str. Escape sequences are resolved only
+ * when the json string is created, so no memory needs to be
+ * allocated here.
  */
 static int
 cefGetHdrField(npb_t *const npb,
 	size_t *const __restrict__ offs,
-	char **val)
+	struct kv_pair *const span)
 {
 	int r = 0;
 	size_t i = *offs;
@@ -2944,42 +3507,29 @@ cefGetHdrField(npb_t *const npb,
 	if(npb->str[i] != '|')
 		FAIL(LN_WRONGPARSER);
 
-	const size_t iBegin = *offs;
+	if(span != NULL) {
+		span->iVal = *offs;
+		span->lenVal = i - *offs;
+	}
 	/* success, persist */
 	*offs = i + 1;
-
-	if(val == NULL) {
-		r = 0;
-		goto done;
-	}
-	
-	const size_t len = i - iBegin;
-	CHKN(*val = malloc(len + 1));
-	size_t iDst = 0;
-	for(size_t iSrc = 0 ; iSrc < len ; ++iSrc) {
-		if(npb->str[iBegin+iSrc] == '\\')
-			++iSrc; /* we already checked above that this is OK! */
-		(*val)[iDst++] = npb->str[iBegin+iSrc];
-	}
-	(*val)[iDst] = 0;
-	r = 0;
 done:
 	return r;
 }
 
 /**
  * Parser for ArcSight Common Event Format (CEF) version 0.
+ * Header fields and extensions are both kept as spans into
+ * the message and are unescaped straight into the final json
+ * strings.
  * added 2015-05-05 by rgerhards, v1.1.2
  */
 PARSER_Parse(CEF)
 	size_t i = *offs;
-	char *vendor = NULL;
-	char *product = NULL;
-	char *version = NULL;
-	char *sigID = NULL;
-	char *name = NULL;
-	char *severity = NULL;
+	struct kv_pair hdr[CEF_NUM_HDR_FIELDS];
+	struct kv_pairs extensions;
 
+	kvPairsInit(&extensions);
 	/* minimum header: "CEF:0|x|x|x|x|x|x|" -->  17 chars */
 	if(npb->strLen < i + 17 ||
 	   npb->str[i]   != 'C' ||
@@ -2992,30 +3542,19 @@ PARSER_Parse(CEF)
 	
 	i += 6; /* position on '|' */
 
-	CHKR(cefGetHdrField(npb, &i, (value == NULL) ? NULL : &vendor));
-	CHKR(cefGetHdrField(npb, &i, (value == NULL) ? NULL : &product));
-	CHKR(cefGetHdrField(npb, &i, (value == NULL) ? NULL : &version));
-	CHKR(cefGetHdrField(npb, &i, (value == NULL) ? NULL : &sigID));
-	CHKR(cefGetHdrField(npb, &i, (value == NULL) ? NULL : &name));
-	CHKR(cefGetHdrField(npb, &i, (value == NULL) ? NULL : &severity));
+	for(int f = 0 ; f < CEF_NUM_HDR_FIELDS ; ++f)
+		CHKR(cefGetHdrField(npb, &i, (value == NULL) ? NULL : &hdr[f]));
 
 	while(i < npb->strLen && npb->str[i] == ' ') /* skip leading SP */
 		++i;
 
 	/* OK, we now know we have a good header. Now, we need
-	 * to process extensions.
-	 * This time, we do NOT pre-process the extension, but rather
-	 * persist them directly to JSON. This is contrary to other
-	 * parsers, but as the CEF header is pretty unique, this time
-	 * it is extremely unlikely we will get a no-match during
-	 * extension processing. Even if so, nothing bad happens, as
-	 * the extracted data is discarded. But the regular case saves
-	 * us processing time and complexity. The only time when we
-	 * cannot directly process it is when the caller asks us not
-	 * to persist the data. So this must be handled differently.
+	 * to process extensions. They are scanned only once, the
+	 * json object is built from the spans found.
 	 */
-	 size_t iBeginExtensions = i;
-	 CHKR(cefParseExtensions(npb, &i, NULL));
+	CHKR(kvScan(npb, &i, &kv_dialect_cef, (value == NULL) ? NULL : &extensions));
+	/* the CEF extensions consume everything or fail */
+	i = npb->strLen;
 
 	/* success, persist */
 	*parsed = i - *offs;
@@ -3024,120 +3563,45 @@ PARSER_Parse(CEF)
 	if(value != NULL) {
 		CHKN(*value = json_object_new_object());
 		json_object *json;
-		CHKN(json = json_object_new_string(vendor));
-		json_object_object_add(*value, "DeviceVendor", json);
-		CHKN(json = json_object_new_string(product));
-		json_object_object_add(*value, "DeviceProduct", json);
-		CHKN(json = json_object_new_string(version));
-		json_object_object_add(*value, "DeviceVersion", json);
-		CHKN(json = json_object_new_string(sigID));
-		json_object_object_add(*value, "SignatureID", json);
-		CHKN(json = json_object_new_string(name));
-		json_object_object_add(*value, "Name", json);
-		CHKN(json = json_object_new_string(severity));
-		json_object_object_add(*value, "Severity", json);
+		for(int f = 0 ; f < CEF_NUM_HDR_FIELDS ; ++f) {
+			CHKN(json = kvCEFValue2JSON(npb->str + hdr[f].iVal, hdr[f].lenVal));
+			json_object_object_add(*value, cefHdrFieldNames[f], json);
+		}
 
 		json_object *jext;
 		CHKN(jext = json_object_new_object());
 		json_object_object_add(*value, "Extensions", jext);
 
-		i = iBeginExtensions;
-		cefParseExtensions(npb, &i, jext);
+		CHKR(kvPairs2JSON(npb, &kv_dialect_cef, &extensions, jext));
 	}
 
 done:
+	kvPairsDestruct(&extensions);
 	if(r != 0 && value != NULL && *value != NULL) {
 		json_object_put(*value);
-		value = NULL;
-	}
-	free(vendor);
-	free(product);
-	free(version);
-	free(sigID);
-	free(name);
-	free(severity);
+		*value = NULL;
+	}
 	return r;
 }
 
 struct data_CheckpointLEA {
-	char terminator; /* '\0' - do not use */
+	struct kv_dialect dialect;
 };
 /**
  * Parser for Checkpoint LEA on-disk format.
+ * This is a list of "name: value;" pairs. If a terminator is
+ * configured, the list ends in front of it.
  * added 2015-06-18 by rgerhards, v1.1.2
  */
 PARSER_Parse(CheckpointLEA)
-	size_t i = *offs;
-	size_t iName, lenName;
-	size_t iValue, lenValue;
-	int foundFields = 0;
-	char *name = NULL;
-	char *val = NULL;
 	struct data_CheckpointLEA *const data = (struct data_CheckpointLEA*) pdata;
-
-	while(i < npb->strLen) {
-		while(i < npb->strLen && npb->str[i] == ' ') /* skip leading SP */
-			++i;
-		if(i == npb->strLen) { /* OK if just trailing space */
-			if(foundFields == 0)
-				FAIL(LN_WRONGPARSER);
-			break; /* we are done with the loop, all processed */
-		} else {
-			++foundFields;
-		}
-		iName = i;
-		/* TODO: do a stricter check? ... but we don't have a spec */
-		if(i < npb->strLen && npb->str[i] == data->terminator) {
-			break;
-		}
-		while(i < npb->strLen && npb->str[i] != ':') {
-			++i;
-		}
-		if(i+1 >= npb->strLen || npb->str[i] != ':') {
-			FAIL(LN_WRONGPARSER);
-		}
-		lenName = i - iName;
-		++i; /* skip ':' */
-
-		while(i < npb->strLen && npb->str[i] == ' ') /* skip leading SP */
-			++i;
-		iValue = i;
-		while(i < npb->strLen && npb->str[i] != ';') {
-			++i;
-		}
-		if(i+1 > npb->strLen || npb->str[i] != ';')
-			FAIL(LN_WRONGPARSER);
-		lenValue = i - iValue;
-		++i; /* skip ';' */
-
-		if(value != NULL) {
-			CHKN(name = malloc(sizeof(char) * (lenName + 1)));
-			memcpy(name, npb->str+iName, lenName);
-			name[lenName] = '\0';
-			CHKN(val = malloc(sizeof(char) * (lenValue + 1)));
-			memcpy(val, npb->str+iValue, lenValue);
-			val[lenValue] = '\0';
-			if(*value == NULL)
-				CHKN(*value = json_object_new_object());
-			json_object *json;
-			CHKN(json = json_object_new_string(val));
-			json_object_object_add(*value, name, json);
-			free(name); name = NULL;
-			free(val); val = NULL;
-		}
-	}
-
-	/* success, persist */
-	*parsed =  i - *offs;
-	r = 0; /* success */
-
-done:
-	free(name);
-	free(val);
-	if(r != 0 && value != NULL && *value != NULL) {
-		json_object_put(*value);
-		value = NULL;
+	/* nothing left to parse is an (empty) match, without value */
+	if(*offs == npb->strLen) {
+		*parsed = 0;
+		return 0;
 	}
+	/* TODO: do a stricter check? ... but we don't have a spec */
+	r = kvParse(npb, offs, &data->dialect, parsed, value);
 	return r;
 }
 PARSER_Construct(CheckpointLEA)
@@ -3145,6 +3609,13 @@ PARSER_Construct(CheckpointLEA)
 	int r = 0;
 	struct data_CheckpointLEA *data = (struct data_CheckpointLEA*) calloc(1, sizeof(struct data_CheckpointLEA));
 
+	data->dialect.ass = ':';
+	data->dialect.valTerm = ';';
+	data->dialect.valMode = KV_VAL_TERMINATED;
+	data->dialect.sepMode = KV_SEP_LEADING_SP;
+	data->dialect.minPairs = 1;
+	data->dialect.skipSPAfterAss = 1;
+
 	if(json == NULL)
 		goto done;
 
@@ -3161,7 +3632,7 @@ PARSER_Construct(CheckpointLEA)
 				r = LN_BADCONFIG;
 				goto done;
 			}
-			data->terminator = *optval;
+			data->dialect.stopChar = *optval;
 		}
 		json_object_iter_next(&it);
 	}
@@ -3209,8 +3680,71 @@ chkNoDupeDotInParserDefs(ln_ctx ctx, struct json_object *parsers)
 	return r;
 }
 
+/* check if any parser inside the repeat body is named ".". Only
+ * in that case the element value must be extracted from the parsed
+ * object. This is done once at load time, so that the common case
+ * does not need to inspect the result on every iteration.
+ */
+static int
+repeatHasDotName(struct ln_pdag *const dag)
+{
+	for(int i = 0 ; i < dag->nparsers ; ++i) {
+		const char *const name = dag->parsers[i].name;
+		if(name != NULL && name[0] == '.' && name[1] == '\0')
+			return 1;
+		if(repeatHasDotName(dag->parsers[i].node))
+			return 1;
+	}
+	return 0;
+}
+
+/* if the "while" part is a single literal, return its text so that
+ * it can be matched inline without going through the pdag. Returns
+ * NULL otherwise.
+ */
+static const char *
+repeatGetWhileLiteral(struct json_object *cond)
+{
+	struct json_object *type;
+	struct json_object *text;
+
+	if(json_object_get_type(cond) == json_type_array) {
+		if(json_object_array_length(cond) != 1)
+			return NULL;
+		cond = json_object_array_get_idx(cond, 0);
+	}
+	if(json_object_get_type(cond) != json_type_object
+	   || !json_object_object_get_ex(cond, "type", &type)
+	   || strcmp(json_object_get_string(type), "literal")
+	   || !json_object_object_get_ex(cond, "text", &text))
+		return NULL;
+	const char *const lit = json_object_get_string(text);
+	return (lit == NULL || *lit == '\0') ? NULL : lit;
+}
+
+/* The inline check of a literal "while" condition bypasses tryParser(),
+ * so it must not be used if anything observes the individual parser
+ * calls: rule mockup, telemetry, path profile, backtracking analysis,
+ * work budget and the advanced stats exec path.
+ */
+static inline int
+repeatInlineWhile(const npb_t *const npb)
+{
+#ifdef ADVANCED_STATS
+	(void) npb;
+	return 0;
+#else
+	return !(npb->ctx->opts & LN_CTXOPT_ADD_RULE) && npb->tm == NULL
+		&& npb->ppPos == NULL && npb->bt == NULL && npb->budget == NULL;
+#endif
+}
+
 /**
  * "repeat" special parser.
+ * The object the body is parsed into becomes the array element
+ * itself. Only if the body uses name "." (known at load time), the
+ * value is taken out of it, and the then-empty object is reused for
+ * the next iteration.
  */
 PARSER_Parse(Repeat)
 	struct data_Repeat *const data = (struct data_Repeat*) pdata;
@@ -3218,10 +3752,15 @@ PARSER_Parse(Repeat)
 	size_t strtoffs = *offs;
 	size_t lastKnownGood = strtoffs;
 	struct json_object *json_arr = NULL;
+	struct json_object *parsed_value = NULL;
 	const size_t parsedTo_save = npb->parsedTo;
 
+	/* if no value is needed, the body is only matched */
+	if(value == NULL)
+		++npb->noValues;
 	do {
-		struct json_object *parsed_value = json_object_new_object();
+		if(parsed_value == NULL && value != NULL)
+			CHKN(parsed_value = json_object_new_object());
 		r = ln_normalizeRec(npb, data->parser, strtoffs, 1,
 				    parsed_value, &endNode);
 		strtoffs = npb->parsedTo;
@@ -3229,7 +3768,6 @@ PARSER_Parse(Repeat)
 			r, npb->parsedTo, json_object_to_json_string(parsed_value));
 
 		if(r != 0) {
-			json_object_put(parsed_value);
 			if(data->permitMismatchInParser) {
 				strtoffs = lastKnownGood; /* go back to final match */
 				LN_DBGPRINTF(npb->ctx, "mismatch in repeat, "
@@ -3240,54 +3778,64 @@ PARSER_Parse(Repeat)
 			}
 		}
 
-		if(json_arr == NULL) {
-			json_arr = json_object_new_array();
-		}
-
-		/* check for name=".", which means we need to place the
-		 * value only into to array. As we do not have direct
-		 * access to the key, we loop over our result as a work-
-		 * around.
-		 */
-		struct json_object *toAdd = parsed_value;
-		struct json_object_iterator it = json_object_iter_begin(parsed_value);
-		struct json_object_iterator itEnd = json_object_iter_end(parsed_value);
-		while (!json_object_iter_equal(&it, &itEnd)) {
-			const char *key = json_object_iter_peek_name(&it);
-			struct json_object *const val = json_object_iter_peek_value(&it);
-			if(key[0] == '.' && key[1] == '\0') {
-				json_object_get(val); /* inc refcount! */
-				toAdd = val;
+		struct json_object *dotval;
+		if(value == NULL) {
+			; /* just matching */
+		} else if(json_arr == NULL
+			  && (json_arr = json_object_new_array()) == NULL) {
+			FAIL(LN_NOMEM);
+		} else if(data->hasDotName
+		   && json_object_object_get_ex(parsed_value, ".", &dotval)) {
+			/* name=".", which means we need to place the value
+			 * only into to array.
+			 */
+			json_object_get(dotval); /* inc refcount! */
+			json_object_array_add(json_arr, dotval);
+			json_object_object_del(parsed_value, ".");
+			if(json_object_object_length(parsed_value) != 0) {
+				json_object_put(parsed_value);
+				parsed_value = NULL;
 			}
-			json_object_iter_next(&it);
+		} else {
+			json_object_array_add(json_arr, parsed_value);
+			parsed_value = NULL;
 		}
-
-		json_object_array_add(json_arr, toAdd);
-		if(toAdd != parsed_value)
-			json_object_put(parsed_value);
 		LN_DBGPRINTF(npb->ctx, "arr: %s", json_object_to_json_string(json_arr));
 
 		/* now check if we shall continue */
-		npb->parsedTo = 0;
 		lastKnownGood = strtoffs; /* record pos in case of fail in while */
-		r = ln_normalizeRec(npb, data->while_cond, strtoffs, 1, NULL, &endNode);
+		if(data->whileLit != NULL && repeatInlineWhile(npb)) {
+			if(npb->strLen - strtoffs >= data->lenWhileLit
+			   && !memcmp(npb->str + strtoffs, data->whileLit, data->lenWhileLit)) {
+				strtoffs += data->lenWhileLit;
+				npb->parsedTo = strtoffs;
+				r = 0;
+			} else {
+				r = LN_WRONGPARSER;
+			}
+		} else {
+			npb->parsedTo = 0;
+			r = ln_normalizeRec(npb, data->while_cond, strtoffs, 1, NULL, &endNode);
+			if(r == 0)
+				strtoffs = npb->parsedTo;
+		}
 		LN_DBGPRINTF(npb->ctx, "repeat while returns %d, parsed %zu",
-			r, npb->parsedTo);
-		if(r == 0)
-			strtoffs = npb->parsedTo;
+			r, strtoffs);
 	} while(r == 0);
 
 success:
 	/* success, persist */
 	*parsed = strtoffs - *offs;
-	if(value == NULL) {
-		json_object_put(json_arr);
-	} else {
+	if(value != NULL) {
 		*value = json_arr;
 	}
 	npb->parsedTo = parsedTo_save;
 	r = 0; /* success */
 done:
+	if(value == NULL)
+		--npb->noValues;
+	if(parsed_value != NULL)
+		json_object_put(parsed_value);
 	if(r != 0 && json_arr != NULL) {
 		json_object_put(json_arr);
 	}
@@ -3316,7 +3864,13 @@ PARSER_Construct(Repeat)
 			json_object_get(val); /* prevent free in pdagAddParser */
 			CHKR(ln_pdagAddParser(ctx, &endnode, val));
 			endnode->flags.isTerminal = 1;
+			data->hasDotName = repeatHasDotName(data->parser);
 		} else if(!strcmp(key, "while")) {
+			const char *const lit = repeatGetWhileLiteral(val);
+			if(lit != NULL) {
+				CHKN(data->whileLit = strdup(lit));
+				data->lenWhileLit = strlen(lit);
+			}
 			endnode = data->while_cond = ln_newPDAG(ctx);
 			json_object_get(val); /* prevent free in pdagAddParser */
 			CHKR(ln_pdagAddParser(ctx, &endnode, val));
@@ -3347,6 +3901,7 @@ PARSER_Destruct(Repeat)
 		ln_pdagDelete(data->parser);
 	if(data->while_cond != NULL)
 		ln_pdagDelete(data->while_cond);
+	free(data->whileLit);
 	free(pdata);
 }
 
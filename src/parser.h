@@ -70,8 +70,8 @@ PARSERDEF_NO_DATA(Time24hr);
 PARSERDEF_NO_DATA(Duration);
 PARSERDEF_NO_DATA(IPv4);
 PARSERDEF_NO_DATA(IPv6);
-PARSERDEF_NO_DATA(JSON);
-PARSERDEF_NO_DATA(CEESyslog);
+PARSERDEF(JSON);
+PARSERDEF(CEESyslog);
 PARSERDEF_NO_DATA(v2IPTables);
 PARSERDEF_NO_DATA(CiscoInterfaceSpec);
 PARSERDEF_NO_DATA(MAC48);
@@ -88,7 +88,11 @@ int ln_combineData_Literal(void *const org, void *const add);
 struct data_Repeat {
 	ln_pdag *parser;
 	ln_pdag *while_cond;
+	char *whileLit;		/**< text if while_cond is a plain literal, else NULL */
+	size_t lenWhileLit;
 	int permitMismatchInParser;
+	int hasDotName;		/**< parser part may emit a "." value */
 };
 
+
 #endif /* #ifndef LIBLOGNORM_PARSER_H_INCLUDED */
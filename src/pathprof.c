@@ -0,0 +1,199 @@
+/**
+ * @file pathprof.c
+ * @brief Implementation of the execution path profile.
+ *
+ * Paths form a tree: each node is identified by its parent path and
+ * the parser appended to it. The nodes are kept in an insert-only
+ * table (see lftab.h), keyed by these two pointers, so lookups do not
+ * lock.
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <libestr.h>
+
+#include "liblognorm.h"
+#include "lognorm.h"
+#include "internal.h"
+#include "pdag.h"
+#include "pathprof.h"
+#include "lftab.h"
+
+#define PP_NSLOTS (1 << 16)	/* must be power of 2 */
+#define PP_MAX_DEPTH 1024	/* deeper paths are cut when written */
+
+struct ln_pathprof_s {
+	struct ln_pp_node root;
+	struct ln_lftab tab;	/**< of struct ln_pp_node */
+};
+
+static inline int
+ppMatch(const void *const slot, const void *const key)
+{
+	const struct ln_pp_node *const node = (const struct ln_pp_node*) slot;
+	const struct ln_pp_node *const path = (const struct ln_pp_node*) key;
+
+	return node->prs == path->prs && node->parent == path->parent;
+}
+
+static int
+ppFill(void *const slot, const void *const key)
+{
+	struct ln_pp_node *const node = (struct ln_pp_node*) slot;
+	const struct ln_pp_node *const path = (const struct ln_pp_node*) key;
+
+	node->parent = path->parent;
+	node->prs = path->prs;
+	return 0;
+}
+
+ln_pathprof*
+ln_newPathProf(void)
+{
+	ln_pathprof *pp;
+
+	if((pp = calloc(1, sizeof(struct ln_pathprof_s))) == NULL)
+		goto done;
+	if(ln_lftabInit(&pp->tab, PP_NSLOTS, sizeof(struct ln_pp_node)) != 0) {
+		free(pp);
+		pp = NULL;
+	}
+done:	return pp;
+}
+
+
+void
+ln_deletePathProf(ln_pathprof *const pp)
+{
+	if(pp == NULL)
+		goto done;
+	ln_lftabExit(&pp->tab);
+	free(pp);
+done:	return;
+}
+
+
+struct ln_pp_node*
+ln_ppRoot(ln_pathprof *const pp)
+{
+	return &pp->root;
+}
+
+
+struct ln_pp_node*
+ln_ppCall(ln_pathprof *const pp, struct ln_pp_node *const pos, const ln_parser_t *const prs)
+{
+	struct ln_pp_node *node;
+	struct ln_pp_node key;
+
+	key.parent = pos;
+	key.prs = prs;
+	node = ln_lftabGet(&pp->tab, ln_lftabHashPtrs(pos, prs), ppMatch, ppFill, &key);
+	if(node == NULL) /* table full */
+		node = pos;
+	__atomic_fetch_add(&node->calls, 1, __ATOMIC_RELAXED);
+	return node;
+}
+
+
+/* append the frame name of a path node. Semicolons separate frames
+ * in the folded format, so they are replaced, as are control characters.
+ */
+static void
+addFrame(ln_ctx ctx, es_str_t **const str, const struct ln_pp_node *const node)
+{
+	const size_t start = es_strlen(*str);
+	char buf[64];
+
+	ln_addParserDisplayName(ctx, node->prs, str);
+	unsigned char *const c = es_getBufAddr(*str);
+	for(size_t i = start ; i < es_strlen(*str) ; ++i) {
+		if(c[i] == ';')
+			c[i] = ',';
+		else if(c[i] < 0x20)
+			c[i] = '?';
+	}
+	const uint64_t backtracked = __atomic_load_n(&node->backtracked, __ATOMIC_RELAXED);
+	if(backtracked > 0) {
+		const int len = snprintf(buf, sizeof(buf), " [backtracked %" PRIu64 "]", backtracked);
+		es_addBuf(str, buf, len);
+	}
+}
+
+static int
+cmpLines(const void *const a, const void *const b)
+{
+	return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+int
+ln_ppWriteFolded(ln_pathprof *const pp, ln_ctx ctx, FILE *const fp)
+{
+	int r = 0;
+	const struct ln_pp_node *path[PP_MAX_DEPTH];
+	char **lines = NULL;
+	int nlines = 0;
+	es_str_t *str = NULL;
+	char buf[32];
+
+	if(pp == NULL)
+		goto done;
+	const int nEntries = ln_lftabNumEntries(&pp->tab);
+	CHKN(lines = calloc(nEntries + 1, sizeof(char*)));
+	for(size_t i = 0 ; i < PP_NSLOTS && nlines < nEntries ; ++i) {
+		const struct ln_pp_node *const leaf = ln_lftabEntry(&pp->tab, i);
+		const struct ln_pp_node *node = leaf;
+		if(leaf == NULL)
+			continue;
+		int depth = 0;
+		for( ; node != &pp->root && depth < PP_MAX_DEPTH ; node = node->parent)
+			path[depth++] = node;
+		CHKN(str = es_newStr(256));
+		while(depth > 0) {
+			addFrame(ctx, &str, path[--depth]);
+			if(depth > 0)
+				es_addChar(&str, ';');
+		}
+		const int len = snprintf(buf, sizeof(buf), " %" PRIu64,
+			__atomic_load_n(&leaf->calls, __ATOMIC_RELAXED));
+		es_addBuf(&str, buf, len);
+		CHKN(lines[nlines] = es_str2cstr(str, NULL));
+		++nlines;
+		es_deleteStr(str);
+		str = NULL;
+	}
+	qsort(lines, nlines, sizeof(char*), cmpLines);
+	for(int i = 0 ; i < nlines ; ++i)
+		fprintf(fp, "%s\n", lines[i]);
+done:
+	if(str != NULL)
+		es_deleteStr(str);
+	if(lines != NULL) {
+		for(int i = 0 ; i < nlines ; ++i)
+			free(lines[i]);
+		free(lines);
+	}
+	return r;
+}
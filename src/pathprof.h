@@ -0,0 +1,114 @@
+/**
+ * @file pathprof.h
+ * @brief Aggregated execution paths of the normalizer
+ * @class ln_pathprof pathprof.h
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#ifndef LIBLOGNORM_PATHPROF_H_INCLUDED
+#define	LIBLOGNORM_PATHPROF_H_INCLUDED
+#include <stdio.h>
+#include <stdint.h>
+
+typedef struct ln_pathprof_s ln_pathprof;
+struct ln_parser_s;
+
+/**
+ * One distinct execution path, i.e. the sequence of parsers that were
+ * called (and succeeded) on the way down the pdag, ending with the
+ * parser this node stands for.
+ */
+struct ln_pp_node {
+	struct ln_pp_node *parent;	/**< path without the last parser */
+	const struct ln_parser_s *prs;	/**< last parser, NULL for the root */
+	uint64_t calls;			/**< times prs was called via this path */
+	uint64_t backtracked;		/**< times prs matched, but its subtree did not */
+};
+
+/**
+ * Allocates and initializes a new, empty path profile.
+ * @memberof ln_pathprof
+ *
+ * @return pointer to new object or NULL on error
+ */
+ln_pathprof* ln_newPathProf(void);
+
+
+/**
+ * Free path profile.
+ * @memberof ln_pathprof
+ *
+ * @param[in] pp object to free, may be NULL
+ */
+void ln_deletePathProf(ln_pathprof *pp);
+
+
+/**
+ * Obtain the root node, i.e. the empty path, at which each message
+ * starts.
+ * @memberof ln_pathprof
+ */
+struct ln_pp_node* ln_ppRoot(ln_pathprof *pp);
+
+
+/**
+ * Record a parser call. This may be called concurrently by multiple
+ * threads.
+ * @memberof ln_pathprof
+ *
+ * @param[in] pp path profile
+ * @param[in] pos current path
+ * @param[in] prs parser being called
+ * @return the path extended by prs. If the maximum number of paths is
+ *         reached, pos is returned, so the call is attributed to the
+ *         current path.
+ */
+struct ln_pp_node* ln_ppCall(ln_pathprof *pp, struct ln_pp_node *pos,
+	const struct ln_parser_s *prs);
+
+
+/**
+ * Record that the last parser of a path matched, but the subtree
+ * following it did not.
+ * @memberof ln_pathprof
+ */
+static inline void
+ln_ppBacktracked(struct ln_pp_node *const pos)
+{
+	__atomic_fetch_add(&pos->backtracked, 1, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * Write the profile in folded-stack format, as used by flame graph
+ * tools: one line per path, consisting of the parsers (frames)
+ * separated by semicolons, followed by the number of calls of the
+ * last parser. Lines are sorted.
+ * @memberof ln_pathprof
+ *
+ * @param[in] pp path profile, may be NULL (empty profile)
+ * @param[in] ctx context the parsers belong to
+ * @param[in] fp file to write to
+ * @return 0 on success, something else otherwise
+ */
+int ln_ppWriteFolded(ln_pathprof *pp, struct ln_ctx_s *ctx, FILE *fp);
+
+#endif /* #ifndef LIBLOGNORM_PATHPROF_H_INCLUDED */
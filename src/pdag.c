@@ -14,6 +14,8 @@
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
+#include <inttypes.h>
+#include <time.h>
 #include <libestr.h>
 
 #include "liblognorm.h"
@@ -23,6 +25,7 @@
 #include "samp.h"
 #include "pdag.h"
 #include "annot.h"
+#include "record.h"
 #include "internal.h"
 #include "parser.h"
 #include "helpers.h"
@@ -30,19 +33,6 @@
 void ln_displayPDAGComponentAlternative(struct ln_pdag *dag, int level);
 void ln_displayPDAGComponent(struct ln_pdag *dag, int level);
 
-#ifdef	ADVANCED_STATS
-uint64_t advstats_parsers_called = 0;
-uint64_t advstats_parsers_success = 0;
-int advstats_max_pathlen = 0;
-int advstats_pathlens[ADVSTATS_MAX_ENTITIES];
-int advstats_max_backtracked = 0;
-int advstats_backtracks[ADVSTATS_MAX_ENTITIES];
-int advstats_max_parser_calls = 0;
-int advstats_parser_calls[ADVSTATS_MAX_ENTITIES];
-int advstats_max_lit_parser_calls = 0;
-int advstats_lit_parser_calls[ADVSTATS_MAX_ENTITIES];
-#endif
-
 /* parser lookup table
  * This is a memory- and cache-optimized way of calling parsers.
  * VERY IMPORTANT: the initialization must be done EXACTLY in the
@@ -55,53 +45,57 @@ int advstats_lit_parser_calls[ADVSTATS_MAX_ENTITIES];
  * parser-specific priorities only count when the user has assigned
  * no priorities (which is expected to be common) or user-assigned
  * priorities are equal for some parsers.
+ *
+ * The last parameter holds PRS_F_* flags. PRS_F_MSGKEYS must be set for
+ * parsers that can return objects whose member names are taken from the
+ * message. Only for those a lone ".." member needs to be checked when the
+ * value is stored. PRS_F_SPAN marks parsers whose value is exactly the
+ * parsed part of the message, so that it can be referenced instead of
+ * being copied (see ln_normalizeRecord). PRS_F_SPAN_FMT is the same for
+ * parsers that support a "format" parameter, where it only applies to
+ * the default "string" format.
  */
-#ifdef ADVANCED_STATS
-#define PARSER_ENTRY_NO_DATA(identifier, parser, prio) \
-{ identifier, prio, NULL, ln_v2_parse##parser, NULL, 0, 0 }
-#define PARSER_ENTRY(identifier, parser, prio) \
-{ identifier, prio, ln_construct##parser, ln_v2_parse##parser, ln_destruct##parser, 0, 0 }
-#else
-#define PARSER_ENTRY_NO_DATA(identifier, parser, prio) \
-{ identifier, prio, NULL, ln_v2_parse##parser, NULL }
-#define PARSER_ENTRY(identifier, parser, prio) \
-{ identifier, prio, ln_construct##parser, ln_v2_parse##parser, ln_destruct##parser }
-#endif
+#define PARSER_ENTRY_NO_DATA(identifier, parser, prio, flags) \
+{ identifier, prio, NULL, ln_v2_parse##parser, NULL, flags }
+#define PARSER_ENTRY(identifier, parser, prio, flags) \
+{ identifier, prio, ln_construct##parser, ln_v2_parse##parser, ln_destruct##parser, flags }
 static struct ln_parser_info parser_lookup_table[] = {
-	PARSER_ENTRY("literal", Literal, 4),
-	PARSER_ENTRY("repeat", Repeat, 4),
-	PARSER_ENTRY("date-rfc3164", RFC3164Date, 8),
-	PARSER_ENTRY("date-rfc5424", RFC5424Date, 8),
-	PARSER_ENTRY("number", Number, 16),
-	PARSER_ENTRY("float", Float, 16),
-	PARSER_ENTRY("hexnumber", HexNumber, 16),
-	PARSER_ENTRY_NO_DATA("kernel-timestamp", KernelTimestamp, 16),
-	PARSER_ENTRY_NO_DATA("whitespace", Whitespace, 4),
-	PARSER_ENTRY_NO_DATA("ipv4", IPv4, 4),
-	PARSER_ENTRY_NO_DATA("ipv6", IPv6, 4),
-	PARSER_ENTRY_NO_DATA("word", Word, 32),
-	PARSER_ENTRY_NO_DATA("alpha", Alpha, 32),
-	PARSER_ENTRY_NO_DATA("rest", Rest, 255),
-	PARSER_ENTRY_NO_DATA("op-quoted-string", OpQuotedString, 64),
-	PARSER_ENTRY_NO_DATA("quoted-string", QuotedString, 64),
-	PARSER_ENTRY_NO_DATA("date-iso", ISODate, 8),
-	PARSER_ENTRY_NO_DATA("time-24hr", Time24hr, 8),
-	PARSER_ENTRY_NO_DATA("time-12hr", Time12hr, 8),
-	PARSER_ENTRY_NO_DATA("duration", Duration, 16),
-	PARSER_ENTRY_NO_DATA("cisco-interface-spec", CiscoInterfaceSpec, 4),
-	PARSER_ENTRY_NO_DATA("json", JSON, 4),
-	PARSER_ENTRY_NO_DATA("cee-syslog", CEESyslog, 4),
-	PARSER_ENTRY_NO_DATA("mac48", MAC48, 16),
-	PARSER_ENTRY_NO_DATA("cef", CEF, 4),
-	PARSER_ENTRY_NO_DATA("v2-iptables", v2IPTables, 4),
-	PARSER_ENTRY("name-value-list", NameValue, 8),
-	PARSER_ENTRY("checkpoint-lea", CheckpointLEA, 4),
-	PARSER_ENTRY("string-to", StringTo, 32),
-	PARSER_ENTRY("char-to", CharTo, 32),
-	PARSER_ENTRY("char-sep", CharSeparated, 32),
-	PARSER_ENTRY("string", String, 32)
+	PARSER_ENTRY("literal", Literal, 4, PRS_F_SPAN),
+	PARSER_ENTRY("repeat", Repeat, 4, 0),
+	PARSER_ENTRY("date-rfc3164", RFC3164Date, 8, PRS_F_SPAN_FMT),
+	PARSER_ENTRY("date-rfc5424", RFC5424Date, 8, PRS_F_SPAN_FMT),
+	PARSER_ENTRY("number", Number, 16, PRS_F_SPAN_FMT),
+	PARSER_ENTRY("float", Float, 16, PRS_F_SPAN_FMT),
+	PARSER_ENTRY("hexnumber", HexNumber, 16, PRS_F_SPAN_FMT),
+	PARSER_ENTRY_NO_DATA("kernel-timestamp", KernelTimestamp, 16, PRS_F_SPAN),
+	PARSER_ENTRY_NO_DATA("whitespace", Whitespace, 4, PRS_F_SPAN),
+	PARSER_ENTRY_NO_DATA("ipv4", IPv4, 4, PRS_F_SPAN),
+	PARSER_ENTRY_NO_DATA("ipv6", IPv6, 4, PRS_F_SPAN),
+	PARSER_ENTRY_NO_DATA("word", Word, 32, PRS_F_SPAN),
+	PARSER_ENTRY_NO_DATA("alpha", Alpha, 32, PRS_F_SPAN),
+	PARSER_ENTRY_NO_DATA("rest", Rest, 255, PRS_F_SPAN),
+	PARSER_ENTRY_NO_DATA("op-quoted-string", OpQuotedString, 64, 0),
+	PARSER_ENTRY_NO_DATA("quoted-string", QuotedString, 64, PRS_F_SPAN),
+	PARSER_ENTRY_NO_DATA("date-iso", ISODate, 8, PRS_F_SPAN),
+	PARSER_ENTRY_NO_DATA("time-24hr", Time24hr, 8, PRS_F_SPAN),
+	PARSER_ENTRY_NO_DATA("time-12hr", Time12hr, 8, PRS_F_SPAN),
+	PARSER_ENTRY_NO_DATA("duration", Duration, 16, PRS_F_SPAN),
+	PARSER_ENTRY_NO_DATA("cisco-interface-spec", CiscoInterfaceSpec, 4, 0),
+	PARSER_ENTRY("json", JSON, 4, PRS_F_MSGKEYS),
+	PARSER_ENTRY("cee-syslog", CEESyslog, 4, PRS_F_MSGKEYS),
+	PARSER_ENTRY_NO_DATA("mac48", MAC48, 16, PRS_F_SPAN),
+	PARSER_ENTRY_NO_DATA("cef", CEF, 4, 0),
+	PARSER_ENTRY_NO_DATA("v2-iptables", v2IPTables, 4, PRS_F_MSGKEYS),
+	PARSER_ENTRY("name-value-list", NameValue, 8, PRS_F_MSGKEYS),
+	PARSER_ENTRY("checkpoint-lea", CheckpointLEA, 4, PRS_F_MSGKEYS),
+	PARSER_ENTRY("string-to", StringTo, 32, PRS_F_SPAN),
+	PARSER_ENTRY("char-to", CharTo, 32, PRS_F_SPAN),
+	PARSER_ENTRY("char-sep", CharSeparated, 32, PRS_F_SPAN),
+	PARSER_ENTRY("string", String, 32, 0)
 };
 #define NPARSERS (sizeof(parser_lookup_table)/sizeof(struct ln_parser_info))
+/* telemetry keeps per-parser counters in fixed-size arrays */
+typedef char assert_telemetry_parsers[(NPARSERS <= LN_TM_MAX_PARSERS) ? 1 : -1];
 #define DFLT_USR_PARSER_PRIO 30000 /**< default priority if user has not specified it */
 static inline const char *
 parserName(const prsid_t id)
@@ -114,6 +108,60 @@ parserName(const prsid_t id)
 	return name;
 }
 
+const char *
+ln_parserIDName(const prsid_t id)
+{
+	return parserName(id);
+}
+
+/* for tools which call parsers directly, e.g. benchmarks */
+const struct ln_parser_info *
+ln_parserInfo(const prsid_t id)
+{
+	return (id < NPARSERS) ? parser_lookup_table + id : NULL;
+}
+
+/* parsers are named like the rule parts they stem from, with unnamed
+ * literals quoted (as in the exec path).
+ */
+void
+ln_addParserDisplayName(ln_ctx ctx, const ln_parser_t *const prs, es_str_t **const str)
+{
+	if(prs->prsid == PRS_LITERAL && prs->name == NULL) {
+		const char *const lit = ln_DataForDisplayLiteral(ctx, prs->parser_data);
+		es_addChar(str, '\'');
+		es_addBuf(str, lit, strlen(lit));
+		es_addChar(str, '\'');
+	} else {
+		es_addChar(str, '%');
+		if(prs->name == NULL)
+			es_addChar(str, '-');
+		else
+			es_addBuf(str, prs->name, strlen(prs->name));
+		es_addChar(str, ':');
+		const char *const type = (prs->prsid == PRS_CUSTOM_TYPE)
+			? ctx->type_pdags[prs->custTypeIdx].name : parserName(prs->prsid);
+		es_addBuf(str, type, strlen(type));
+		es_addChar(str, '%');
+	}
+}
+
+/* the first terminal reachable from dag. Used to name a rule that
+ * follows a node, e.g. for reports about it.
+ */
+const struct ln_pdag *
+ln_pdagFirstTerminal(const struct ln_pdag *const dag)
+{
+	if(dag->flags.isTerminal)
+		return dag;
+	for(int i = 0 ; i < dag->nparsers ; ++i) {
+		const struct ln_pdag *const term = ln_pdagFirstTerminal(dag->parsers[i].node);
+		if(term != NULL)
+			return term;
+	}
+	return NULL;
+}
+
 prsid_t
 ln_parserName2ID(const char *const __restrict__ name)
 {
@@ -190,6 +238,21 @@ ln_pdagClearVisited(ln_ctx ctx)
 	ln_pdagComponentClearVisited(ctx->pdag);
 }
 
+/* determine how the value of a parser with the given field name is
+ * stored in the result (without field projection).
+ */
+static uint8_t
+parserMergeMode(const char *const name, const prsid_t prsid)
+{
+	if(name == NULL)
+		return PRS_MERGE_DISCARD;
+	if(name[0] == '.' && name[1] == '\0')
+		return PRS_MERGE_DOT;
+	if(prsid == PRS_CUSTOM_TYPE || (parser_lookup_table[prsid].flags & PRS_F_MSGKEYS))
+		return PRS_MERGE_DOTDOT;
+	return PRS_MERGE_ADD;
+}
+
 /**
  * Process a parser definition. Note that a single definition can potentially
  * contain many parser instances.
@@ -208,6 +271,7 @@ ln_newParser(ln_ctx ctx,
 	const char *textconf = json_object_to_json_string(prscnf);
 	int assignedPrio = DFLT_USR_PARSER_PRIO;
 	int parserPrio;
+	int intern = 0;
 
 	json_object_object_get_ex(prscnf, "type", &json);
 	if(json == NULL) {
@@ -244,6 +308,16 @@ ln_newParser(ln_ctx ctx,
 	if(json != NULL) {
 		assignedPrio = json_object_get_int(json);
 	}
+
+	json_object_object_get_ex(prscnf, "intern", &json);
+	if(json != NULL) {
+		intern = json_object_get_boolean(json);
+		if(intern && ctx->intern == NULL
+		   && (ctx->intern = ln_newIntern()) == NULL) {
+			free((void*)name);
+			goto done;
+		}
+	}
 	LN_DBGPRINTF(ctx, "assigned priority is %d", assignedPrio);
 
 	/* we need to remove already processed items from the config, so
@@ -251,6 +325,7 @@ ln_newParser(ln_ctx ctx,
 	 */
 	json_object_object_del(prscnf, "type");
 	json_object_object_del(prscnf, "priority");
+	json_object_object_del(prscnf, "intern");
 	if(name != NULL)
 		json_object_object_del(prscnf, "name");
 
@@ -265,6 +340,18 @@ ln_newParser(ln_ctx ctx,
 	node->prio = ((assignedPrio << 8) & 0xffffff00) | (parserPrio & 0xff);
 	node->name = name;
 	node->prsid = prsid;
+	node->mergeMode = parserMergeMode(name, prsid);
+	node->intern = intern;
+	if(prsid != PRS_CUSTOM_TYPE) {
+		const int flags = parser_lookup_table[prsid].flags;
+		if(flags & PRS_F_SPAN_FMT) {
+			json_object_object_get_ex(prscnf, "format", &json);
+			node->spanValue = (json == NULL)
+				|| !strcmp(json_object_get_string(json), "string");
+		} else {
+			node->spanValue = (flags & PRS_F_SPAN) ? 1 : 0;
+		}
+	}
 	node->conf = strdup(textconf);
 	if(prsid == PRS_CUSTOM_TYPE) {
 		node->custTypeIdx = custType - ctx->type_pdags;
@@ -287,6 +374,7 @@ ln_newPDAG(ln_ctx ctx)
 		goto done;
 	
 	dag->refcnt = 1;
+	dag->nfields = -1;
 	dag->ctx = ctx;
 	ctx->nNodes++;
 done:	return dag;
@@ -322,6 +410,12 @@ ln_pdagDelete(struct ln_pdag *const __restrict__ pdag)
 
 	if(pdag->tags != NULL)
 		json_object_put(pdag->tags);
+	ln_deleteAnnotFields(pdag->annots, pdag->nannots);
+	if(pdag->rule_mockup != NULL)
+		json_object_put(pdag->rule_mockup);
+	if(pdag->rule_location != NULL)
+		json_object_put(pdag->rule_location);
+	free(pdag->latency);
 
 	for(int i = 0 ; i < pdag->nparsers ; ++i) {
 		pdagDeletePrs(pdag->ctx, pdag->parsers+i);
@@ -508,6 +602,164 @@ ln_pdagComponentSetIDs(ln_ctx ctx, struct ln_pdag *const dag, const char *prefix
 done:	return;
 }
 
+/* precompute everything terminal nodes add to a successfully
+ * normalized event: the annotations of their tags as well as the
+ * rule mockup and location metadata. This is redone on each
+ * optimization run, as annotations may be defined after the rules
+ * that use their tags. The mockup only covers the path inside the
+ * main pdag; parts contributed by nested parsers (user-defined types,
+ * repeat) are still collected during normalization. Nodes reached via
+ * several paths (branches of "alternative" share their next node) have
+ * no single mockup: terminals below them are marked multiPath, their
+ * mockup is collected during normalization. Such nodes are only walked
+ * once; the caller must clear the visited flags.
+ */
+static int
+ln_pdagComponentCompileTerminals(ln_ctx ctx, struct ln_pdag *const dag, const char *mockup,
+	int multiPath)
+{
+	int r = 0;
+	char *childMockup = NULL;
+	struct json_object *value;
+
+	if(dag->refcnt > 1) {
+		if(dag->flags.visited)
+			goto done;
+		dag->flags.visited = 1;
+		multiPath = 1;
+	}
+	if(dag->tags != NULL) {
+		ln_deleteAnnotFields(dag->annots, dag->nannots);
+		dag->annots = NULL;
+		dag->nannots = 0;
+		CHKR(ln_compileAnnots(ctx, dag->tags, &dag->annots, &dag->nannots));
+	}
+	if(dag->flags.isTerminal) {
+		if(dag->rule_mockup != NULL)
+			json_object_put(dag->rule_mockup);
+		dag->rule_mockup = NULL;
+		dag->flags.multiPath = multiPath;
+		if(!multiPath)
+			CHKN(dag->rule_mockup = json_object_new_string(mockup));
+		if(dag->rule_location == NULL && dag->rb_file != NULL) {
+			CHKN(dag->rule_location = json_object_new_object());
+			CHKN(value = json_object_new_string(dag->rb_file));
+			json_object_object_add(dag->rule_location, "file", value);
+			CHKN(value = json_object_new_int((int)dag->rb_lineno));
+			json_object_object_add(dag->rule_location, "line", value);
+		}
+	}
+	for(int i = 0 ; i < dag->nparsers ; ++i) {
+		ln_parser_t *prs = dag->parsers+i;
+		if(multiPath) {
+			r = ln_pdagComponentCompileTerminals(ctx, prs->node, "", 1);
+			if(r != 0)
+				goto done;
+			continue;
+		}
+		if(prs->prsid == PRS_LITERAL) {
+			if(asprintf(&childMockup, "%s%s", mockup,
+				ln_DataForDisplayLiteral(dag->ctx, prs->parser_data)) == -1)
+				FAIL(LN_NOMEM);
+		} else {
+			if(asprintf(&childMockup, "%s%%%s:%s%%", mockup,
+				prs->name ? prs->name : "-",
+				parserName(prs->prsid)) == -1)
+				FAIL(LN_NOMEM);
+		}
+		r = ln_pdagComponentCompileTerminals(ctx, prs->node, childMockup, 0);
+		free(childMockup);
+		if(r != 0)
+			goto done;
+	}
+done:
+	return r;
+}
+
+/* collect the distinct terminals of the main pdag, so that runtime
+ * snapshots (rule latency) can iterate them without walking the pdag,
+ * which would need the visited flags. The caller must clear them.
+ */
+static int
+ln_pdagComponentCollectTerminals(ln_ctx ctx, struct ln_pdag *const dag)
+{
+	int r = 0;
+
+	if(dag->flags.visited)
+		goto done;
+	dag->flags.visited = 1;
+	if(dag->flags.isTerminal) {
+		if(ctx->nTerminals == ctx->maxTerminals) {
+			const int newMax = (ctx->maxTerminals == 0) ? 16 : 2 * ctx->maxTerminals;
+			struct ln_pdag **const newTerms =
+				realloc(ctx->terminals, newMax * sizeof(struct ln_pdag*));
+			CHKN(newTerms);
+			ctx->terminals = newTerms;
+			ctx->maxTerminals = newMax;
+		}
+		ctx->terminals[ctx->nTerminals++] = dag;
+	}
+	for(int i = 0 ; i < dag->nparsers ; ++i) {
+		CHKR(ln_pdagComponentCollectTerminals(ctx, dag->parsers[i].node));
+	}
+done:	return r;
+}
+
+/* record for each node how many named fields the paths to it add to
+ * the result object, the maximum if it is reached via several paths
+ * (alternative). Values of nested parsers (user-defined types, repeat)
+ * count as one field, as does a "." merge. A node is only descended
+ * again if a path with more fields reaches it, so shared subtrees are
+ * not walked once per path. Counts must be reset before.
+ */
+static void
+ln_pdagComponentCountFields(struct ln_pdag *const dag, const int nfields)
+{
+	if(nfields <= dag->nfields)
+		return;
+	dag->nfields = nfields;
+	for(int i = 0 ; i < dag->nparsers ; ++i) {
+		ln_parser_t *const prs = dag->parsers+i;
+		ln_pdagComponentCountFields(prs->node,
+			nfields + (prs->mergeMode != PRS_MERGE_DISCARD));
+	}
+}
+
+/* reset field counts before ln_pdagComponentCountFields. Nodes already
+ * reset are not descended again.
+ */
+static void
+ln_pdagComponentResetFields(struct ln_pdag *const dag)
+{
+	if(dag->nfields < 0)
+		return;
+	dag->nfields = -1;
+	for(int i = 0 ; i < dag->nparsers ; ++i)
+		ln_pdagComponentResetFields(dag->parsers[i].node);
+}
+
+static void
+ln_pdagComponentApplyProjection(struct json_object *const projection, struct ln_pdag *const dag)
+{
+	for(int i = 0 ; i < dag->nparsers ; ++i) {
+		ln_parser_t *const prs = dag->parsers+i;
+		uint8_t mode = parserMergeMode(prs->name, prs->prsid);
+		if(projection != NULL && mode != PRS_MERGE_DISCARD && mode != PRS_MERGE_DOT
+		   && !json_object_object_get_ex(projection, prs->name, NULL))
+			mode = PRS_MERGE_DISCARD;
+		prs->mergeMode = mode;
+		ln_pdagComponentApplyProjection(projection, prs->node);
+	}
+}
+
+void
+ln_pdagApplyProjection(ln_ctx ctx)
+{
+	ln_pdagComponentApplyProjection(ctx->projection, ctx->pdag);
+	ln_pdagComponentResetFields(ctx->pdag);
+	ln_pdagComponentCountFields(ctx->pdag, 0);
+}
+
 /**
  * Optimize the pdag.
  * This includes all components.
@@ -521,15 +773,24 @@ ln_pdagOptimize(ln_ctx ctx)
 		LN_DBGPRINTF(ctx, "optimizing component %s\n", ctx->type_pdags[i].name);
 		ln_pdagComponentOptimize(ctx, ctx->type_pdags[i].pdag);
 		ln_pdagComponentSetIDs(ctx, ctx->type_pdags[i].pdag, "");
+		ln_pdagComponentResetFields(ctx->type_pdags[i].pdag);
+		ln_pdagComponentCountFields(ctx->type_pdags[i].pdag, 0);
 	}
 
 	LN_DBGPRINTF(ctx, "optimizing main pdag component");
 	ln_pdagComponentOptimize(ctx, ctx->pdag);
 	LN_DBGPRINTF(ctx, "finished optimizing main pdag component");
 	ln_pdagComponentSetIDs(ctx, ctx->pdag, "");
+	ln_pdagApplyProjection(ctx);
+	ln_pdagComponentClearVisited(ctx->pdag);
+	CHKR(ln_pdagComponentCompileTerminals(ctx, ctx->pdag, "", 0));
+	ln_pdagComponentClearVisited(ctx->pdag);
+	ctx->nTerminals = 0;
+	CHKR(ln_pdagComponentCollectTerminals(ctx, ctx->pdag));
 LN_DBGPRINTF(ctx, "---AFTER OPTIMIZATION------------------");
 ln_displayPDAG(ctx);
 LN_DBGPRINTF(ctx, "=======================================");
+done:
 	return r;
 }
 
@@ -543,6 +804,8 @@ struct pdag_stats {
 	int max_nparsers;
 	int nparsers_cnt[LN_INTERN_PDAG_STATS_NPARSERS];
 	int nparsers_100plus;
+	int max_nfields;
+	int sum_nfields;
 	int *prs_cnt;
 };
 
@@ -556,8 +819,12 @@ ln_pdagStatsRec(ln_ctx ctx, struct ln_pdag *const dag, struct pdag_stats *const
 		return 0;
 	dag->flags.visited = 1;
 	stats->nodes++;
-	if(dag->flags.isTerminal)
+	if(dag->flags.isTerminal) {
 		stats->term_nodes++;
+		stats->sum_nfields += dag->nfields;
+		if(dag->nfields > stats->max_nfields)
+			stats->max_nfields = dag->nfields;
+	}
 	if(dag->nparsers > stats->max_nparsers)
 		stats->max_nparsers = dag->nparsers;
 	if(dag->nparsers >= LN_INTERN_PDAG_STATS_NPARSERS)
@@ -619,6 +886,9 @@ ln_pdagStats(ln_ctx ctx, struct ln_pdag *const dag, FILE *const fp, const int ex
 	fprintf(fp, "terminal nodes....: %4d\n", stats->term_nodes);
 	fprintf(fp, "parsers entries...: %4d\n", stats->parsers);
 	fprintf(fp, "longest path......: %4d\n", longest_path);
+	fprintf(fp, "max result fields.: %4d\n", stats->max_nfields);
+	fprintf(fp, "avg result fields.: %6.1f\n", (stats->term_nodes == 0) ? 0.0
+		: (double) stats->sum_nfields / stats->term_nodes);
 
 	fprintf(fp, "Parser Type Counts:\n");
 	for(prsid_t i = 0 ; i < NPARSERS ; ++i) {
@@ -646,6 +916,170 @@ ln_pdagStats(ln_ctx ctx, struct ln_pdag *const dag, FILE *const fp, const int ex
 }
 
 
+struct rule_lat {
+	struct ln_pdag *node;
+	struct ln_tm_latsum sum;
+};
+
+struct rule_lats {
+	struct rule_lat *lats;
+	int n;
+	int max;
+};
+
+/* collect all terminals of the main pdag that have latency samples */
+static int
+collectRuleLatency(ln_ctx ctx, struct rule_lats *const rl)
+{
+	int r = 0;
+
+	for(int i = 0 ; i < ctx->nTerminals ; ++i) {
+		struct ln_pdag *const dag = ctx->terminals[i];
+		if(dag->latency == NULL)
+			continue;
+		if(rl->n == rl->max) {
+			const int newMax = (rl->max == 0) ? 16 : 2 * rl->max;
+			struct rule_lat *const newLats = realloc(rl->lats, newMax * sizeof(struct rule_lat));
+			CHKN(newLats);
+			rl->lats = newLats;
+			rl->max = newMax;
+		}
+		rl->lats[rl->n].node = dag;
+		ln_tmLatSum(dag->latency, &rl->lats[rl->n].sum, 0);
+		if(rl->lats[rl->n].sum.samples > 0)
+			++rl->n;
+	}
+done:	return r;
+}
+
+/* slowest rules first */
+static int
+cmpRuleLatency(const void *const a, const void *const b)
+{
+	const struct rule_lat *const la = (const struct rule_lat*) a;
+	const struct rule_lat *const lb = (const struct rule_lat*) b;
+
+	if(la->sum.p99 != lb->sum.p99)
+		return (la->sum.p99 < lb->sum.p99) ? 1 : -1;
+	if(la->node->rule_id != lb->node->rule_id)
+		return (la->node->rule_id < lb->node->rule_id) ? -1 : 1;
+	return 0;
+}
+
+static void
+printLatency(FILE *const fp, const struct ln_tm_latsum *const sum, const char *const what)
+{
+	fprintf(fp, "%8" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "  %s\n",
+		sum->samples, sum->p50, sum->p99, sum->max, what);
+}
+
+/**
+ * Output sampled latency per rule, slowest (by p99) first.
+ */
+static void
+ln_latencyStats(ln_ctx ctx, FILE *const fp)
+{
+	struct rule_lats rl = { NULL, 0, 0 };
+	struct ln_tm_latsum sum;
+	char what[1024];
+
+	fprintf(fp, "\n"
+		    "Rule Latency\n"
+		    "------------\n");
+	fprintf(fp, "sampling..........: every %u message(s)\n",
+		__atomic_load_n(&ctx->latencySampling, __ATOMIC_RELAXED));
+	if(collectRuleLatency(ctx, &rl) != 0) {
+		fprintf(fp, "out of memory\n");
+		goto done;
+	}
+	qsort(rl.lats, rl.n, sizeof(struct rule_lat), cmpRuleLatency);
+	fprintf(fp, " samples     p50 ns     p99 ns     max ns  rule\n");
+	for(int i = 0 ; i < rl.n ; ++i) {
+		const struct ln_pdag *const node = rl.lats[i].node;
+		if(node->rb_file == NULL)
+			snprintf(what, sizeof(what), "%u", node->rule_id);
+		else
+			snprintf(what, sizeof(what), "%u (%s:%u)", node->rule_id,
+				node->rb_file, node->rb_lineno);
+		printLatency(fp, &rl.lats[i].sum, what);
+	}
+	ln_tmLatSum(*ln_tmUnparsedLat(ctx->telemetry), &sum, 0);
+	printLatency(fp, &sum, "unparsed");
+done:
+	free(rl.lats);
+}
+
+/* iterates the terminals collected at load time, as the pdag itself
+ * must not be modified (visited flags) while other threads normalize.
+ * Terminals are keyed by rule id; should an explicit id be used twice
+ * (reported at load time), only the first terminal is output, but the
+ * others are still reset.
+ */
+static int
+ruleLatencyToJSON(ln_ctx ctx, const int reset, struct json_object *const rules)
+{
+	int r = 0;
+	struct json_object *json = NULL;
+	struct json_object *value;
+	struct ln_tm_latsum sum;
+	char key[16];
+
+	for(int i = 0 ; i < ctx->nTerminals ; ++i) {
+		struct ln_pdag *const dag = ctx->terminals[i];
+		if(dag->latency == NULL)
+			continue;
+		ln_tmLatSum(dag->latency, &sum, reset);
+		snprintf(key, sizeof(key), "%u", dag->rule_id);
+		if(sum.samples > 0 && !json_object_object_get_ex(rules, key, NULL)) {
+			CHKN(json = ln_tmLatToJSON(&sum));
+			if(dag->rb_file != NULL) {
+				CHKN(value = json_object_new_string(dag->rb_file));
+				json_object_object_add(json, "file", value);
+				CHKN(value = json_object_new_int((int)dag->rb_lineno));
+				json_object_object_add(json, "line", value);
+			}
+			json_object_object_add(rules, key, json);
+			json = NULL;
+		}
+	}
+done:
+	if(json != NULL)
+		json_object_put(json);
+	return r;
+}
+
+/**
+ * Create json representation of the sampled latencies: the sampling
+ * interval, the latency of unparsed messages and, keyed by rule id,
+ * the latency of each rule that has samples.
+ */
+int
+ln_pdagLatencyToJSON(ln_ctx ctx, const int reset, struct json_object **json_p)
+{
+	int r = 0;
+	struct json_object *json = NULL;
+	struct json_object *value;
+	struct ln_tm_latsum sum;
+
+	CHKN(json = json_object_new_object());
+	CHKN(value = json_object_new_int64(
+		__atomic_load_n(&ctx->latencySampling, __ATOMIC_RELAXED)));
+	json_object_object_add(json, "sampling", value);
+	ln_tmLatSum((ctx->telemetry == NULL) ? NULL : *ln_tmUnparsedLat(ctx->telemetry),
+		&sum, reset);
+	CHKN(value = ln_tmLatToJSON(&sum));
+	json_object_object_add(json, "unparsed", value);
+	CHKN(value = json_object_new_object());
+	json_object_object_add(json, "rules", value);
+	CHKR(ruleLatencyToJSON(ctx, reset, value));
+	*json_p = json;
+	json = NULL;
+done:
+	if(json != NULL)
+		json_object_put(json);
+	return r;
+}
+
 /**
  * Gather and output pdag statistics for the full pdag (ctx)
  * including all disconnected components (type defs).
@@ -679,120 +1113,17 @@ ln_fullPdagStats(ln_ctx ctx, FILE *const fp, const int extendedStats)
 	            "=========\n");
 	ln_pdagStats(ctx, ctx->pdag, fp, extendedStats);
 
-#ifdef	ADVANCED_STATS
-	const uint64_t parsers_failed = advstats_parsers_called - advstats_parsers_success;
-	fprintf(fp, "\n"
-		    "Advanced Runtime Stats\n"
-	            "======================\n");
-	fprintf(fp, "These are actual number from analyzing the control flow "
-		    "at runtime.\n");
-	fprintf(fp, "Note that literal matching is also done via parsers. As such, \n"
-		    "it is expected that fail rates increase with the size of the \n"
-		    "rule base.\n");
-	fprintf(fp, "\n");
-	fprintf(fp, "Parser Calls:\n");
-	fprintf(fp, "total....: %10" PRIu64 "\n", advstats_parsers_called);
-	fprintf(fp, "succesful: %10" PRIu64 "\n", advstats_parsers_success);
-	fprintf(fp, "failed...: %10" PRIu64 " [%d%%]\n",
-		parsers_failed,
-		(int) ((parsers_failed * 100) / advstats_parsers_called) );
-	fprintf(fp, "\nIndividual Parser Calls "
-		    "(never called parsers are not shown):\n");
-	for(  size_t i = 0
-	    ; i < sizeof(parser_lookup_table) / sizeof(struct ln_parser_info)
-	    ; ++i) {
-		if(parser_lookup_table[i].called > 0) {
-			const uint64_t failed = parser_lookup_table[i].called
-				- parser_lookup_table[i].success;
-			fprintf(fp, "%20s: %10" PRIu64 " [%5.2f%%] "
-				    "success: %10" PRIu64 " [%5.1f%%] "
-				    "fail: %10" PRIu64 " [%5.1f%%]"
-			            "\n",
-				parser_lookup_table[i].name,
-				parser_lookup_table[i].called,
-				(float)(parser_lookup_table[i].called * 100)
-				        / advstats_parsers_called,
-				parser_lookup_table[i].success,
-				(float)(parser_lookup_table[i].success * 100)
-				        / parser_lookup_table[i].called,
-				failed,
-				(float)(failed * 100)
-				        / parser_lookup_table[i].called
-			       );
-		}
+	if(ctx->intern != NULL) {
+		fprintf(fp, "\n"
+			    "interned values...: %4d\n", ln_internNumEntries(ctx->intern));
 	}
 
-	uint64_t total_len;
-	uint64_t total_cnt;
-	fprintf(fp, "\n");
-	fprintf(fp, "\n"
-	            "Path Length Statistics\n"
-	            "----------------------\n"
-	            "The regular path length is the number of nodes being visited,\n"
-		    "where each node potentially evaluates several parsers. The\n"
-		    "parser call statistic is the number of parsers called along\n"
-		    "the path. That number is higher, as multiple parsers may be\n"
-		    "called at each node. The number of literal parser calls is\n"
-		    "given explicitly, as they use almost no time to process.\n"
-		    "\n"
-		);
-	total_len = 0;
-	total_cnt = 0;
-	fprintf(fp, "Path Length\n");
-	for(int i = 0 ; i < ADVSTATS_MAX_ENTITIES ; ++i) {
-		if(advstats_pathlens[i] > 0 ) {
-			fprintf(fp, "%3d: %d\n", i, advstats_pathlens[i]);
-			total_len += i * advstats_pathlens[i];
-			total_cnt += advstats_pathlens[i];
-		}
+	if(ctx->telemetry != NULL) {
+		struct ln_tm_shard sum;
+		ln_tmSum(ctx->telemetry, &sum, 0);
+		ln_tmPrint(&sum, fp);
+		ln_latencyStats(ctx, fp);
 	}
-	fprintf(fp, "avg: %f\n", (double) total_len / (double) total_cnt);
-	fprintf(fp, "max: %d\n", advstats_max_pathlen);
-	fprintf(fp, "\n");
-
-	total_len = 0;
-	total_cnt = 0;
-	fprintf(fp, "Nbr Backtracked\n");
-	for(int i = 0 ; i < ADVSTATS_MAX_ENTITIES ; ++i) {
-		if(advstats_backtracks[i] > 0 ) {
-			fprintf(fp, "%3d: %d\n", i, advstats_backtracks[i]);
-			total_len += i * advstats_backtracks[i];
-			total_cnt += advstats_backtracks[i];
-		}
-	}
-	fprintf(fp, "avg: %f\n", (double) total_len / (double) total_cnt);
-	fprintf(fp, "max: %d\n", advstats_max_backtracked);
-	fprintf(fp, "\n");
-
-	/* we calc some stats while we output */
-	total_len = 0;
-	total_cnt = 0;
-	fprintf(fp, "Parser Calls\n");
-	for(int i = 0 ; i < ADVSTATS_MAX_ENTITIES ; ++i) {
-		if(advstats_parser_calls[i] > 0 ) {
-			fprintf(fp, "%3d: %d\n", i, advstats_parser_calls[i]);
-			total_len += i * advstats_parser_calls[i];
-			total_cnt += advstats_parser_calls[i];
-		}
-	}
-	fprintf(fp, "avg: %f\n", (double) total_len / (double) total_cnt);
-	fprintf(fp, "max: %d\n", advstats_max_parser_calls);
-	fprintf(fp, "\n");
-
-	total_len = 0;
-	total_cnt = 0;
-	fprintf(fp, "LITERAL Parser Calls\n");
-	for(int i = 0 ; i < ADVSTATS_MAX_ENTITIES ; ++i) {
-		if(advstats_lit_parser_calls[i] > 0 ) {
-			fprintf(fp, "%3d: %d\n", i, advstats_lit_parser_calls[i]);
-			total_len += i * advstats_lit_parser_calls[i];
-			total_cnt += advstats_lit_parser_calls[i];
-		}
-	}
-	fprintf(fp, "avg: %f\n", (double) total_len / (double) total_cnt);
-	fprintf(fp, "max: %d\n", advstats_max_lit_parser_calls);
-	fprintf(fp, "\n");
-#endif
 }
 
 /**
@@ -1229,6 +1560,35 @@ strrev(char *const __restrict__ str)
 	return str;
 }
 
+/* create the rule mockup for the matching terminal node. The part
+ * for the path inside the main pdag was built at load time and is
+ * shared. Only if nested parsers contributed (in reverse order), a
+ * new string needs to be created.
+ */
+static struct json_object *
+ruleMockup(npb_t *const __restrict__ npb,
+	struct ln_pdag *const __restrict__ endNode)
+{
+	struct json_object *value = NULL;
+	const char *const mockup = (endNode->rule_mockup == NULL)
+		? "" : json_object_get_string(endNode->rule_mockup);
+
+	if(npb->rule == NULL || es_strlen(npb->rule) == 0) {
+		if(endNode->rule_mockup != NULL)
+			return json_object_get(endNode->rule_mockup);
+		return json_object_new_string("");
+	}
+
+	char *const nested = strrev(es_str2cstr(npb->rule, NULL));
+	char *full;
+	if(nested != NULL && asprintf(&full, "%s%s", mockup, nested) != -1) {
+		value = json_object_new_string(full);
+		free(full);
+	}
+	free(nested);
+	return value;
+}
+
 /* note: "originalmsg" is NOT added as metadata in order to keep
  * backwards compatible.
  */
@@ -1245,23 +1605,33 @@ addRuleMetadata(npb_t *const __restrict__ npb,
 	if(ctx->opts & LN_CTXOPT_ADD_RULE) { /* matching rule mockup */
 		if(meta_rule == NULL)
 			meta_rule = json_object_new_object();
-		char *cstr = strrev(es_str2cstr(npb->rule, NULL));
 		json_object_object_add(meta_rule, RULE_MOCKUP_KEY,
-			json_object_new_string(cstr));
-		free(cstr);
+			ruleMockup(npb, endNode));
 	}
 
 	if(ctx->opts & LN_CTXOPT_ADD_RULE_LOCATION) {
 		if(meta_rule == NULL)
 			meta_rule = json_object_new_object();
-		struct json_object *const location = json_object_new_object();
-		value = json_object_new_string(endNode->rb_file);
-		json_object_object_add(location, "file", value);
-		value = json_object_new_int((int)endNode->rb_lineno);
-		json_object_object_add(location, "line", value);
+		struct json_object *location = endNode->rule_location;
+		if(location != NULL) {
+			json_object_get(location);
+		} else {
+			location = json_object_new_object();
+			value = json_object_new_string(endNode->rb_file);
+			json_object_object_add(location, "file", value);
+			value = json_object_new_int((int)endNode->rb_lineno);
+			json_object_object_add(location, "line", value);
+		}
 		json_object_object_add(meta_rule, RULE_LOCATION_KEY, location);
 	}
 
+	if(ctx->opts & LN_CTXOPT_ADD_RULE_ID) {
+		if(meta_rule == NULL)
+			meta_rule = json_object_new_object();
+		json_object_object_add(meta_rule, RULE_ID_KEY,
+			json_object_new_int64(endNode->rule_id));
+	}
+
 	if(meta_rule != NULL) {
 		if(meta == NULL)
 			meta = json_object_new_object();
@@ -1270,14 +1640,14 @@ addRuleMetadata(npb_t *const __restrict__ npb,
 
 #ifdef	ADVANCED_STATS
 	/* complete execution path */
-	if(ctx->opts & LN_CTXOPT_ADD_EXEC_PATH) {
+	if((ctx->opts & LN_CTXOPT_ADD_EXEC_PATH) && npb->astats.exec_path != NULL) {
 		if(meta == NULL)
 			meta = json_object_new_object();
 		char hdr[128];
 		const size_t lenhdr
 		  = snprintf(hdr, sizeof(hdr), "[PATHLEN:%d, PARSER CALLS gen:%d, literal:%d]",
-			     npb->astats.pathlen, npb->astats.parser_calls,
-			     npb->astats.lit_parser_calls);
+			     npb->tmMsg.pathlen, npb->tmMsg.parser_calls,
+			     npb->tmMsg.lit_parser_calls);
 		es_addBuf(&npb->astats.exec_path, hdr, lenhdr);
 		char * cstr = es_str2cstr(npb->astats.exec_path, NULL);
 		value = json_object_new_string(cstr);
@@ -1316,7 +1686,10 @@ done:
 }
 
 
-/* Do some fixup to the json that we cannot do on a lower layer */
+/* Do some fixup to the json that we cannot do on a lower layer.
+ * The merge mode has been determined when the parser was created,
+ * so ordinary fields are directly added.
+ */
 static int
 fixJSON(struct ln_pdag *dag,
 	struct json_object **value,
@@ -1325,13 +1698,16 @@ fixJSON(struct ln_pdag *dag,
 
 {
 	int r = LN_WRONGPARSER;
+	struct json_object *valDotDot;
 
-	if(prs->name ==  NULL) {
+	switch(prs->mergeMode) {
+	case PRS_MERGE_DISCARD:
 		if (*value != NULL) {
 			/* Free the unneeded value */
 			json_object_put(*value);
 		}
-	} else if(prs->name[0] == '.' && prs->name[1] == '\0') {
+		break;
+	case PRS_MERGE_DOT:
 		if(json_object_get_type(*value) == json_type_object) {
 			struct json_object_iterator it = json_object_iter_begin(*value);
 			struct json_object_iterator itEnd = json_object_iter_end(*value);
@@ -1348,48 +1724,95 @@ fixJSON(struct ln_pdag *dag,
 			json_object_object_add_ex(json, prs->name, *value,
 				JSON_C_OBJECT_ADD_KEY_IS_NEW|JSON_C_OBJECT_KEY_IS_CONSTANT);
 		}
-	} else {
-		int isDotDot = 0;
-		struct json_object *valDotDot = NULL;
-		if(json_object_get_type(*value) == json_type_object) {
-			/* TODO: this needs to be sped up by just checking the first
-			 * member and ensuring there is only one member. This requires
-			 * extensions to libfastjson.
-			 */
-			int nSubobj = 0;
-			struct json_object_iterator it = json_object_iter_begin(*value);
-			struct json_object_iterator itEnd = json_object_iter_end(*value);
-			while (!json_object_iter_equal(&it, &itEnd)) {
-				++nSubobj;
-				const char *key = json_object_iter_peek_name(&it);
-				if(key[0] == '.' && key[1] == '.' && key[2] == '\0') {
-					isDotDot = 1;
-					valDotDot = json_object_iter_peek_value(&it);
-				} else {
-					isDotDot = 0;
-				}
-				json_object_iter_next(&it);
-			}
-			if(nSubobj != 1)
-				isDotDot = 0;
-		}
-		if(isDotDot) {
+		break;
+	case PRS_MERGE_DOTDOT:
+		if(json_object_get_type(*value) == json_type_object
+		   && json_object_object_length(*value) == 1
+		   && json_object_object_get_ex(*value, "..", &valDotDot)) {
 			LN_DBGPRINTF(dag->ctx, "subordinate field name is '..', combining");
 			json_object_get(valDotDot);
 			json_object_put(*value);
 			json_object_object_add_ex(json, prs->name, valDotDot,
 				JSON_C_OBJECT_ADD_KEY_IS_NEW|JSON_C_OBJECT_KEY_IS_CONSTANT);
-		} else {
-			json_object_object_add_ex(json, prs->name, *value,
-				JSON_C_OBJECT_ADD_KEY_IS_NEW|JSON_C_OBJECT_KEY_IS_CONSTANT);
+			break;
 		}
+		/*FALLTHROUGH*/
+	default:
+		json_object_object_add_ex(json, prs->name, *value,
+			JSON_C_OBJECT_ADD_KEY_IS_NEW|JSON_C_OBJECT_KEY_IS_CONSTANT);
+		break;
 	}
 	r = 0;
 	return r;
 }
 
+/* Store a top-level field in the result record (see ln_normalizeRecord).
+ * Values of span parsers have not been created, they are referenced
+ * in the message instead.
+ */
+static int
+recordField(npb_t *const __restrict__ npb,
+	const ln_parser_t *const prs,
+	struct json_object *const value,
+	const size_t offs,
+	const size_t parsed)
+{
+	if(value == NULL && prs->spanValue) {
+		if(prs->mergeMode == PRS_MERGE_DISCARD)
+			return 0;
+		return ln_recordAddSpan(npb->rec, prs->name, npb->str + offs, parsed);
+	}
+	return ln_recordAddValue(npb->rec, prs, value);
+}
+
 // TODO: streamline prototype when done with changes
 
+static inline uint64_t
+monotonicNs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* check the limits of the work budget that can be exceeded by work
+ * already done: backtracks, bytes and (every 64 parser calls, so that
+ * the clock is read rarely) the deadline. Once the budget is exceeded,
+ * all parser calls fail and no terminal is accepted, so the walk
+ * unwinds quickly and the message is not matched.
+ */
+static int
+budgetOverrun(npb_t *const __restrict__ npb)
+{
+	const struct ln_budget *const budget = npb->budget;
+
+	if(npb->budgetExceeded)
+		return 1;
+	if(budget->backtracks != 0 && (unsigned) npb->tmMsg.backtracked > budget->backtracks)
+		npb->budgetExceeded = LN_BUDGET_BACKTRACKS;
+	else if(budget->bytes != 0 && npb->bytes > budget->bytes)
+		npb->budgetExceeded = LN_BUDGET_BYTES;
+	else if(npb->deadline != 0 && (npb->tmMsg.parser_calls & 63) == 0
+		&& monotonicNs() > npb->deadline)
+		npb->budgetExceeded = LN_BUDGET_DEADLINE;
+	return npb->budgetExceeded;
+}
+
+/* check the work budget before a parser call: the call must not be
+ * one more than permitted.
+ */
+static int
+budgetExceeded(npb_t *const __restrict__ npb)
+{
+	const struct ln_budget *const budget = npb->budget;
+
+	if(!npb->budgetExceeded && budget->parserCalls != 0
+	   && (unsigned) npb->tmMsg.parser_calls >= budget->parserCalls)
+		npb->budgetExceeded = LN_BUDGET_PARSER_CALLS;
+	return budgetOverrun(npb);
+}
+
 static int
 tryParser(npb_t *const __restrict__ npb,
 	struct ln_pdag *dag,
@@ -1402,6 +1825,12 @@ tryParser(npb_t *const __restrict__ npb,
 	int r;
 	struct ln_pdag *endNode = NULL;
 	size_t parsedTo = npb->parsedTo;
+	/* in record mode, values taken from the message are only referenced */
+	const int spanOnly = npb->rec != NULL && npb->nested == 0 && prs->spanValue;
+	if(npb->budget != NULL && budgetExceeded(npb))
+		return LN_WRONGPARSER;
+	if(npb->ppPos != NULL) /* the caller restores the position */
+		npb->ppPos = ln_ppCall(npb->ctx->pathprof, npb->ppPos, prs);
 #	ifdef	ADVANCED_STATS
 	char hdr[16];
 	const size_t lenhdr
@@ -1432,15 +1861,20 @@ tryParser(npb_t *const __restrict__ npb,
 	es_addChar(&npb->astats.exec_path, ',');
 #	endif
 
+	++npb->nested;
 	if(prs->prsid == PRS_CUSTOM_TYPE) {
-		if(*value == NULL)
+		/* if the value is not needed, the type is just matched */
+		const int noValue = (prs->mergeMode == PRS_MERGE_DISCARD || npb->noValues);
+		if(*value == NULL && !noValue)
 			*value = json_object_new_object();
 		LN_DBGPRINTF(dag->ctx, "calling custom parser '%s'", dag->ctx->type_pdags[prs->custTypeIdx].name);
+		npb->noValues += noValue;
 		r = ln_normalizeRec(npb, dag->ctx->type_pdags[prs->custTypeIdx].pdag, *offs, 1, *value, &endNode);
+		npb->noValues -= noValue;
 		LN_DBGPRINTF(dag->ctx, "called CUSTOM PARSER '%s', result %d, "
 			"offs %zd, *pParsed %zd", dag->ctx->type_pdags[prs->custTypeIdx].name, r, *offs, *pParsed);
 		*pParsed = npb->parsedTo - *offs;
-		if (r != 0) {
+		if (r != 0 && *value != NULL) {
 			json_object_put(*value);
 			*value = NULL;
 		}
@@ -1449,25 +1883,33 @@ tryParser(npb_t *const __restrict__ npb,
 		es_addBuf(&npb->astats.exec_path, "[R:USR],", 8);
 		#endif
 	} else {
+		const int intern_save = npb->intern;
+		npb->intern = prs->intern;
 		r = parser_lookup_table[prs->prsid].parser(npb,
-			offs, prs->parser_data, pParsed, (prs->name == NULL) ? NULL : value);
+			offs, prs->parser_data, pParsed,
+			(prs->mergeMode == PRS_MERGE_DISCARD || spanOnly || npb->noValues)
+			? NULL : value);
+		npb->intern = intern_save;
 	}
+	--npb->nested;
 	LN_DBGPRINTF(npb->ctx, "parser lookup returns %d, pParsed %zu", r, *pParsed);
 	npb->parsedTo = parsedTo;
 
-#ifdef	ADVANCED_STATS
-	++advstats_parsers_called;
-	++npb->astats.parser_calls;
+	++npb->tmMsg.parser_calls;
 	if(prs->prsid == PRS_LITERAL)
-		++npb->astats.lit_parser_calls;
-	if(r == 0)
-		++advstats_parsers_success;
-	if(prs->prsid != PRS_CUSTOM_TYPE) {
-		++parser_lookup_table[prs->prsid].called;
+		++npb->tmMsg.lit_parser_calls;
+	if(r == 0 && prs->prsid != PRS_CUSTOM_TYPE && prs->prsid != PRS_REPEAT)
+		npb->bytes += *pParsed; /* nested parsers count their parts */
+	if(npb->tm != NULL) {
+		ln_tmAdd(&npb->tm->parsers_called, 1);
 		if(r == 0)
-			++parser_lookup_table[prs->prsid].success;
+			ln_tmAdd(&npb->tm->parsers_success, 1);
+		if(prs->prsid != PRS_CUSTOM_TYPE) {
+			ln_tmAdd(&npb->tm->prs_called[prs->prsid], 1);
+			if(r == 0)
+				ln_tmAdd(&npb->tm->prs_success[prs->prsid], 1);
+		}
 	}
-#endif
 	return r;
 }
 
@@ -1490,11 +1932,19 @@ add_str_reversed(npb_t *const __restrict__ npb,
  * This means deepest entries come first. We solve this somewhat
  * elegantly by reversion strings, and then reversion the string
  * once more when we emit it, so that we get the right order.
+ * Only parsers called by other parsers are recorded here, the
+ * main pdag part of the mockup is precomputed per terminal node,
+ * except for terminals reached via several paths.
  */
 static inline void
 add_rule_to_mockup(npb_t *const __restrict__ npb,
-	const ln_parser_t *const __restrict__ prs)
+	const ln_parser_t *const __restrict__ prs,
+	const struct ln_pdag *const __restrict__ endNode)
 {
+	if(npb->nested == 0 && !endNode->flags.multiPath)
+		return; /* main pdag path is precomputed */
+	if(npb->rule == NULL && (npb->rule = es_newStr(128)) == NULL)
+		return;
 	if(prs->prsid == PRS_LITERAL) {
 		const char *const val =
 			  ln_DataForDisplayLiteral(npb->ctx,
@@ -1548,17 +1998,18 @@ ln_normalizeRec(npb_t *const __restrict__ npb,
 	size_t parsedTo = npb->parsedTo;
 	size_t parsed = 0;
 	struct json_object *value;
+	const int btMark = (npb->bt != NULL) ? ln_btMark() : 0;
 	
 LN_DBGPRINTF(dag->ctx, "%zu: enter parser, dag node %p, json %p", offs, dag, json);
 
 	++dag->stats.called;
+	++npb->tmMsg.pathlen;
 #ifdef	ADVANCED_STATS
-	++npb->astats.pathlen;
 	++npb->astats.recursion_level;
 #endif
 
 	/* now try the parsers */
-	for(iprs = 0 ; iprs < dag->nparsers && r != 0 ; ++iprs) {
+	for(iprs = 0 ; iprs < dag->nparsers && r != 0 && !npb->budgetExceeded ; ++iprs) {
 		const ln_parser_t *const prs = dag->parsers + iprs;
 		if(dag->ctx->debug) {
 			LN_DBGPRINTF(dag->ctx, "%zu/%d:trying '%s' parser for field '%s', "
@@ -1570,6 +2021,8 @@ LN_DBGPRINTF(dag->ctx, "%zu: enter parser, dag node %p, json %p", offs, dag, jso
 		}
 		i = offs;
 		value = NULL;
+		struct ln_pp_node *const ppPos = npb->ppPos;
+		const int callsBefore = npb->tmMsg.parser_calls;
 		localR = tryParser(npb, dag, &i, &parsed, &value, prs);
 		if(localR == 0) {
 			parsedTo = i + parsed;
@@ -1581,14 +2034,27 @@ LN_DBGPRINTF(dag->ctx, "%zu: enter parser, dag node %p, json %p", offs, dag, jso
 			LN_DBGPRINTF(dag->ctx, "%zu: subtree returns %d, parsedTo %zu", offs, r, parsedTo);
 			if(r == 0) {
 				LN_DBGPRINTF(dag->ctx, "%zu: parser matches at %zu", offs, i);
-				CHKR(fixJSON(dag, &value, json, prs));
+				if(npb->bt != NULL)
+					ln_btResolve(npb->bt, btMark, prs);
+				if(npb->rec != NULL && npb->nested == 0) {
+					CHKR(recordField(npb, prs, value, i, parsed));
+				} else if(json != NULL) {
+					CHKR(fixJSON(dag, &value, json, prs));
+				} else if(value != NULL) {
+					json_object_put(value); /* only matching */
+				}
 				if(npb->ctx->opts & LN_CTXOPT_ADD_RULE) {
-					add_rule_to_mockup(npb, prs);
+					add_rule_to_mockup(npb, prs, *endNode);
 				}
 			} else {
 				++dag->stats.backtracked;
+				++npb->tmMsg.backtracked;
+				if(npb->ppPos != NULL)
+					ln_ppBacktracked(npb->ppPos);
+				if(npb->bt != NULL)
+					ln_btPending(npb->bt, dag, prs,
+						npb->tmMsg.parser_calls - callsBefore);
 				#ifdef	ADVANCED_STATS
-					++npb->astats.backtracked;
 					es_addBuf(&npb->astats.exec_path, "[B]", 3);
 				#endif
 				LN_DBGPRINTF(dag->ctx, "%zu nonmatch, backtracking required, parsed to=%zu",
@@ -1598,6 +2064,7 @@ LN_DBGPRINTF(dag->ctx, "%zu: enter parser, dag node %p, json %p", offs, dag, jso
 				}
 			}
 		}
+		npb->ppPos = ppPos;
 		/* did we have a longer parser --> then update */
 		if(parsedTo > npb->parsedTo)
 			npb->parsedTo = parsedTo;
@@ -1605,13 +2072,16 @@ LN_DBGPRINTF(dag->ctx, "%zu: enter parser, dag node %p, json %p", offs, dag, jso
 	}
 
 LN_DBGPRINTF(dag->ctx, "offs %zu, strLen %zu, isTerm %d", offs, npb->strLen, dag->flags.isTerminal);
-	if(dag->flags.isTerminal && (offs == npb->strLen || bPartialMatch)) {
+	if(dag->flags.isTerminal && (offs == npb->strLen || bPartialMatch)
+	   && (npb->budget == NULL || !budgetOverrun(npb))) {
 		*endNode = dag;
 		r = 0;
 		goto done;
 	}
 
 done:
+	if(npb->bt != NULL) /* backtracks not followed by a matching sibling */
+		ln_btResolve(npb->bt, btMark, NULL);
 	LN_DBGPRINTF(dag->ctx, "%zu returns %d, pParsedTo %zu, parsedTo %zu",
 		offs, r, npb->parsedTo, parsedTo);
 #	ifdef	ADVANCED_STATS
@@ -1620,101 +2090,340 @@ done:
 	return r;
 }
 
-int
-ln_normalize(ln_ctx ctx, const char *str, const size_t strLen, struct json_object **json_p)
+/* walk the main pdag for the message in npb. The message matched
+ * if 0 is returned and endNode is terminal.
+ */
+static int
+normalizeMain(npb_t *const __restrict__ npb,
+	struct json_object *const json,
+	struct ln_pdag **endNode)
 {
+	ln_ctx ctx = npb->ctx;
 	int r;
-	struct ln_pdag *endNode = NULL;
-	/* old cruft */
-	if(ctx->version == 1) {
-		r = ln_v1_normalize(ctx, str, strLen, json_p);
-		goto done;
-	}
-	/* end old cruft */
 
-	npb_t npb;
-	memset(&npb, 0, sizeof(npb));
-	npb.ctx = ctx;
-	npb.str = str;
-	npb.strLen = strLen;
-	if(ctx->opts & LN_CTXOPT_ADD_RULE) {
-		npb.rule = es_newStr(1024);
-	}
-#	ifdef ADVANCED_STATS
-	npb.astats.exec_path = es_newStr(1024);
-#	endif
-
-	if(*json_p == NULL) {
-		CHKN(*json_p = json_object_new_object());
-	}
-
-	r = ln_normalizeRec(&npb, ctx->pdag, 0, 0, *json_p, &endNode);
+	r = ln_normalizeRec(npb, ctx->pdag, 0, 0, json, endNode);
 
 	if(ctx->debug) {
 		if(r == 0) {
 			LN_DBGPRINTF(ctx, "final result for normalizer: parsedTo %zu, endNode %p, "
 				     "isTerminal %d, tagbucket %p",
-				     npb.parsedTo, endNode, endNode->flags.isTerminal, endNode->tags);
+				     npb->parsedTo, *endNode, (*endNode)->flags.isTerminal, (*endNode)->tags);
 		} else {
 			LN_DBGPRINTF(ctx, "final result for normalizer: parsedTo %zu, endNode %p",
-				     npb.parsedTo, endNode);
+				     npb->parsedTo, *endNode);
 		}
 	}
 	LN_DBGPRINTF(ctx, "DONE, final return is %d", r);
-	if(r == 0 && endNode->flags.isTerminal) {
+	return r;
+}
+
+/* add everything but the parsed fields to the event: tags, annotations,
+ * metadata - or the unparsed data, if the message did not match.
+ */
+static void
+finalizeEvent(npb_t *const __restrict__ npb,
+	struct json_object *const json,
+	struct ln_pdag *const endNode)
+{
+	ln_ctx ctx = npb->ctx;
+
+	if(endNode != NULL) {
 		/* success, finalize event */
 		if(endNode->tags != NULL) {
 			/* add tags to an event */
 			json_object_get(endNode->tags);
-			json_object_object_add(*json_p, "event.tags", endNode->tags);
-			CHKR(ln_annotate(ctx, *json_p, endNode->tags));
+			json_object_object_add(json, "event.tags", endNode->tags);
+			ln_annotateCompiled(json, endNode->annots, endNode->nannots);
 		}
 		if(ctx->opts & LN_CTXOPT_ADD_ORIGINALMSG) {
 			/* originalmsg must be kept outside of metadata for
 			 * backward compatibility reasons.
 			 */
-			json_object_object_add(*json_p, ORIGINAL_MSG_KEY,
-				json_object_new_string_len(str, strLen));
+			json_object_object_add(json, ORIGINAL_MSG_KEY,
+				json_object_new_string_len(npb->str, npb->strLen));
 		}
-		addRuleMetadata(&npb, *json_p, endNode);
-		r = 0;
+		addRuleMetadata(npb, json, endNode);
 	} else {
-		addUnparsedField(str, strLen, npb.parsedTo, *json_p);
+		addUnparsedField(npb->str, npb->strLen, npb->parsedTo, json);
+		if(npb->budgetExceeded) {
+			struct json_object *meta = json_object_new_object();
+			if(meta != NULL) {
+				json_object_object_add(meta, BUDGET_EXCEEDED_KEY,
+					json_object_new_string(ln_tmAbortName(npb->budgetExceeded)));
+				json_object_object_add(json, META_KEY, meta);
+			}
+		}
 	}
+}
 
-	if(ctx->opts & LN_CTXOPT_ADD_RULE) {
-		es_deleteStr(npb.rule);
-	}
+/* shard to update for the current message, NULL if telemetry is off.
+ * The flag is published after the telemetry object (see ln_setTelemetry).
+ */
+static inline struct ln_tm_shard *
+telemetryShard(ln_ctx ctx)
+{
+	return __atomic_load_n(&ctx->telemetryOn, __ATOMIC_ACQUIRE)
+		? ln_tmShard(ctx->telemetry) : NULL;
+}
+
+/* path to start profiling with, NULL if profiling is off.
+ * The flag is published after the profile (see ln_setPathProfiling).
+ */
+static inline struct ln_pp_node *
+pathProfRoot(ln_ctx ctx)
+{
+	return __atomic_load_n(&ctx->pathprofOn, __ATOMIC_ACQUIRE)
+		? ln_ppRoot(ctx->pathprof) : NULL;
+}
+
+/* backtracking analysis to update, NULL if off.
+ * The flag is published after the analysis (see ln_setBacktrackAnalysis).
+ */
+static inline ln_btrack *
+btrackObj(ln_ctx ctx)
+{
+	return __atomic_load_n(&ctx->btrackOn, __ATOMIC_ACQUIRE) ? ctx->btrack : NULL;
+}
+
+/* time this message? Only done with telemetry on, for every Nth
+ * message of a thread.
+ */
+static inline int
+latencyStart(ln_ctx ctx, const npb_t *const npb, struct timespec *const start)
+{
+	if(npb->tm == NULL
+	   || !ln_tmSampleNow(__atomic_load_n(&ctx->latencySampling, __ATOMIC_RELAXED)))
+		return 0;
+	clock_gettime(CLOCK_MONOTONIC, start);
+	return 1;
+}
+
+/* attribute the time since start to the matched rule or to "unparsed" */
+static void
+latencyEnd(ln_ctx ctx, const int r, struct ln_pdag *const endNode,
+	const struct timespec *const start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	const uint64_t ns = (uint64_t) (now.tv_sec - start->tv_sec) * 1000000000
+		+ now.tv_nsec - start->tv_nsec;
+	ln_tmLatAdd((r == 0 && endNode->flags.isTerminal) ? &endNode->latency
+		: ln_tmUnparsedLat(ctx->telemetry), ns);
+}
+
+/* set up the work budget of a message, if one is configured */
+static inline void
+budgetStart(ln_ctx ctx, npb_t *const npb)
+{
+	if(!ctx->budget.active)
+		return;
+	npb->budget = &ctx->budget;
+	if(ctx->budget.deadlineNs != 0)
+		npb->deadline = monotonicNs() + ctx->budget.deadlineNs;
+}
 
+/* the message is done: record its outcome in the execution path
+ * (if enabled) and its counters in the telemetry (if enabled).
+ */
+static void
+updateStats(npb_t *const __restrict__ npb, const int r, struct ln_pdag *const endNode)
+{
 #ifdef	ADVANCED_STATS
 	if(r != 0)
-		es_addBuf(&npb.astats.exec_path, "[FAILED]", 8);
+		es_addBuf(&npb->astats.exec_path, "[FAILED]", 8);
 	else if(!endNode->flags.isTerminal)
-		es_addBuf(&npb.astats.exec_path, "[FAILED:NON-TERMINAL]", 21);
-	if(npb.astats.pathlen < ADVSTATS_MAX_ENTITIES)
-		advstats_pathlens[npb.astats.pathlen]++;
-	if(npb.astats.pathlen > advstats_max_pathlen) {
-		advstats_max_pathlen = npb.astats.pathlen;
+		es_addBuf(&npb->astats.exec_path, "[FAILED:NON-TERMINAL]", 21);
+#endif
+	if(npb->tm != NULL) {
+		npb->tmMsg.aborted = npb->budgetExceeded;
+		ln_tmAddMsg(npb->tm, &npb->tmMsg, r == 0 && endNode->flags.isTerminal);
 	}
-	if(npb.astats.backtracked < ADVSTATS_MAX_ENTITIES)
-		advstats_backtracks[npb.astats.backtracked]++;
-	if(npb.astats.backtracked > advstats_max_backtracked) {
-		advstats_max_backtracked = npb.astats.backtracked;
+}
+
+int
+ln_normalize(ln_ctx ctx, const char *str, const size_t strLen, struct json_object **json_p)
+{
+	int r;
+	struct ln_pdag *endNode = NULL;
+	struct timespec start;
+	/* old cruft */
+	if(ctx->version == 1) {
+		r = ln_v1_normalize(ctx, str, strLen, json_p);
+		goto done;
 	}
+	/* end old cruft */
+
+	npb_t npb;
+	memset(&npb, 0, sizeof(npb));
+	npb.ctx = ctx;
+	npb.str = str;
+	npb.strLen = strLen;
+	npb.tm = telemetryShard(ctx);
+	npb.ppPos = pathProfRoot(ctx);
+	npb.bt = btrackObj(ctx);
+	budgetStart(ctx, &npb);
+	const int timed = latencyStart(ctx, &npb, &start);
+#	ifdef ADVANCED_STATS
+	npb.astats.exec_path = es_newStr(1024);
+#	endif
+
+	if(*json_p == NULL) {
+		CHKN(*json_p = json_object_new_object());
+	}
+
+	r = normalizeMain(&npb, *json_p, &endNode);
+	updateStats(&npb, r, endNode);
+	finalizeEvent(&npb, *json_p,
+		(r == 0 && endNode->flags.isTerminal) ? endNode : NULL);
+	if(timed)
+		latencyEnd(ctx, r, endNode, &start);
+	r = 0;
+
+	if(npb.rule != NULL) {
+		es_deleteStr(npb.rule);
+	}
+#	ifdef ADVANCED_STATS
+	es_deleteStr(npb.astats.exec_path);
+#	endif
+done:	return r;
+}
+
+/* The record is filled while walking the main pdag: top-level parsers
+ * store their values directly in the record instead of a json object.
+ * Nested parsers (user-defined types, repeat) still build json values,
+ * which become a single field of the record.
+ */
+int
+ln_normalizeRecord(ln_ctx ctx, const char *str, const size_t strLen, ln_record *rec)
+{
+	int r;
+	struct ln_pdag *endNode = NULL;
+	struct timespec start;
+
+	ln_recordReset(rec);
+	rec->ctx = ctx;
+	rec->str = str;
+	rec->strLen = strLen;
+	if(ctx->version == 1) {
+		ln_errprintf(ctx, 0, "result records are not supported for v1 rulebases");
+		FAIL(LN_BADCONFIG);
+	}
+
+	npb_t npb;
+	memset(&npb, 0, sizeof(npb));
+	npb.ctx = ctx;
+	npb.str = str;
+	npb.strLen = strLen;
+	npb.tm = telemetryShard(ctx);
+	npb.ppPos = pathProfRoot(ctx);
+	npb.bt = btrackObj(ctx);
+	budgetStart(ctx, &npb);
+	const int timed = latencyStart(ctx, &npb, &start);
+	npb.rec = rec;
+	npb.rule = rec->rule;
+#	ifdef ADVANCED_STATS
+	npb.astats.exec_path = es_newStr(1024);
+#	endif
 
-	/* parser calls */
-	if(npb.astats.parser_calls < ADVSTATS_MAX_ENTITIES)
-		advstats_parser_calls[npb.astats.parser_calls]++;
-	if(npb.astats.parser_calls > advstats_max_parser_calls) {
-		advstats_max_parser_calls = npb.astats.parser_calls;
+	r = normalizeMain(&npb, NULL, &endNode);
+	updateStats(&npb, r, endNode);
+#	ifdef ADVANCED_STATS
+	es_deleteStr(npb.astats.exec_path);
+#	endif
+	rec->rule = npb.rule; /* may have been allocated */
+	if(r == 0 && endNode->flags.isTerminal) {
+		rec->endNode = endNode;
+		rec->parsedTo = strLen;
+		ln_recordFinish(rec);
+	} else {
+		/* fields of partial matches are not part of the result */
+		ln_recordReset(rec);
+		rec->parsedTo = npb.parsedTo;
+		rec->budgetExceeded = npb.budgetExceeded;
 	}
-	if(npb.astats.lit_parser_calls < ADVSTATS_MAX_ENTITIES)
-		advstats_lit_parser_calls[npb.astats.lit_parser_calls]++;
-	if(npb.astats.lit_parser_calls > advstats_max_lit_parser_calls) {
-		advstats_max_lit_parser_calls = npb.astats.lit_parser_calls;
+	if(timed)
+		latencyEnd(ctx, r, endNode, &start);
+	r = 0;
+done:	return r;
+}
+
+/* Classification walks the main pdag exactly like ln_normalize(), but
+ * all parsers are called without value pointer, so they only validate.
+ */
+int
+ln_classify(ln_ctx ctx, const char *str, const size_t strLen,
+	unsigned *rule_id, struct json_object **tags)
+{
+	int r;
+	struct ln_pdag *endNode = NULL;
+	struct timespec start;
+
+	*rule_id = 0;
+	if(tags != NULL)
+		*tags = NULL;
+	if(ctx->version == 1) {
+		ln_errprintf(ctx, 0, "classification is not supported for v1 rulebases");
+		FAIL(LN_BADCONFIG);
 	}
 
+	npb_t npb;
+	memset(&npb, 0, sizeof(npb));
+	npb.ctx = ctx;
+	npb.str = str;
+	npb.strLen = strLen;
+	npb.tm = telemetryShard(ctx);
+	npb.ppPos = pathProfRoot(ctx);
+	npb.bt = btrackObj(ctx);
+	budgetStart(ctx, &npb);
+	const int timed = latencyStart(ctx, &npb, &start);
+	npb.noValues = 1;
+#	ifdef ADVANCED_STATS
+	npb.astats.exec_path = es_newStr(1024);
+#	endif
+
+	r = normalizeMain(&npb, NULL, &endNode);
+	updateStats(&npb, r, endNode);
+#	ifdef ADVANCED_STATS
 	es_deleteStr(npb.astats.exec_path);
-#endif
+#	endif
+	if(npb.rule != NULL) /* only with LN_CTXOPT_ADD_RULE */
+		es_deleteStr(npb.rule);
+	if(r == 0 && endNode->flags.isTerminal) {
+		*rule_id = endNode->rule_id;
+		if(tags != NULL)
+			*tags = endNode->tags;
+	}
+	if(timed)
+		latencyEnd(ctx, r, endNode, &start);
+	r = 0;
 done:	return r;
 }
+
+int
+ln_recordToJSON(const ln_record *rec, struct json_object **json_p)
+{
+	int r = 0;
+	struct json_object *json = NULL;
+
+	CHKN(json = json_object_new_object());
+	CHKR(ln_recordFieldsToJSON(rec, json));
+
+	npb_t npb;
+	memset(&npb, 0, sizeof(npb));
+	npb.ctx = rec->ctx;
+	npb.str = rec->str;
+	npb.strLen = rec->strLen;
+	npb.parsedTo = rec->parsedTo;
+	npb.rule = rec->rule;
+	npb.budgetExceeded = rec->budgetExceeded;
+	finalizeEvent(&npb, json, rec->endNode);
+
+done:
+	if(r != 0 && json != NULL) {
+		json_object_put(json);
+		json = NULL;
+	}
+	*json_p = json;
+	return r;
+}
@@ -12,14 +12,19 @@
 #include <stdio.h>
 #include <libestr.h>
 #include <stdint.h>
+#include "telemetry.h"
+#include "pathprof.h"
+#include "btrack.h"
 
 #define META_KEY "metadata"
 #define ORIGINAL_MSG_KEY "originalmsg"
 #define UNPARSED_DATA_KEY "unparsed-data"
 #define EXEC_PATH_KEY "exec-path"
+#define BUDGET_EXCEEDED_KEY "budget-exceeded"
 #define META_RULE_KEY "rule"
 #define RULE_MOCKUP_KEY "mockup"
 #define RULE_LOCATION_KEY "location"
+#define RULE_ID_KEY "id"
 
 typedef struct ln_pdag ln_pdag; /**< the parse DAG object */
 typedef struct ln_parser_s ln_parser_t;
@@ -75,11 +80,31 @@ struct ln_type_pdag;
  * for the prsid_t type (which gains cache performance). If more parsers
  * come up, the type must be modified.
  */
+/**
+ * How a parser's value is merged into the result object. This is
+ * determined when the parser instance is created, so that ordinary
+ * fields need no inspection of the value during normalization.
+ */
+#define PRS_MERGE_DISCARD	0 /**< no name ("-"), value is not needed */
+#define PRS_MERGE_ADD		1 /**< add value under field name */
+#define PRS_MERGE_DOTDOT	2 /**< like ADD, but unwrap object with lone ".." member */
+#define PRS_MERGE_DOT		3 /**< name ".": merge object members into result */
+
+/**
+ * Parser properties, as given in the parser lookup table.
+ */
+#define PRS_F_MSGKEYS	0x01 /**< may return objects whose keys come from the message */
+#define PRS_F_SPAN	0x02 /**< value is the parsed part of the message, as string */
+#define PRS_F_SPAN_FMT	0x04 /**< like PRS_F_SPAN, but only for "format":"string" */
+
 /**
  * object describing a specific parser instance.
  */
 struct ln_parser_s {
 	prsid_t prsid;		/**< parser ID (for lookup table) */
+	uint8_t mergeMode;	/**< one of PRS_MERGE_* */
+	uint8_t intern;		/**< use shared strings for recurring values */
+	uint8_t spanValue;	/**< value is the parsed message part (see PRS_F_SPAN) */
 	ln_pdag *node;		/**< node to branch to if parser succeeded */
 	void *parser_data;	/**< opaque data that the field-parser understands */
 	size_t custTypeIdx;	/**< index to custom type, if such is used */
@@ -95,10 +120,7 @@ struct ln_parser_info {
 	int (*parser)(npb_t *npb, size_t*, void *const,
 				  size_t*, struct json_object **); /**< parser to use */
 	void (*destruct)(ln_ctx, void *const); /* note: destructor is only needed if parser data exists */
-#ifdef ADVANCED_STATS
-	uint64_t called;
-	uint64_t success;
-#endif
+	int flags;		/**< PRS_F_* properties of this parser */
 };
 
 
@@ -111,8 +133,17 @@ struct ln_pdag {
 	struct {
 		unsigned isTerminal:1;	/**< designates this node a terminal sequence */
 		unsigned visited:1;	/**< work var for recursive procedures */
+		unsigned multiPath:1;	/**< terminal reached via several paths (alternative) */
 	} flags;
 	struct json_object *tags;	/**< tags to assign to events of this type */
+	struct ln_annot_field_s *annots; /**< annotations for tags, precompiled after load */
+	int nannots;
+	struct json_object *rule_mockup; /**< mockup of main pdag path (terminals only),
+					   NULL if multiPath */
+	struct json_object *rule_location; /**< metadata rule location (terminals only) */
+	int nfields;			/**< max named fields on paths to node */
+	unsigned rule_id;		/**< stable numeric rule id (terminals only), 0: none */
+	struct ln_tm_lat *latency;	/**< sampled latency (terminals only), NULL: no sample yet */
 	int refcnt;			/**< reference count for deleting tracking */
 	struct {
 		unsigned called;
@@ -128,18 +159,9 @@ struct ln_pdag {
 
 #ifdef ADVANCED_STATS
 struct advstats {
-	int pathlen;
-	int parser_calls;		/**< parser calls in general during path */
-	int lit_parser_calls;		/**< same just for the literal parser */
-	int backtracked;
 	int recursion_level;
 	es_str_t *exec_path;
 };
-#define ADVSTATS_MAX_ENTITIES 100
-extern int advstats_max_pathlen;
-extern int advstats_pathlens[ADVSTATS_MAX_ENTITIES];
-extern int advstats_max_backtracked;
-extern int advstats_backtracks[ADVSTATS_MAX_ENTITIES];
 #endif
 
 /** the "normalization parameter block" (npb)
@@ -159,12 +181,20 @@ struct npb {
 	const char *str;		/**< to-be-normalized message */
 	size_t strLen;			/**< length of it */
 	size_t parsedTo;		/**< up to which byte could this be parsed? */
-	es_str_t *rule;			/**< a mock-up of the rule used to parse */
-	es_str_t *exec_path;
+	es_str_t *rule;			/**< mock-up parts of nested parsers (reversed) */
+	int nested;			/**< >0 while inside a parser (user-defined type, repeat) */
+	int intern;			/**< current parser wants shared strings (see ln_internStr) */
+	int noValues;			/**< >0 while inside a parser whose value is not needed */
+	struct ln_record_s *rec;	/**< if non-NULL, store top-level fields here, not in json */
+	struct ln_tm_shard *tm;		/**< telemetry shard to update, NULL if telemetry is off */
+	struct ln_tm_msg tmMsg;		/**< per-message telemetry counters */
+	struct ln_pp_node *ppPos;	/**< current path in path profile, NULL if profiling is off */
+	ln_btrack *bt;			/**< backtracking analysis to update, NULL if off */
+	const struct ln_budget *budget;	/**< work budget, NULL if unlimited */
+	uint64_t deadline;		/**< budget deadline in ns (monotonic clock), 0: none */
+	size_t bytes;			/**< bytes matched by parsers so far */
+	int budgetExceeded;		/**< LN_BUDGET_* once the budget is exceeded, else 0 */
 #ifdef ADVANCED_STATS
-	int pathlen;
-	int backtracked;
-	int recursion_level;
 	struct advstats astats;
 #endif
 };
@@ -248,8 +278,14 @@ struct ln_pdag * ln_buildPDAG(struct ln_pdag *DAG, es_str_t *str, size_t offs);
 
 
 prsid_t ln_parserName2ID(const char *const __restrict__ name);
+const char *ln_parserIDName(const prsid_t id);
+const struct ln_parser_info *ln_parserInfo(const prsid_t id);
+void ln_addParserDisplayName(ln_ctx ctx, const ln_parser_t *prs, es_str_t **str);
+const struct ln_pdag *ln_pdagFirstTerminal(const struct ln_pdag *dag);
 int ln_pdagOptimize(ln_ctx ctx);
+void ln_pdagApplyProjection(ln_ctx ctx);
 void ln_fullPdagStats(ln_ctx ctx, FILE *const fp, const int);
+int ln_pdagLatencyToJSON(ln_ctx ctx, const int reset, struct json_object **json_p);
 ln_parser_t * ln_newLiteralParser(ln_ctx ctx, char lit);
 ln_parser_t* ln_newParser(ln_ctx ctx, json_object *const prscnf);
 struct ln_type_pdag * ln_pdagFindType(ln_ctx ctx, const char *const __restrict__ name, const int bAdd);
@@ -0,0 +1,557 @@
+/**
+ * @file record.c
+ * @brief Implementation of the flat normalization result.
+ *
+ * A record keeps all of its memory between messages. The field array
+ * only ever grows and is reset by setting its size to zero. Data that
+ * must be copied comes from a simple bump allocator whose blocks are
+ * also kept. So, once warmed up, normalizing a message into a record
+ * does not allocate memory except for converted json values.
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <json.h>
+
+#include "liblognorm.h"
+#include "lognorm.h"
+#include "annot.h"
+#include "internal.h"
+#include "record.h"
+
+#define ARENA_BLKSIZE 4096
+#define RECORD_INIT_FIELDS 16
+
+/* values for ln_recfield.merged */
+#define MERGED_NO	0
+#define MERGED_FIRST	1 /**< first member of a merged object */
+#define MERGED_NEXT	2 /**< further member of the same object */
+
+ln_record *
+ln_newRecord(void)
+{
+	return calloc(1, sizeof(ln_record));
+}
+
+
+void
+ln_deleteRecord(ln_record *rec)
+{
+	struct ln_arena_blk *blk, *del;
+
+	if(rec == NULL)
+		return;
+	ln_recordReset(rec);
+	for(blk = rec->arena ; blk != NULL ; ) {
+		del = blk;
+		blk = blk->next;
+		free(del);
+	}
+	if(rec->rule != NULL)
+		es_deleteStr(rec->rule);
+	free(rec->fields);
+	free(rec);
+}
+
+
+void
+ln_recordReset(ln_record *rec)
+{
+	int i;
+
+	for(i = 0 ; i < rec->nfields ; ++i) {
+		if(rec->fields[i].json != NULL)
+			json_object_put(rec->fields[i].json);
+	}
+	rec->nfields = 0;
+	rec->endNode = NULL;
+	rec->parsedTo = 0;
+	rec->budgetExceeded = 0;
+	rec->arena_curr = rec->arena;
+	rec->arena_used = 0;
+	if(rec->rule != NULL)
+		es_emptyStr(rec->rule);
+}
+
+
+/* copy a string into the arena, returns NULL if out of memory. Blocks
+ * after the current one are not used by this record yet, so they are
+ * reused before a new block is appended. The current block is never
+ * rewound, as it holds strings of this record.
+ */
+static char *
+arenaStrdup(ln_record *const rec, const char *const str)
+{
+	const size_t len = strlen(str) + 1;
+	struct ln_arena_blk *blk = rec->arena_curr;
+	char *p;
+
+	if(blk == NULL || rec->arena_used + len > blk->size) {
+		struct ln_arena_blk **link = (blk == NULL) ? &rec->arena : &blk->next;
+		while(*link != NULL && len > (*link)->size)
+			link = &(*link)->next;
+		if(*link == NULL) {
+			const size_t size = (len > ARENA_BLKSIZE) ? len : ARENA_BLKSIZE;
+			struct ln_arena_blk *const nblk = malloc(sizeof(struct ln_arena_blk) + size);
+			if(nblk == NULL)
+				return NULL;
+			nblk->size = size;
+			nblk->next = NULL;
+			*link = nblk;
+		}
+		blk = *link;
+		rec->arena_curr = blk;
+		rec->arena_used = 0;
+	}
+	p = blk->data + rec->arena_used;
+	memcpy(p, str, len);
+	rec->arena_used += len;
+	return p;
+}
+
+
+static struct ln_recfield *
+newField(ln_record *const rec)
+{
+	if(rec->nfields == rec->maxfields) {
+		const int newmax = (rec->maxfields == 0) ? RECORD_INIT_FIELDS : 2 * rec->maxfields;
+		struct ln_recfield *const newfields =
+			realloc(rec->fields, newmax * sizeof(struct ln_recfield));
+		if(newfields == NULL)
+			return NULL;
+		rec->fields = newfields;
+		rec->maxfields = newmax;
+	}
+	return rec->fields + rec->nfields++;
+}
+
+
+int
+ln_recordAddSpan(ln_record *rec, const char *name, const char *str, size_t len)
+{
+	struct ln_recfield *const f = newField(rec);
+
+	if(f == NULL)
+		return LN_NOMEM;
+	f->name = name;
+	f->json = NULL;
+	f->str = str;
+	f->len = len;
+	f->type = LN_FIELD_STRING;
+	f->merged = MERGED_NO;
+	return 0;
+}
+
+
+/* fill field from a json value; the field takes over the reference */
+static void
+setFieldValue(struct ln_recfield *const f, struct json_object *const value)
+{
+	f->json = value;
+	f->str = NULL;
+	f->len = 0;
+	switch(json_object_get_type(value)) {
+	case json_type_string:
+		f->type = LN_FIELD_STRING;
+		f->str = json_object_get_string(value);
+		f->len = json_object_get_string_len(value);
+		break;
+	case json_type_int:
+		f->type = LN_FIELD_INT;
+		f->num.i = json_object_get_int64(value);
+		break;
+	case json_type_double:
+		f->type = LN_FIELD_DOUBLE;
+		f->num.d = json_object_get_double(value);
+		break;
+	case json_type_boolean:
+		f->type = LN_FIELD_BOOL;
+		f->num.i = json_object_get_boolean(value);
+		break;
+	case json_type_null:
+	case json_type_object:
+	case json_type_array:
+	default:
+		f->type = LN_FIELD_JSON;
+		break;
+	}
+}
+
+
+/* Add all members of an object as individual fields. As the whole
+ * field array is reversed by ln_recordFinish(), members are added in
+ * reverse order here. Member names are owned by the object, so they
+ * must be copied.
+ */
+static int
+addMembers(ln_record *const rec, struct json_object *const value)
+{
+	int r = 0;
+	const int first = rec->nfields;
+	struct json_object_iterator it = json_object_iter_begin(value);
+	struct json_object_iterator itEnd = json_object_iter_end(value);
+
+	while(!json_object_iter_equal(&it, &itEnd)) {
+		struct json_object *const val = json_object_iter_peek_value(&it);
+		struct ln_recfield *f;
+		const char *name;
+		CHKN(name = arenaStrdup(rec, json_object_iter_peek_name(&it)));
+		CHKN(f = newField(rec));
+		f->name = name;
+		f->merged = MERGED_NEXT;
+		setFieldValue(f, json_object_get(val));
+		json_object_iter_next(&it);
+	}
+	if(rec->nfields > first) {
+		struct ln_recfield *lo = rec->fields + first;
+		struct ln_recfield *hi = rec->fields + rec->nfields - 1;
+		lo->merged = MERGED_FIRST;
+		while(lo < hi) {
+			const struct ln_recfield tmp = *lo;
+			*lo++ = *hi;
+			*hi-- = tmp;
+		}
+	}
+done:
+	return r;
+}
+
+
+int
+ln_recordAddValue(ln_record *rec, const ln_parser_t *prs, struct json_object *value)
+{
+	int r = 0;
+	struct json_object *valDotDot;
+	struct ln_recfield *f;
+
+	switch(prs->mergeMode) {
+	case PRS_MERGE_DISCARD:
+		goto done;
+	case PRS_MERGE_DOT:
+		if(json_object_get_type(value) == json_type_object) {
+			r = addMembers(rec, value);
+			goto done;
+		}
+		break;
+	case PRS_MERGE_DOTDOT:
+		if(json_object_get_type(value) == json_type_object
+		   && json_object_object_length(value) == 1
+		   && json_object_object_get_ex(value, "..", &valDotDot)) {
+			json_object_get(valDotDot);
+			json_object_put(value);
+			value = valDotDot;
+		}
+		break;
+	default:
+		break;
+	}
+
+	CHKN(f = newField(rec));
+	f->name = prs->name;
+	f->merged = MERGED_NO;
+	setFieldValue(f, value);
+	value = NULL;
+
+done:
+	if(value != NULL)
+		json_object_put(value);
+	return r;
+}
+
+
+void
+ln_recordFinish(ln_record *rec)
+{
+	struct ln_recfield *lo, *hi;
+
+	if(rec->nfields < 2)
+		return;
+	lo = rec->fields;
+	hi = rec->fields + rec->nfields - 1;
+	while(lo < hi) {
+		const struct ln_recfield tmp = *lo;
+		*lo++ = *hi;
+		*hi-- = tmp;
+	}
+}
+
+
+/* Fields are added in the order ln_normalize() adds them, that is
+ * last field first. Only members of merged objects are added in their
+ * original order.
+ */
+int
+ln_recordFieldsToJSON(const ln_record *rec, struct json_object *json)
+{
+	int r = 0;
+	int i, j;
+	struct json_object *value;
+
+	for(i = rec->nfields - 1 ; i >= 0 ; --i) {
+		const struct ln_recfield *const f = rec->fields + i;
+		if(f->merged == MERGED_NO) {
+			if(f->json == NULL) {
+				CHKN(value = json_object_new_string_len(f->str, f->len));
+			} else {
+				value = json_object_get(f->json);
+			}
+			json_object_object_add_ex(json, f->name, value,
+				JSON_C_OBJECT_ADD_KEY_IS_NEW|JSON_C_OBJECT_KEY_IS_CONSTANT);
+			continue;
+		}
+		for(j = i ; rec->fields[j].merged != MERGED_FIRST ; --j)
+			/* just search */;
+		for(i = j ; rec->fields + i <= f ; ++i) {
+			json_object_object_add(json, rec->fields[i].name,
+				json_object_get(rec->fields[i].json));
+		}
+		i = j;
+	}
+done:
+	return r;
+}
+
+
+int
+ln_recordMatched(const ln_record *rec)
+{
+	return rec->endNode != NULL;
+}
+
+
+size_t
+ln_recordParsedTo(const ln_record *rec)
+{
+	return rec->parsedTo;
+}
+
+
+int
+ln_recordBudgetExceeded(const ln_record *rec)
+{
+	return rec->budgetExceeded;
+}
+
+
+const char *
+ln_recordRuleID(const ln_record *rec)
+{
+	return (rec->endNode == NULL) ? NULL : rec->endNode->rb_id;
+}
+
+unsigned
+ln_recordRuleNum(const ln_record *rec)
+{
+	return (rec->endNode == NULL) ? 0 : rec->endNode->rule_id;
+}
+
+
+int
+ln_recordNumTags(const ln_record *rec)
+{
+	if(rec->endNode == NULL || rec->endNode->tags == NULL)
+		return 0;
+	return json_object_array_length(rec->endNode->tags);
+}
+
+
+const char *
+ln_recordTag(const ln_record *rec, int i)
+{
+	return json_object_get_string(json_object_array_get_idx(rec->endNode->tags, i));
+}
+
+
+int
+ln_recordNumFields(const ln_record *rec)
+{
+	return rec->nfields;
+}
+
+
+const char *
+ln_recordFieldName(const ln_record *rec, int i)
+{
+	return rec->fields[i].name;
+}
+
+
+int
+ln_recordFieldType(const ln_record *rec, int i)
+{
+	return rec->fields[i].type;
+}
+
+
+const char *
+ln_recordFieldStr(const ln_record *rec, int i, size_t *len)
+{
+	const struct ln_recfield *const f = rec->fields + i;
+
+	if(f->type != LN_FIELD_STRING)
+		return NULL;
+	*len = f->len;
+	return f->str;
+}
+
+
+long long
+ln_recordFieldInt(const ln_record *rec, int i)
+{
+	return rec->fields[i].num.i;
+}
+
+
+double
+ln_recordFieldDouble(const ln_record *rec, int i)
+{
+	return rec->fields[i].num.d;
+}
+
+
+struct json_object *
+ln_recordFieldJSON(const ln_record *rec, int i)
+{
+	return rec->fields[i].json;
+}
+
+
+/* Record cache for ln_normalizeCB(). Like the JSON tokenizer, we keep
+ * one record per thread, so that its memory is reused. It is freed
+ * when the thread terminates, the key when the library is unloaded.
+ */
+static pthread_key_t record_key;
+static pthread_once_t record_key_once = PTHREAD_ONCE_INIT;
+static int record_key_created = 0;
+
+static void
+recordDestruct(void *const rec)
+{
+	ln_deleteRecord((ln_record*) rec);
+}
+
+static void
+recordKeyCreate(void)
+{
+	record_key_created = (pthread_key_create(&record_key, recordDestruct) == 0);
+}
+
+/* only the record of the unloading thread can be freed here */
+static void __attribute__((destructor))
+recordKeyDelete(void)
+{
+	ln_record *rec;
+
+	if(!record_key_created)
+		return;
+	if((rec = pthread_getspecific(record_key)) != NULL)
+		ln_deleteRecord(rec);
+	pthread_key_delete(record_key);
+}
+
+/* obtain this thread's record.
+ * @return record or NULL on out of memory
+ */
+static ln_record *
+getThreadRecord(void)
+{
+	ln_record *rec;
+
+	pthread_once(&record_key_once, recordKeyCreate);
+	rec = pthread_getspecific(record_key);
+	if(rec == NULL) {
+		if((rec = ln_newRecord()) == NULL)
+			goto done;
+		pthread_setspecific(record_key, rec);
+	}
+done:
+	return rec;
+}
+
+
+static void
+reportField(const struct ln_callbacks *const cb, void *const cookie,
+	const struct ln_recfield *const f)
+{
+	switch(f->type) {
+	case LN_FIELD_STRING:
+		cb->on_field(cookie, f->name, f->type, f->str, f->len);
+		break;
+	case LN_FIELD_INT:
+	case LN_FIELD_BOOL:
+		cb->on_field(cookie, f->name, f->type, &f->num.i, sizeof(f->num.i));
+		break;
+	case LN_FIELD_DOUBLE:
+		cb->on_field(cookie, f->name, f->type, &f->num.d, sizeof(f->num.d));
+		break;
+	default:
+		cb->on_field(cookie, f->name, f->type, f->json, 0);
+		break;
+	}
+}
+
+
+int
+ln_normalizeCB(ln_ctx ctx, const char *str, const size_t strLen,
+	const struct ln_callbacks *cb, void *cookie)
+{
+	int r;
+	int i;
+	ln_record *rec;
+
+	CHKN(rec = getThreadRecord());
+	CHKR(ln_normalizeRecord(ctx, str, strLen, rec));
+
+	struct ln_pdag *const endNode = rec->endNode;
+	if(endNode == NULL) {
+		if(cb->on_unparsed != NULL)
+			cb->on_unparsed(cookie, rec->parsedTo);
+		goto finalize;
+	}
+
+	if(cb->on_rule != NULL)
+		cb->on_rule(cookie, endNode->rb_id, endNode->rule_id);
+	if(cb->on_tag != NULL) {
+		const int ntags = ln_recordNumTags(rec);
+		for(i = 0 ; i < ntags ; ++i)
+			cb->on_tag(cookie, ln_recordTag(rec, i));
+	}
+	if(cb->on_field != NULL) {
+		for(i = 0 ; i < rec->nfields ; ++i)
+			reportField(cb, cookie, rec->fields + i);
+		for(i = 0 ; i < endNode->nannots ; ++i) {
+			/* temporary slot, borrows the annotation's value */
+			struct ln_recfield f;
+			setFieldValue(&f, endNode->annots[i].value);
+			f.name = endNode->annots[i].name;
+			reportField(cb, cookie, &f);
+		}
+	}
+
+finalize:
+	/* do not hold values (and the message) until the next call */
+	ln_recordReset(rec);
+done:
+	return r;
+}
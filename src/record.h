@@ -0,0 +1,119 @@
+/**
+ * @file record.h
+ * @brief Flat normalization result (internal interface)
+ * @class ln_record record.h
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#ifndef LIBLOGNORM_RECORD_H_INCLUDED
+#define	LIBLOGNORM_RECORD_H_INCLUDED
+#include <stdint.h>
+#include <libestr.h>
+#include "liblognorm.h"
+#include "pdag.h"
+
+/**
+ * A field slot. Strings taken from the message are referenced via
+ * str/len, without a json value. All other values keep their json
+ * value, which is released when the record is reused.
+ */
+struct ln_recfield {
+	const char *name;
+	struct json_object *json;	/**< converted value, NULL if str references the message */
+	const char *str;		/**< LN_FIELD_STRING value (not NUL-terminated) */
+	size_t len;
+	union {
+		long long i;		/**< LN_FIELD_INT, LN_FIELD_BOOL */
+		double d;		/**< LN_FIELD_DOUBLE */
+	} num;
+	uint8_t type;			/**< LN_FIELD_* */
+	uint8_t merged;			/**< member of an object merged via name "." */
+};
+
+/**
+ * Memory block for data that must be copied, like member names of
+ * merged objects. Blocks are kept when the record is reused.
+ */
+struct ln_arena_blk {
+	struct ln_arena_blk *next;
+	size_t size;
+	char data[];
+};
+
+struct ln_record_s {
+	ln_ctx ctx;			/**< context of last normalization */
+	const char *str;		/**< message (referenced, not copied) */
+	size_t strLen;
+	size_t parsedTo;
+	int budgetExceeded;		/**< LN_BUDGET_* if aborted, else 0 */
+	struct ln_pdag *endNode;	/**< matching terminal node, NULL if none */
+	es_str_t *rule;			/**< mock-up parts of nested parsers, see npb */
+	struct ln_recfield *fields;
+	int nfields;
+	int maxfields;
+	struct ln_arena_blk *arena;	/**< first arena block */
+	struct ln_arena_blk *arena_curr; /**< block currently allocated from */
+	size_t arena_used;		/**< bytes used in arena_curr */
+};
+
+/* Methods used by the normalizer */
+
+/**
+ * Discard the current result. Memory is kept for the next message,
+ * only converted json values are released.
+ * @memberof ln_record
+ */
+void ln_recordReset(ln_record *rec);
+
+/**
+ * Add a string field which references the message.
+ * @memberof ln_record
+ *
+ * @return 0 on success, something else otherwise
+ */
+int ln_recordAddSpan(ln_record *rec, const char *name, const char *str, size_t len);
+
+/**
+ * Add the value of a parser, honoring its merge mode. Ownership of
+ * value is passed to the record, also in case of error.
+ * @memberof ln_record
+ *
+ * @return 0 on success, something else otherwise
+ */
+int ln_recordAddValue(ln_record *rec, const ln_parser_t *prs, struct json_object *value);
+
+/**
+ * Finalize the field array after normalization. Fields are added
+ * while the normalizer walks the path back upwards, so they are
+ * brought into message order here.
+ * @memberof ln_record
+ */
+void ln_recordFinish(ln_record *rec);
+
+/**
+ * Add all fields to a json object, the same way ln_normalize() does.
+ * @memberof ln_record
+ *
+ * @return 0 on success, something else otherwise
+ */
+int ln_recordFieldsToJSON(const ln_record *rec, struct json_object *json);
+
+#endif /* #ifndef LIBLOGNORM_RECORD_H_INCLUDED */
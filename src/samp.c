@@ -332,6 +332,51 @@ done:
 }
 
 
+/**
+ * Assign a rule id to a terminal and record it in the context's id map.
+ * A duplicate explicit id is reported, but kept as the user asked for
+ * it. A derived id that collides with one already in use is reported
+ * and replaced by probing for the next free derived id, so the outcome
+ * only depends on the rule base order.
+ */
+static int
+assignRuleID(ln_ctx ctx, ln_pdag *const dag, unsigned ruleID)
+{
+	int r = -1;
+	char key[16];
+	char where[1024];
+	struct json_object *prev;
+
+	if(ctx->ruleIDs == NULL)
+		CHKN(ctx->ruleIDs = json_object_new_object());
+	snprintf(key, sizeof(key), "%u", ruleID);
+	if(json_object_object_get_ex(ctx->ruleIDs, key, &prev)) {
+		if(ruleID <= LN_RULEID_MAX_EXPLICIT) {
+			ln_errprintf(ctx, 0, "rule id %u is already used by the rule at %s",
+				ruleID, json_object_get_string(prev));
+		} else {
+			const unsigned derived = ruleID;
+			do {
+				ruleID = (ruleID == 0xffffffffu) ? LN_RULEID_MAX_EXPLICIT + 1 : ruleID + 1;
+				snprintf(key, sizeof(key), "%u", ruleID);
+			} while(json_object_object_get_ex(ctx->ruleIDs, key, NULL));
+			ln_errprintf(ctx, 0, "derived rule id %u collides with the rule at %s, "
+				"using %u instead", derived, json_object_get_string(prev), ruleID);
+		}
+	}
+	snprintf(where, sizeof(where), "%s:%d", ctx->conf_file, ctx->conf_ln_nbr);
+	if(!json_object_object_get_ex(ctx->ruleIDs, key, NULL)) {
+		struct json_object *const val = json_object_new_string(where);
+		CHKN(val);
+		json_object_object_add(ctx->ruleIDs, key, val);
+	}
+	dag->rule_id = ruleID;
+	r = 0;
+done:
+	return r;
+}
+
+
 /* Implementation note:
  * We read in the sample, and split it into chunks of literal text and
  * fields. Each literal text is added as whole to the tree, as is each
@@ -350,7 +395,8 @@ static int
 addSampToTree(ln_ctx ctx,
 	es_str_t *rule,
 	ln_pdag *dag,
-	struct json_object *tagBucket)
+	struct json_object *tagBucket,
+	const unsigned ruleID)
 {
 	int r = -1;
 	es_str_t *str = NULL;
@@ -377,6 +423,15 @@ addSampToTree(ln_ctx ctx,
 	dag->tags = tagBucket;
 	dag->rb_file = strdup(ctx->conf_file);
 	dag->rb_lineno = ctx->conf_ln_nbr;
+	if(dag->rule_id == 0) {
+		if(ruleID != 0)
+			CHKR(assignRuleID(ctx, dag, ruleID));
+	} else if(dag->rule_id != ruleID
+		  && (ruleID <= LN_RULEID_MAX_EXPLICIT || dag->rule_id <= LN_RULEID_MAX_EXPLICIT)) {
+		ln_errprintf(ctx, 0, "rule has the same match description as "
+			"rule id %u, keeping that id instead of %u",
+			dag->rule_id, ruleID);
+	}
 
 done:
 	if(str != NULL)
@@ -487,6 +542,70 @@ done:	return r;
 }
 
 
+/**
+ * Check if a tag list entry is an explicit rule id ("id=<number>")
+ * and, if so, obtain it. Helper to processTags.
+ * @param[in] ctx current context
+ * @param[in] entry tag list entry
+ * @param[out] ruleID the rule id, if the entry is one
+ * Entries that are not a valid id are regular tags.
+ * @returns 1 if entry is a rule id, 0 if it is a regular tag
+ */
+static int
+getRuleIDEntry(ln_ctx ctx, es_str_t *entry, unsigned *ruleID)
+{
+	const char *const buf = (const char*) es_getBufAddr(entry);
+	const es_size_t len = es_strlen(entry);
+	unsigned long long id = 0;
+	es_size_t i;
+
+	if(len < 3 || strncmp(buf, "id=", 3))
+		return 0;
+	for(i = 3 ; i < len && isdigit(buf[i]) && id <= LN_RULEID_MAX_EXPLICIT ; ++i)
+		id = id * 10 + (buf[i] - '0');
+	if(i == 3 || i < len)
+		return 0; /* not a number, so a regular tag */
+	if(id == 0 || id > LN_RULEID_MAX_EXPLICIT) {
+		ln_errprintf(ctx, 0, "rule id '%.*s' out of range, must be from 1 to %u; "
+			"using it as a tag", (int) len - 3, buf + 3, LN_RULEID_MAX_EXPLICIT);
+		return 0;
+	}
+	*ruleID = (unsigned) id;
+	return 1;
+}
+
+
+/**
+ * Add a tag list entry: either a tag or the rule id. Helper to processTags.
+ */
+static int
+addTagListEntry(ln_ctx ctx, es_str_t *entry, struct json_object **tagBucket, unsigned *ruleID)
+{
+	if(getRuleIDEntry(ctx, entry, ruleID))
+		return 0;
+	return addTagStrToBucket(ctx, entry, tagBucket);
+}
+
+
+/**
+ * Derive the id of a rule without explicit id from its match description.
+ * This is the 32-bit FNV-1a hash; the top bit is always set, so that
+ * derived ids never collide with explicit ones.
+ */
+static unsigned
+deriveRuleID(es_str_t *rule)
+{
+	const unsigned char *const buf = es_getBufAddr(rule);
+	uint32_t hash = 2166136261u;
+
+	for(es_size_t i = 0 ; i < es_strlen(rule) ; ++i) {
+		hash ^= buf[i];
+		hash *= 16777619u;
+	}
+	return (unsigned) (hash | 0x80000000u);
+}
+
+
 /**
  * Extract the tags and create a tag bucket out of them
  *
@@ -497,10 +616,12 @@ done:	return r;
  *                      offset after tag part (excluding ':')
  * @param[out] tagBucket tagbucket to which new tags shall be added
  *                       the tagbucket is created if it is NULL
+ * @param[out] ruleID explicit rule id, if one is given in the list
  * @returns 0 on success, something else otherwise
  */
 static int
-processTags(ln_ctx ctx, const char *buf, es_size_t lenBuf, es_size_t *poffs, struct json_object **tagBucket)
+processTags(ln_ctx ctx, const char *buf, es_size_t lenBuf, es_size_t *poffs,
+	struct json_object **tagBucket, unsigned *ruleID)
 {
 	int r = -1;
 	es_str_t *str = NULL;
@@ -511,7 +632,7 @@ processTags(ln_ctx ctx, const char *buf, es_size_t lenBuf, es_size_t *poffs, str
 	while(i < lenBuf && buf[i] != ':') {
 		if(buf[i] == ',') {
 			/* end of this tag */
-			CHKR(addTagStrToBucket(ctx, str, tagBucket));
+			CHKR(addTagListEntry(ctx, str, tagBucket, ruleID));
 			es_deleteStr(str);
 			str = NULL;
 		} else {
@@ -528,7 +649,7 @@ processTags(ln_ctx ctx, const char *buf, es_size_t lenBuf, es_size_t *poffs, str
 	++i; /* skip ':' */
 
 	if(str != NULL) {
-		CHKR(addTagStrToBucket(ctx, str, tagBucket));
+		CHKR(addTagListEntry(ctx, str, tagBucket, ruleID));
 		es_deleteStr(str);
 	}
 
@@ -555,9 +676,10 @@ processRule(ln_ctx ctx, const char *buf, es_size_t lenBuf, es_size_t offs)
 	int r = -1;
 	es_str_t *str;
 	struct json_object *tagBucket = NULL;
+	unsigned ruleID = 0;
 
 	ln_dbgprintf(ctx, "rule line to add: '%s'", buf+offs);
-	CHKR(processTags(ctx, buf, lenBuf, &offs, &tagBucket));
+	CHKR(processTags(ctx, buf, lenBuf, &offs, &tagBucket, &ruleID));
 
 	if(offs == lenBuf) {
 		ln_errprintf(ctx, 0, "error: actual message sample part is missing");
@@ -569,7 +691,9 @@ processRule(ln_ctx ctx, const char *buf, es_size_t lenBuf, es_size_t offs)
 		CHKN(str = es_strdup(ctx->rulePrefix));
 	}
 	CHKR(es_addBuf(&str, (char*)buf + offs, lenBuf - offs));
-	addSampToTree(ctx, str, ctx->pdag, tagBucket);
+	if(ruleID == 0)
+		ruleID = deriveRuleID(str);
+	addSampToTree(ctx, str, ctx->pdag, tagBucket, ruleID);
 	es_deleteStr(str);
 	r = 0;
 done:	return r;
@@ -646,7 +770,7 @@ processType(ln_ctx ctx,
 	CHKR(es_addBuf(&str, (char*)buf + offs, lenBuf - offs));
 	struct ln_type_pdag *const td = ln_pdagFindType(ctx, typename, 1);
 	CHKN(td);
-	addSampToTree(ctx, str, td->pdag, NULL);
+	addSampToTree(ctx, str, td->pdag, NULL, 0);
 	es_deleteStr(str);
 	r = 0;
 done:	return r;
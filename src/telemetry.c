@@ -0,0 +1,457 @@
+/**
+ * @file telemetry.c
+ * @brief Implementation of the runtime statistics.
+ *
+ * Counters are kept in a fixed number of shards. Each thread picks a
+ * shard on first use and sticks with it, so with up to LN_TM_NSHARDS
+ * threads no cache line is written by more than one of them. All
+ * updates are relaxed atomic adds, so the counters stay correct even
+ * if more threads share a shard. Readers sum up all shards.
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <json.h>
+
+#include "lognorm.h"
+#include "telemetry.h"
+
+struct ln_telemetry_s {
+	struct ln_tm_shard shards[LN_TM_NSHARDS];
+	struct ln_tm_lat *unparsedLat;	/**< latency of unparsed messages */
+};
+
+static const char *const tm_abortNames[LN_TM_NABORTS] = {
+	"parser_calls", "backtracks", "bytes", "deadline"
+};
+
+static unsigned tm_nextShard = 0;
+static __thread int tm_shardIdx = -1;
+static __thread unsigned tm_sampleCnt = 0;
+
+ln_telemetry*
+ln_newTelemetry(void)
+{
+	void *tm;
+
+	/* calloc() does not guarantee the cache line alignment */
+	if(posix_memalign(&tm, 64, sizeof(struct ln_telemetry_s)) != 0)
+		return NULL;
+	memset(tm, 0, sizeof(struct ln_telemetry_s));
+	return tm;
+}
+
+void
+ln_deleteTelemetry(ln_telemetry *const tm)
+{
+	if(tm != NULL)
+		free(tm->unparsedLat);
+	free(tm);
+}
+
+struct ln_tm_shard*
+ln_tmShard(ln_telemetry *const tm)
+{
+	if(tm_shardIdx == -1) {
+		tm_shardIdx = __atomic_fetch_add(&tm_nextShard, 1, __ATOMIC_RELAXED)
+			% LN_TM_NSHARDS;
+	}
+	return &tm->shards[tm_shardIdx];
+}
+
+static void
+histAdd(struct ln_tm_hist *const hist, const int val)
+{
+	ln_tmAdd(&hist->cnt[(val < LN_TM_HIST_SIZE) ? val : LN_TM_HIST_SIZE - 1], 1);
+	uint64_t max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+	while((uint64_t) val > max
+	      && !__atomic_compare_exchange_n(&hist->max, &max, val, 1,
+			__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		; /* max was updated by someone else, re-check */
+}
+
+void
+ln_tmAddMsg(struct ln_tm_shard *const shard, const struct ln_tm_msg *const msg,
+	const int parsed)
+{
+	ln_tmAdd(&shard->msgs, 1);
+	if(parsed)
+		ln_tmAdd(&shard->parsed, 1);
+	if(msg->aborted > 0 && msg->aborted <= LN_TM_NABORTS)
+		ln_tmAdd(&shard->aborted[msg->aborted - 1], 1);
+	histAdd(&shard->pathlen, msg->pathlen);
+	histAdd(&shard->backtracked, msg->backtracked);
+	histAdd(&shard->parser_calls, msg->parser_calls);
+	histAdd(&shard->lit_parser_calls, msg->lit_parser_calls);
+}
+
+static inline uint64_t
+fetch(uint64_t *const counter, const int reset)
+{
+	return reset ? __atomic_exchange_n(counter, 0, __ATOMIC_RELAXED)
+		     : __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+static void
+addCounter(struct json_object *const json, const char *const name, const uint64_t val)
+{
+	json_object_object_add(json, name, json_object_new_int64(val));
+}
+
+const char*
+ln_tmAbortName(const int reason)
+{
+	return (reason > 0 && reason <= LN_TM_NABORTS) ? tm_abortNames[reason - 1] : "none";
+}
+
+int
+ln_tmSampleNow(const unsigned every)
+{
+	if(every == 0 || ++tm_sampleCnt < every)
+		return 0;
+	tm_sampleCnt = 0;
+	return 1;
+}
+
+static int
+latBucket(const uint64_t ns)
+{
+	if(ns < LN_TM_LAT_SUB)
+		return (int) ns;
+	const int exp = 63 - __builtin_clzll(ns);
+	if(exp > LN_TM_LAT_MAXEXP)
+		return LN_TM_LAT_BUCKETS - 1;
+	const int sub = (int) (ns >> (exp - LN_TM_LAT_SUBBITS)) & (LN_TM_LAT_SUB - 1);
+	return (exp - LN_TM_LAT_SUBBITS + 1) * LN_TM_LAT_SUB + sub;
+}
+
+/* largest value that falls into bucket b */
+static uint64_t
+latBucketMax(const int b)
+{
+	if(b < LN_TM_LAT_SUB)
+		return b;
+	const int exp = b / LN_TM_LAT_SUB + LN_TM_LAT_SUBBITS - 1;
+	const uint64_t sub = b % LN_TM_LAT_SUB;
+	return ((LN_TM_LAT_SUB + sub + 1) << (exp - LN_TM_LAT_SUBBITS)) - 1;
+}
+
+void
+ln_tmLatAdd(struct ln_tm_lat **const plat, const uint64_t ns)
+{
+	struct ln_tm_lat *lat = __atomic_load_n(plat, __ATOMIC_ACQUIRE);
+
+	if(lat == NULL) {
+		struct ln_tm_lat *const newLat = calloc(1, sizeof(struct ln_tm_lat));
+		if(newLat == NULL)
+			return; /* sample is lost, but that does not hurt */
+		if(__atomic_compare_exchange_n(plat, &lat, newLat, 0,
+				__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			lat = newLat;
+		} else {
+			free(newLat); /* someone else was faster, lat is theirs */
+		}
+	}
+	ln_tmAdd(&lat->cnt[latBucket(ns)], 1);
+	uint64_t max = __atomic_load_n(&lat->max, __ATOMIC_RELAXED);
+	while(ns > max
+	      && !__atomic_compare_exchange_n(&lat->max, &max, ns, 1,
+			__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		; /* max was updated by someone else, re-check */
+}
+
+struct ln_tm_lat**
+ln_tmUnparsedLat(ln_telemetry *const tm)
+{
+	return &tm->unparsedLat;
+}
+
+static uint64_t
+latPercentile(const uint64_t *const cnt, const uint64_t samples,
+	const uint64_t max, const int percent)
+{
+	const uint64_t rank = (samples * percent + 99) / 100;
+	uint64_t seen = 0;
+
+	for(int b = 0 ; b < LN_TM_LAT_BUCKETS ; ++b) {
+		seen += cnt[b];
+		if(seen >= rank) {
+			const uint64_t val = latBucketMax(b);
+			return (val < max) ? val : max;
+		}
+	}
+	return max;
+}
+
+void
+ln_tmLatSum(struct ln_tm_lat *const lat, struct ln_tm_latsum *const sum, const int reset)
+{
+	uint64_t cnt[LN_TM_LAT_BUCKETS];
+
+	memset(sum, 0, sizeof(*sum));
+	if(lat == NULL)
+		return;
+	for(int b = 0 ; b < LN_TM_LAT_BUCKETS ; ++b) {
+		cnt[b] = fetch(&lat->cnt[b], reset);
+		sum->samples += cnt[b];
+	}
+	sum->max = fetch(&lat->max, reset);
+	if(sum->samples == 0)
+		return;
+	sum->p50 = latPercentile(cnt, sum->samples, sum->max, 50);
+	sum->p99 = latPercentile(cnt, sum->samples, sum->max, 99);
+}
+
+struct json_object*
+ln_tmLatToJSON(const struct ln_tm_latsum *const sum)
+{
+	struct json_object *json;
+
+	if((json = json_object_new_object()) == NULL)
+		return NULL;
+	addCounter(json, "samples", sum->samples);
+	addCounter(json, "p50_ns", sum->p50);
+	addCounter(json, "p99_ns", sum->p99);
+	addCounter(json, "max_ns", sum->max);
+	return json;
+}
+
+static void
+histSum(struct ln_tm_hist *const hist, struct ln_tm_hist *const sum, const int reset)
+{
+	for(int i = 0 ; i < LN_TM_HIST_SIZE ; ++i)
+		sum->cnt[i] += fetch(&hist->cnt[i], reset);
+	const uint64_t max = fetch(&hist->max, reset);
+	if(max > sum->max)
+		sum->max = max;
+}
+
+void
+ln_tmSum(ln_telemetry *const tm, struct ln_tm_shard *const sum, const int reset)
+{
+	memset(sum, 0, sizeof(*sum));
+	for(int s = 0 ; s < LN_TM_NSHARDS ; ++s) {
+		struct ln_tm_shard *const shard = &tm->shards[s];
+		sum->msgs += fetch(&shard->msgs, reset);
+		sum->parsed += fetch(&shard->parsed, reset);
+		sum->parsers_called += fetch(&shard->parsers_called, reset);
+		sum->parsers_success += fetch(&shard->parsers_success, reset);
+		sum->tscache_lookups += fetch(&shard->tscache_lookups, reset);
+		sum->tscache_hits += fetch(&shard->tscache_hits, reset);
+		for(int i = 0 ; i < LN_TM_NABORTS ; ++i)
+			sum->aborted[i] += fetch(&shard->aborted[i], reset);
+		histSum(&shard->pathlen, &sum->pathlen, reset);
+		histSum(&shard->backtracked, &sum->backtracked, reset);
+		histSum(&shard->parser_calls, &sum->parser_calls, reset);
+		histSum(&shard->lit_parser_calls, &sum->lit_parser_calls, reset);
+		for(int i = 0 ; i < LN_TM_MAX_PARSERS ; ++i) {
+			sum->prs_called[i] += fetch(&shard->prs_called[i], reset);
+			sum->prs_success[i] += fetch(&shard->prs_success[i], reset);
+		}
+	}
+}
+
+/* histogram as { "max": n, "counts": { "<value>": n, ... } },
+ * values that never occurred are not included.
+ */
+static struct json_object *
+histToJSON(const struct ln_tm_hist *const hist)
+{
+	struct json_object *json;
+	struct json_object *counts;
+	char key[16];
+
+	if((json = json_object_new_object()) == NULL)
+		return NULL;
+	json_object_object_add(json, "max", json_object_new_int64(hist->max));
+	if((counts = json_object_new_object()) == NULL)
+		goto fail;
+	json_object_object_add(json, "counts", counts);
+	for(int i = 0 ; i < LN_TM_HIST_SIZE ; ++i) {
+		if(hist->cnt[i] > 0) {
+			snprintf(key, sizeof(key), "%d", i);
+			json_object_object_add(counts, key, json_object_new_int64(hist->cnt[i]));
+		}
+	}
+	return json;
+fail:
+	json_object_put(json);
+	return NULL;
+}
+
+struct json_object*
+ln_tmToJSON(const struct ln_tm_shard *const sum)
+{
+	struct json_object *json;
+	struct json_object *sub;
+	struct json_object *prs;
+
+	if((json = json_object_new_object()) == NULL)
+		goto fail;
+	addCounter(json, "messages", sum->msgs);
+	addCounter(json, "parsed", sum->parsed);
+	addCounter(json, "unparsed", sum->msgs - sum->parsed);
+
+	if((sub = json_object_new_object()) == NULL)
+		goto fail;
+	json_object_object_add(json, "parser_calls", sub);
+	addCounter(sub, "total", sum->parsers_called);
+	addCounter(sub, "success", sum->parsers_success);
+
+	if((sub = json_object_new_object()) == NULL)
+		goto fail;
+	json_object_object_add(json, "parsers", sub);
+	for(int i = 0 ; i < LN_TM_MAX_PARSERS ; ++i) {
+		if(sum->prs_called[i] == 0)
+			continue;
+		if((prs = json_object_new_object()) == NULL)
+			goto fail;
+		json_object_object_add(sub, ln_parserIDName(i), prs);
+		addCounter(prs, "called", sum->prs_called[i]);
+		addCounter(prs, "success", sum->prs_success[i]);
+	}
+
+	if((sub = json_object_new_object()) == NULL)
+		goto fail;
+	json_object_object_add(json, "tscache", sub);
+	addCounter(sub, "lookups", sum->tscache_lookups);
+	addCounter(sub, "hits", sum->tscache_hits);
+
+	if((sub = json_object_new_object()) == NULL)
+		goto fail;
+	json_object_object_add(json, "budget_exceeded", sub);
+	for(int i = 0 ; i < LN_TM_NABORTS ; ++i)
+		addCounter(sub, ln_tmAbortName(i + 1), sum->aborted[i]);
+
+	if((sub = json_object_new_object()) == NULL)
+		goto fail;
+	json_object_object_add(json, "histograms", sub);
+	json_object_object_add(sub, "path_length", histToJSON(&sum->pathlen));
+	json_object_object_add(sub, "backtracked", histToJSON(&sum->backtracked));
+	json_object_object_add(sub, "parser_calls", histToJSON(&sum->parser_calls));
+	json_object_object_add(sub, "literal_parser_calls", histToJSON(&sum->lit_parser_calls));
+	return json;
+
+fail:
+	json_object_put(json);
+	return NULL;
+}
+
+static void
+histPrint(const struct ln_tm_hist *const hist, const char *const title, FILE *const fp)
+{
+	uint64_t total_len = 0;
+	uint64_t total_cnt = 0;
+
+	fprintf(fp, "%s\n", title);
+	for(int i = 0 ; i < LN_TM_HIST_SIZE ; ++i) {
+		if(hist->cnt[i] > 0) {
+			fprintf(fp, "%3d%s %" PRIu64 "\n", i,
+				(i == LN_TM_HIST_SIZE - 1) ? "+:" : ":", hist->cnt[i]);
+			total_len += i * hist->cnt[i];
+			total_cnt += hist->cnt[i];
+		}
+	}
+	fprintf(fp, "avg: %f\n", total_cnt == 0 ? 0.0 : (double) total_len / (double) total_cnt);
+	fprintf(fp, "max: %" PRIu64 "\n", hist->max);
+	fprintf(fp, "\n");
+}
+
+void
+ln_tmPrint(const struct ln_tm_shard *const sum, FILE *const fp)
+{
+	const uint64_t parsers_failed = sum->parsers_called - sum->parsers_success;
+	fprintf(fp, "\n"
+		    "Runtime Telemetry\n"
+	            "=================\n");
+	fprintf(fp, "These are actual number from analyzing the control flow "
+		    "at runtime.\n");
+	fprintf(fp, "Note that literal matching is also done via parsers. As such, \n"
+		    "it is expected that fail rates increase with the size of the \n"
+		    "rule base.\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "Messages:\n");
+	fprintf(fp, "total....: %10" PRIu64 "\n", sum->msgs);
+	fprintf(fp, "parsed...: %10" PRIu64 "\n", sum->parsed);
+	fprintf(fp, "unparsed.: %10" PRIu64 "\n", sum->msgs - sum->parsed);
+	fprintf(fp, "\n");
+	fprintf(fp, "Parser Calls:\n");
+	fprintf(fp, "total....: %10" PRIu64 "\n", sum->parsers_called);
+	fprintf(fp, "succesful: %10" PRIu64 "\n", sum->parsers_success);
+	fprintf(fp, "failed...: %10" PRIu64 " [%d%%]\n",
+		parsers_failed,
+		sum->parsers_called == 0 ? 0 :
+		(int) ((parsers_failed * 100) / sum->parsers_called) );
+	fprintf(fp, "\nIndividual Parser Calls "
+		    "(never called parsers are not shown):\n");
+	for(int i = 0 ; i < LN_TM_MAX_PARSERS ; ++i) {
+		if(sum->prs_called[i] > 0) {
+			const uint64_t failed = sum->prs_called[i] - sum->prs_success[i];
+			fprintf(fp, "%20s: %10" PRIu64 " [%5.2f%%] "
+				    "success: %10" PRIu64 " [%5.1f%%] "
+				    "fail: %10" PRIu64 " [%5.1f%%]"
+			            "\n",
+				ln_parserIDName(i),
+				sum->prs_called[i],
+				(float)(sum->prs_called[i] * 100)
+				        / sum->parsers_called,
+				sum->prs_success[i],
+				(float)(sum->prs_success[i] * 100)
+				        / sum->prs_called[i],
+				failed,
+				(float)(failed * 100)
+				        / sum->prs_called[i]
+			       );
+		}
+	}
+
+	fprintf(fp, "\nTimestamp Parse Cache (date-rfc3164, date-rfc5424):\n");
+	fprintf(fp, "lookups..: %10" PRIu64 "\n", sum->tscache_lookups);
+	fprintf(fp, "hits.....: %10" PRIu64 " [%d%%]\n",
+		sum->tscache_hits,
+		sum->tscache_lookups == 0 ? 0 :
+		(int) ((sum->tscache_hits * 100) / sum->tscache_lookups) );
+
+	fprintf(fp, "\nWork Budget Exceeded (messages aborted as unparsed):\n");
+	for(int i = 0 ; i < LN_TM_NABORTS ; ++i)
+		fprintf(fp, "%-13s: %10" PRIu64 "\n", ln_tmAbortName(i + 1), sum->aborted[i]);
+
+	fprintf(fp, "\n");
+	fprintf(fp, "\n"
+	            "Path Length Statistics\n"
+	            "----------------------\n"
+	            "The regular path length is the number of nodes being visited,\n"
+		    "where each node potentially evaluates several parsers. The\n"
+		    "parser call statistic is the number of parsers called along\n"
+		    "the path. That number is higher, as multiple parsers may be\n"
+		    "called at each node. The number of literal parser calls is\n"
+		    "given explicitly, as they use almost no time to process.\n"
+		    "\n"
+		);
+	histPrint(&sum->pathlen, "Path Length", fp);
+	histPrint(&sum->backtracked, "Nbr Backtracked", fp);
+	histPrint(&sum->parser_calls, "Parser Calls", fp);
+	histPrint(&sum->lit_parser_calls, "LITERAL Parser Calls", fp);
+}
@@ -0,0 +1,231 @@
+/**
+ * @file telemetry.h
+ * @brief Per-context runtime statistics of the normalizer
+ * @class ln_telemetry telemetry.h
+ *//*
+ * Copyright 2026 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of liblognorm.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#ifndef LIBLOGNORM_TELEMETRY_H_INCLUDED
+#define	LIBLOGNORM_TELEMETRY_H_INCLUDED
+#include <stdio.h>
+#include <stdint.h>
+
+#define LN_TM_NSHARDS 16	/**< threads are spread over this many shards */
+#define LN_TM_HIST_SIZE 100	/**< histogram buckets; the last one also holds larger values */
+#define LN_TM_MAX_PARSERS 64	/**< must be >= number of parsers in lookup table */
+#define LN_TM_NABORTS 4		/**< reasons to abort a message (LN_BUDGET_*) */
+
+/* latency histogram: log-linear, i.e. each power of two is split
+ * into LN_TM_LAT_SUB linear sub-buckets, which bounds the relative
+ * error to 1/LN_TM_LAT_SUB. Values of 2^LN_TM_LAT_MAXEXP ns (about
+ * 68s) and above go to the last bucket.
+ */
+#define LN_TM_LAT_SUBBITS 3
+#define LN_TM_LAT_SUB (1 << LN_TM_LAT_SUBBITS)
+#define LN_TM_LAT_MAXEXP 36
+#define LN_TM_LAT_BUCKETS ((LN_TM_LAT_MAXEXP - LN_TM_LAT_SUBBITS + 2) * LN_TM_LAT_SUB)
+
+struct json_object;
+typedef struct ln_telemetry_s ln_telemetry;
+
+struct ln_tm_hist {
+	uint64_t cnt[LN_TM_HIST_SIZE];
+	uint64_t max;
+};
+
+/**
+ * One shard of counters. Each thread always updates the same shard,
+ * so that threads rarely share cache lines. As multiple threads may
+ * still map to the same shard, all updates are atomic.
+ */
+struct ln_tm_shard {
+	uint64_t msgs;
+	uint64_t parsed;
+	uint64_t parsers_called;
+	uint64_t parsers_success;
+	uint64_t tscache_lookups;
+	uint64_t tscache_hits;
+	uint64_t aborted[LN_TM_NABORTS];	/**< by LN_BUDGET_* reason - 1 */
+	struct ln_tm_hist pathlen;
+	struct ln_tm_hist backtracked;
+	struct ln_tm_hist parser_calls;
+	struct ln_tm_hist lit_parser_calls;
+	uint64_t prs_called[LN_TM_MAX_PARSERS];
+	uint64_t prs_success[LN_TM_MAX_PARSERS];
+} __attribute__((aligned(64)));
+
+struct ln_tm_lat {
+	uint64_t cnt[LN_TM_LAT_BUCKETS];
+	uint64_t max;		/**< exact maximum in ns */
+};
+
+/**
+ * Per-message counters, collected in the npb while normalizing and
+ * added to the shard once the message is done.
+ */
+struct ln_tm_msg {
+	int pathlen;		/**< nodes visited */
+	int backtracked;	/**< times backtracking was initiated */
+	int parser_calls;	/**< parser calls in general during path */
+	int lit_parser_calls;	/**< same just for the literal parser */
+	int aborted;		/**< LN_BUDGET_* if the work budget was exceeded, else 0 */
+};
+
+static inline void
+ln_tmAdd(uint64_t *const counter, const uint64_t n)
+{
+	__atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+}
+
+/**
+ * Obtain the name of an LN_BUDGET_* reason, as used in telemetry and
+ * metadata.
+ * @memberof ln_telemetry
+ */
+const char* ln_tmAbortName(int reason);
+
+
+/**
+ * Allocates and initializes new, all-zero telemetry.
+ * @memberof ln_telemetry
+ *
+ * @return pointer to new object or NULL on error
+ */
+ln_telemetry* ln_newTelemetry(void);
+
+
+/**
+ * Free telemetry.
+ * @memberof ln_telemetry
+ *
+ * @param[in] tm object to free, may be NULL
+ */
+void ln_deleteTelemetry(ln_telemetry *tm);
+
+
+/**
+ * Obtain the shard the calling thread is to update.
+ * @memberof ln_telemetry
+ */
+struct ln_tm_shard* ln_tmShard(ln_telemetry *tm);
+
+
+/**
+ * Add the counters of a completely processed message to a shard.
+ * @memberof ln_telemetry
+ *
+ * @param[in] shard shard to update
+ * @param[in] msg per-message counters
+ * @param[in] parsed 1 if the message matched a rule, 0 otherwise
+ */
+void ln_tmAddMsg(struct ln_tm_shard *shard, const struct ln_tm_msg *msg, int parsed);
+
+
+/**
+ * Check if the calling thread's current message is to be timed.
+ * Every Nth message of each thread is.
+ * @memberof ln_telemetry
+ *
+ * @param[in] every sampling interval N, 0 means no sampling
+ */
+int ln_tmSampleNow(unsigned every);
+
+
+/**
+ * Add a sampled message latency.
+ * @memberof ln_telemetry
+ *
+ * @param[in,out] plat histogram to update. If *plat is NULL, the
+ *                histogram is created. This is thread-safe.
+ * @param[in] ns latency in nanoseconds
+ */
+void ln_tmLatAdd(struct ln_tm_lat **plat, uint64_t ns);
+
+
+/**
+ * Obtain the histogram of unparsed messages.
+ * @memberof ln_telemetry
+ */
+struct ln_tm_lat** ln_tmUnparsedLat(ln_telemetry *tm);
+
+
+/**
+ * Latency summary: number of samples and percentiles in ns. The
+ * percentiles are upper bounds of the respective bucket (but never
+ * above the maximum).
+ */
+struct ln_tm_latsum {
+	uint64_t samples;
+	uint64_t p50;
+	uint64_t p99;
+	uint64_t max;
+};
+
+
+/**
+ * Summarize a latency histogram.
+ * @memberof ln_telemetry
+ *
+ * @param[in] lat histogram, may be NULL (no samples)
+ * @param[out] sum summary
+ * @param[in] reset if non-zero, zero the histogram
+ */
+void ln_tmLatSum(struct ln_tm_lat *lat, struct ln_tm_latsum *sum, int reset);
+
+
+/**
+ * Create json representation of a latency summary.
+ * @memberof ln_telemetry
+ *
+ * @return new json object or NULL on error
+ */
+struct json_object* ln_tmLatToJSON(const struct ln_tm_latsum *sum);
+
+
+/**
+ * Sum up all shards. Counting continues while this runs, so the sum
+ * is not an atomic snapshot, but no increment is lost: with reset,
+ * each counter is read and zeroed in a single atomic operation.
+ * @memberof ln_telemetry
+ *
+ * @param[in] tm telemetry to read
+ * @param[out] sum sum of all shards
+ * @param[in] reset if non-zero, zero the counters
+ */
+void ln_tmSum(ln_telemetry *tm, struct ln_tm_shard *sum, int reset);
+
+
+/**
+ * Create json representation of summed-up counters.
+ * @memberof ln_telemetry
+ *
+ * @return new json object or NULL on error
+ */
+struct json_object* ln_tmToJSON(const struct ln_tm_shard *sum);
+
+
+/**
+ * Print summed-up counters in human-readable form.
+ * @memberof ln_telemetry
+ */
+void ln_tmPrint(const struct ln_tm_shard *sum, FILE *fp);
+
+#endif /* #ifndef LIBLOGNORM_TELEMETRY_H_INCLUDED */
@@ -0,0 +1,32 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks precompiled annotations, including annotations defined
+# after the rules that use them and fields set by multiple tags.
+
+. $srcdir/exec.sh
+
+test_def $0 "annotations on multiple events"
+add_rule 'version=2'
+add_rule 'annotate=A:+a="1"'
+add_rule 'rule=A,B:ab %tag:word%'
+add_rule 'rule=B:b %tag:word%'
+add_rule 'rule=C:c %tag:word%'
+add_rule 'annotate=B:+b="2"'
+add_rule 'annotate=B:+common="from B"'
+add_rule 'annotate=A:+common="from A"'
+add_rule 'annotate=C:+tag="annotated"'
+cat > tmp.in <<'END'
+ab x
+b y
+ab z
+c w
+END
+execute file tmp.in
+assert_line_json_eq 1 '{ "tag": "x", "b": "2", "common": "from A", "a": "1" }'
+assert_line_json_eq 2 '{ "tag": "y", "b": "2", "common": "from B" }'
+assert_line_json_eq 3 '{ "tag": "z", "b": "2", "common": "from A", "a": "1" }'
+assert_line_json_eq 4 '{ "tag": "annotated" }'
+
+rm -f tmp.in
+cleanup_tmp_files
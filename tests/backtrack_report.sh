@@ -0,0 +1,80 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks the backtracking hotspot report
+. $srcdir/exec.sh
+
+test_def $0 "backtracking hotspot report"
+add_rule 'version=2'
+add_rule 'rule=:a %w:word% x'
+add_rule 'rule=:a %n:number% y'
+add_rule 'rule=:c %n:number% 1'
+add_rule 'rule=:c %w:word% 2'
+add_rule 'rule=:d %n:number{"priority":0}% 1'
+add_rule 'rule=:d %n:number% 1 x'
+add_rule 'rule=:d 7 2'
+cat > tmp.in <<'END'
+a 1 y
+a foo x
+a 2 x
+a 3 x
+c 5 2
+d 7 2
+zz
+a 4 z
+END
+$cmd -r tmp.rulebase -e raw -p -B backtrack.out < tmp.in > test.out
+echo "Out:"; cat backtrack.out
+cat > expected.out <<'END'
+Backtracking Hotspots
+=====================
+backtracks...........: 7
+wasted parser calls..: 17
+Top 6 of 6 cases (node, failing parser, matching parser) by wasted parser calls.
+Note: suggested priorities change the matching order. If a message matches via
+both parsers, a different rule may then match it.
+
+#1: 1 backtracks, 5 wasted parser calls
+	node.....: (start)
+	failing..: 'a ' (tmp.rulebase:3)
+	matching.: -
+	suggest..: none, no other parser matched here
+
+#2: 2 backtracks, 4 wasted parser calls
+	node.....: 'a '
+	failing..: %n:number% (tmp.rulebase:3)
+	matching.: %w:word% (tmp.rulebase:2)
+	suggest..: "priority":29999 for %w:word% to try it first
+
+#3: 1 backtracks, 2 wasted parser calls
+	node.....: 'a '
+	failing..: %n:number% (tmp.rulebase:3)
+	matching.: -
+	suggest..: none, no other parser matched here
+
+#4: 1 backtracks, 2 wasted parser calls
+	node.....: 'a '
+	failing..: %w:word% (tmp.rulebase:2)
+	matching.: -
+	suggest..: none, no other parser matched here
+
+#5: 1 backtracks, 2 wasted parser calls
+	node.....: 'c '
+	failing..: %n:number% (tmp.rulebase:4)
+	matching.: %w:word% (tmp.rulebase:5)
+	suggest..: "priority":29999 for %w:word% to try it first
+
+#6: 1 backtracks, 2 wasted parser calls
+	node.....: 'd '
+	failing..: %n:number% (tmp.rulebase:6)
+	matching.: '7 2' (tmp.rulebase:8)
+	suggest..: "priority":30001 for %n:number% to try it last
+END
+if ! cmp -s expected.out backtrack.out; then
+	echo "FAIL: unexpected backtracking report, diff:"
+	diff expected.out backtrack.out
+	exit 1
+fi
+
+rm -f tmp.in backtrack.out expected.out
+cleanup_tmp_files
@@ -0,0 +1,39 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks that the fields reported by the callback API (ln_normalizeCB)
+# are the same as in the events created by ln_normalize.
+export ln_opts='-ouseCallback -T'
+. $srcdir/exec.sh
+
+test_def $0 "callback API"
+add_rule 'version=2'
+add_rule 'type=@pair:%a:number%-%b:number%'
+add_rule 'rule=t1,t2:a %w:word% %n:number{"format":"number"}% %-:word% %s:rest%'
+add_rule 'rule=:p %p:@pair% %.:name-value-list%'
+add_rule 'rule=:m %.:@pair% %ip:ipv4%'
+add_rule 'annotate=t1:+annot="yes"'
+cat > tmp.in <<'END'
+a word 42 skipped the rest
+p 1-2 k1=v1 k2=v2
+m 3-4 10.0.0.1
+a word x unparsed
+END
+execute file tmp.in
+assert_line_json_eq 1 '{ "w": "word", "n": 42, "s": "the rest", "event.tags": [ "t1", "t2" ], "annot": "yes" }'
+assert_line_json_eq 2 '{ "p": { "a": "1", "b": "2" }, "k1": "v1", "k2": "v2" }'
+assert_line_json_eq 3 '{ "a": "3", "b": "4", "ip": "10.0.0.1" }'
+assert_line_json_eq 4 '{ "originalmsg": "a word x unparsed", "unparsed-data": "x unparsed" }'
+
+# the regular API must create the same events
+mv test.out callback.out
+export ln_opts='-T'
+execute file tmp.in
+# json_eq only checks the fields of its first argument, so compare both ways
+for i in 1 2 3 4; do
+	./json_eq "$(sed -n "${i}p" test.out)" "$(sed -n "${i}p" callback.out)"
+	./json_eq "$(sed -n "${i}p" callback.out)" "$(sed -n "${i}p" test.out)"
+done
+
+rm -f tmp.in callback.out
+cleanup_tmp_files
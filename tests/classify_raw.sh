@@ -0,0 +1,37 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# raw output with filters only classifies messages (ln_classify); the
+# same messages must be selected as when fully normalizing them.
+. $srcdir/exec.sh
+
+test_def $0 "classification for raw output"
+add_rule 'version=2'
+add_rule 'type=@pair:%a:number%-%b:number%'
+add_rule 'rule=t1:a %w:word% %p:@pair% %r:repeat{"parser":{"type":"@pair","name":"x"},"while":{"type":"literal","text":","}}%'
+add_rule 'rule=t2:b %kv:name-value-list%'
+cat > tmp.in <<'END'
+a word 1-2 3-4,5-6
+a word 1-2 3-4,5-x
+b k1=v1 k2=v2
+c unknown
+END
+
+$cmd -r tmp.rulebase -e raw -p < tmp.in > test.out
+echo "Out:"; cat test.out
+printf 'a word 1-2 3-4,5-6\nb k1=v1 k2=v2\n' | cmp - test.out
+
+$cmd -r tmp.rulebase -e raw -P < tmp.in > test.out
+echo "Out:"; cat test.out
+printf 'a word 1-2 3-4,5-x\nc unknown\n' | cmp - test.out
+
+$cmd -r tmp.rulebase -e raw -t t2 < tmp.in > test.out 2>/dev/null
+echo "Out:"; cat test.out
+printf 'b k1=v1 k2=v2\n' | cmp - test.out
+
+# addRule needs nested rule mockups, which must not leak
+$cmd -r tmp.rulebase -e raw -p -oaddRule < tmp.in > test.out
+printf 'a word 1-2 3-4,5-6\nb k1=v1 k2=v2\n' | cmp - test.out
+
+rm -f tmp.in
+cleanup_tmp_files
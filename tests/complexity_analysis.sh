@@ -0,0 +1,74 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks the static worst-case complexity analysis
+. $srcdir/exec.sh
+
+test_def $0 "complexity analysis"
+add_rule 'version=2'
+add_rule 'rule=:a %w:word% x'
+add_rule 'rule=:a %n:number% y'
+add_rule 'type=@list:%x:@list% y'
+add_rule 'type=@list:%v:number%'
+add_rule 'rule=:c %l:@list%'
+add_rule 'rule=:d %r:repeat{"parser":{"type":"repeat","name":"y","parser":{"type":"word","name":"a"},"while":{"type":"literal","text":" "}},"while":{"type":"literal","text":","}}%'
+add_rule 'rule=:e %{"type":"alternative","parser":[{"type":"word","name":"a"},{"type":"number","name":"b"}]}% end'
+add_rule 'rule=:f %r:repeat{"parser":{"type":"rest","name":"x"},"while":{"type":"rest"}}%'
+add_rule 'type=@ip:%ip:ipv4%'
+add_rule 'rule=:g %a:@ip% x'
+add_rule 'rule=:g %b:@ip% y'
+rc=0
+$cmd -r tmp.rulebase -A5 > test.out || rc=$?
+if [ $rc -ne 1 ]; then
+	echo "FAIL: problems not signalled by exit code"
+	exit 1
+fi
+echo "Out:"; cat test.out
+cat > expected.out <<'END'
+Rulebase Complexity Analysis
+============================
+worst-case parser calls..: 12 (limit 5)
+problems.................: 3
+warnings.................: 5
+Parser calls are counted per message. Repeat bodies and recursive types are
+counted once; their cost also grows with the message length.
+
+problem: repeat body and while condition can both match empty text, so the repeat may never end, unbounded parser calls
+	node.....: 'f '
+	parser...: %r:repeat% (tmp.rulebase:9)
+
+problem: type re-enters itself at the same offset (left recursion), so parsing never ends, unbounded parser calls
+	cycle....: @list -> @list
+	type.....: @list (tmp.rulebase:4)
+
+problem: worst-case parser calls per message exceed the limit of 5, up to 12 parser calls
+	heaviest.: rule (tmp.rulebase:11)
+END
+head -18 test.out > test.head
+if ! cmp -s expected.out test.head; then
+	echo "FAIL: problems not as expected"
+	diff expected.out test.head
+	exit 1
+fi
+for warning in "alternative branches overlap" "sibling parsers overlap" \
+	       "repeat nested 2 levels deep with permissive body" \
+	       "type @ip is entered 2 times at the same offset"; do
+	if ! grep -q "^warning: $warning" test.out; then
+		echo "FAIL: warning '$warning' missing"
+		exit 1
+	fi
+done
+
+# a rulebase without findings passes the gate
+reset_rules
+add_rule 'version=2'
+add_rule 'rule=:a %w:word% x'
+add_rule 'rule=:b %n:number% y'
+if ! $cmd -r tmp.rulebase -A5 > test.out; then
+	echo "FAIL: clean rulebase did not pass"
+	cat test.out
+	exit 1
+fi
+
+rm -f test.head
+cleanup_tmp_files
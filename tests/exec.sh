@@ -75,6 +75,11 @@ assert_output_json_eq() {
     ./json_eq "$1" "$(cat test.out)"
 }
 
+# compare line $1 of the output with expected json $2
+assert_line_json_eq() {
+    ./json_eq "$2" "$(sed -n "$1p" test.out)"
+}
+
 rulebase_file_name() {
     if [ "x$1" == "x" ]; then
 	echo tmp.rulebase
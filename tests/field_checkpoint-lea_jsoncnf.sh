@@ -10,6 +10,13 @@ add_rule 'rule=:%{"name":"f", "type":"checkpoint-lea"}%'
 execute 'tcp_flags: RST-ACK; src: 192.168.0.1;'
 assert_output_json_eq '{ "f": { "tcp_flags": "RST-ACK", "src": "192.168.0.1" } }'
 
+# an empty list at the end of the message matches
+reset_rules
+add_rule 'version=2'
+add_rule 'rule=:a %{"name":"f", "type":"checkpoint-lea"}%'
+execute 'a '
+assert_output_json_eq '{ "f": null }'
+
 
 cleanup_tmp_files
 
@@ -0,0 +1,22 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks the per-rule result field count reported in the pdag
+# statistics, which is the maximum over all paths to a rule.
+export ln_opts='-Sstats.out'
+. $srcdir/exec.sh
+
+test_def $0 "result field count"
+add_rule 'version=2'
+add_rule 'rule=:x %{"type":"alternative", "parser":[{"name":"a", "type":"number"}, {"name":"-", "type":"word"}]}% %b:word%'
+add_rule 'rule=:y %{"type":"alternative", "parser":[{"name":"-", "type":"number"}, {"name":"c", "type":"word"}]}% %d:word%'
+execute 'x 1 q'
+assert_output_json_eq '{ "a": "1", "b": "q" }'
+grep -q "^max result fields.:    2$" stats.out && grep -q "^avg result fields.:    2.0$" stats.out || {
+	echo "unexpected result field count:"
+	cat stats.out
+	exit 1
+}
+
+rm -f stats.out
+cleanup_tmp_files
@@ -0,0 +1,36 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks that cached timestamps are only reused when they would also
+# be parsed from the actual message.
+
+. $srcdir/exec.sh
+
+test_def $0 "timestamp parse cache of date parsers"
+add_rule 'version=2'
+add_rule 'rule=:5424 %{"type":"date-rfc5424", "name":"ts", "format":"timestamp-unix"}% end'
+add_rule 'rule=:3164 %ts:date-rfc3164% end'
+cat > tmp.in <<'END'
+5424 2000-03-11T14:15:16+01:00 end
+5424 2000-03-11T14:15:16+01:00 end
+5424 2000-03-11T14:15:16+01:001 end
+5424 2000-03-11T14:15:16+01:0 end
+3164 Oct 29 09:47:08 end
+3164 Oct 29 09:47:08 end
+3164 Oct 29 09:47:08: end
+3164 Oct 29 09:47:081 end
+3164 Oct 29 09:47:08: end
+END
+execute file tmp.in
+assert_line_json_eq 1 '{"ts": 952780516}'
+assert_line_json_eq 2 '{"ts": 952780516}'
+assert_line_json_eq 3 '{"ts": 952780456}'
+assert_line_json_eq 4 '{"ts": 952780516}'
+assert_line_json_eq 5 '{"ts": "Oct 29 09:47:08"}'
+assert_line_json_eq 6 '{"ts": "Oct 29 09:47:08"}'
+assert_line_json_eq 7 '{"ts": "Oct 29 09:47:08:"}'
+assert_line_json_eq 8 '{ "originalmsg": "3164 Oct 29 09:47:081 end", "unparsed-data": "Oct 29 09:47:081 end" }'
+assert_line_json_eq 9 '{"ts": "Oct 29 09:47:08:"}'
+
+rm -f tmp.in
+cleanup_tmp_files
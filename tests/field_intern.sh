@@ -0,0 +1,32 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks that fields with "intern" set produce the same output as
+# regular ones and that recurring values share one table entry.
+export ln_opts='-sstats.out'
+. $srcdir/exec.sh
+
+test_def $0 "interned field values"
+add_rule 'version=2'
+add_rule 'rule=:%{"type":"word", "name":"proto", "intern":true}% %{"type":"name-value-list", "name":"nv", "intern":true}%'
+add_rule 'rule=:x %{"type":"word", "name":"proto", "intern":true}% %-:word% %{"type":"rest", "name":"msg", "intern":false}%'
+cat > tmp.in <<'END'
+tcp action=accept iface=eth0
+udp action=deny iface=eth0
+tcp action=accept iface=eth1
+x tcp y some message
+END
+execute file tmp.in
+assert_line_json_eq 1 '{ "proto": "tcp", "nv": { "action": "accept", "iface": "eth0" } }'
+assert_line_json_eq 2 '{ "proto": "udp", "nv": { "action": "deny", "iface": "eth0" } }'
+assert_line_json_eq 3 '{ "proto": "tcp", "nv": { "action": "accept", "iface": "eth1" } }'
+assert_line_json_eq 4 '{ "proto": "tcp", "msg": "some message" }'
+# tcp, udp, accept, deny, eth0, eth1
+grep -q "^interned values...:    6$" stats.out || {
+	echo "unexpected number of interned values:"
+	cat stats.out
+	exit 1
+}
+
+rm -f tmp.in stats.out
+cleanup_tmp_files
@@ -0,0 +1,51 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+. $srcdir/exec.sh
+
+test_def $0 "JSON field in raw format"
+add_rule 'version=2'
+add_rule 'rule=:%{"type":"json", "name":"field", "format":"raw"}%'
+add_rule 'rule=:begin %{"type":"json", "name":"field", "format":"raw"}%end'
+
+execute '{"f1": "1", "f2": [2, 3.5e2, true, null, {"f3": "\"x\u00e4"}]}'
+assert_output_json_eq '{ "field": "{\"f1\": \"1\", \"f2\": [2, 3.5e2, true, null, {\"f3\": \"\\\"x\\u00e4\"}]}" }'
+
+# trailing whitespace is consumed, but not part of the value
+execute 'begin {"f1": "1", "f2": 2}   end'
+assert_output_json_eq '{ "field": "{\"f1\": \"1\", \"f2\": 2}" }'
+
+#check cases where parsing failure must occur
+execute '{"f1": "1", f2: 2}'
+assert_output_json_eq '{ "originalmsg": "{\"f1\": \"1\", f2: 2}", "unparsed-data": "{\"f1\": \"1\", f2: 2}" }'
+execute '{"f1": "1"'
+assert_output_json_eq '{ "originalmsg": "{\"f1\": \"1\"", "unparsed-data": "{\"f1\": \"1\"" }'
+execute '{"f1": 01x}'
+assert_output_json_eq '{ "originalmsg": "{\"f1\": 01x}", "unparsed-data": "{\"f1\": 01x}" }'
+
+# cee-syslog supports the same format
+reset_rules
+add_rule 'version=2'
+add_rule 'rule=:%{"type":"cee-syslog", "name":"field", "format":"raw"}%'
+execute '@cee: {"f1": "1", "f2": 2} '
+assert_output_json_eq '{ "field": "{\"f1\": \"1\", \"f2\": 2}" }'
+execute '@cee: {"f1": "1", "f2": 2} data'
+assert_output_json_eq '{ "originalmsg": "@cee: {\"f1\": \"1\", \"f2\": 2} data", "unparsed-data": "@cee: {\"f1\": \"1\", \"f2\": 2} data" }'
+
+# the regular object format must work for many messages, including
+# after a parse failure, as the tokenizer is reused
+reset_rules
+add_rule 'version=2'
+add_rule 'rule=:%field:json%'
+cat > tmp.in <<'END'
+{"f1": "1"}
+{"f1": "1", f2: 2}
+{"f1": "2"}
+END
+execute file tmp.in
+./json_eq '{ "field": { "f1": "1" } }' "$(sed -n 1p test.out)"
+./json_eq '{ "originalmsg": "{\"f1\": \"1\", f2: 2}", "unparsed-data": "{\"f1\": \"1\", f2: 2}" }' "$(sed -n 2p test.out)"
+./json_eq '{ "field": { "f1": "2" } }' "$(sed -n 3p test.out)"
+
+rm -f tmp.in
+cleanup_tmp_files
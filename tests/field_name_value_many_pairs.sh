@@ -0,0 +1,40 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks key-value lists with many pairs, long names and escapes
+. $srcdir/exec.sh
+
+test_def $0 "name/value parser with many pairs"
+add_rule 'version=2'
+add_rule 'rule=:%f:name-value-list%'
+
+msg=""
+expected=""
+for i in $(seq 1 40); do
+    msg="$msg n$i=v$i"
+    expected="$expected, \"n$i\": \"v$i\""
+done
+longname=$(printf 'x%.0s' $(seq 1 200))
+execute "${msg# } $longname=long q=\"a \\\"quoted\\\" value\""
+assert_output_json_eq "{ \"f\": { ${expected#, }, \"$longname\": \"long\", \"q\": \"a \\\\\\\"quoted\\\\\\\" value\" } }"
+
+reset_rules
+add_rule 'version=2'
+add_rule 'rule=:%{"name":"f", "type":"name-value-list", "separator":",", "assignator":":"}%'
+execute 'a b:1 2,c:x\,y,,d:'
+assert_output_json_eq '{ "f": { "a b": "1 2", "c": "x\\,y", "d": "" } }'
+
+reset_rules
+add_rule 'version=2'
+add_rule 'rule=:%f:cef%'
+msg=""
+expected=""
+for i in $(seq 1 40); do
+    msg="$msg e$i=value $i"
+    expected="$expected, \"e$i\": \"value $i\""
+done
+execute "CEF:0|V|P|1|S|N|5|$msg"
+assert_output_json_eq "{ \"f\": { \"Extensions\": { ${expected#, } } } }"
+
+
+cleanup_tmp_files
@@ -0,0 +1,49 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks that with a field projection only the wanted fields are
+# extracted, while matching (including user-defined types and repeat
+# without values) stays the same.
+export ln_opts='-kw,s,k1'
+. $srcdir/exec.sh
+
+# json_eq only checks the expected fields, so check that the others
+# are absent, too
+assert_line_lacks() {
+	for f in ${@:2}; do
+		if sed -n "$1p" test.out | grep -q "\"$f\""; then
+			echo "line $1: unexpected field $f"
+			exit 1
+		fi
+	done
+}
+
+test_def $0 "field projection"
+add_rule 'version=2'
+add_rule 'type=@pair:%a:number%-%b:number%'
+add_rule 'rule=:a %w:word% %n:number% %p:@pair% %r:repeat{"parser":{"type":"@pair","name":"x"},"while":{"type":"literal","text":","}}% %s:rest%'
+add_rule 'rule=:b %.:name-value-list%'
+add_rule 'rule=:c %w:word% %p:@pair%'
+cat > tmp.in <<'END'
+a word 42 1-2 3-4,5-6 the rest
+b k1=v1 k2=v2
+c word 1-x
+a word 42 1-2 3-4,5-x the rest
+END
+execute file tmp.in
+assert_line_json_eq 1 '{ "w": "word", "s": "the rest" }'
+assert_line_lacks 1 n p r a b x
+assert_line_json_eq 2 '{ "k1": "v1", "k2": "v2" }'
+assert_line_json_eq 3 '{ "originalmsg": "c word 1-x", "unparsed-data": "1-x" }'
+assert_line_json_eq 4 '{ "originalmsg": "a word 42 1-2 3-4,5-x the rest", "unparsed-data": "3-4,5-x the rest" }'
+
+# same via the record API
+export ln_opts='-kw,s,k1 -ouseRecord'
+execute file tmp.in
+assert_line_json_eq 1 '{ "w": "word", "s": "the rest" }'
+assert_line_lacks 1 n p r a b x
+assert_line_json_eq 2 '{ "k1": "v1", "k2": "v2" }'
+assert_line_json_eq 3 '{ "originalmsg": "c word 1-x", "unparsed-data": "1-x" }'
+
+rm -f tmp.in
+cleanup_tmp_files
@@ -0,0 +1,40 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks the execution path profile in folded-stack format
+. $srcdir/exec.sh
+
+test_def $0 "execution paths as folded stacks"
+add_rule 'version=2'
+add_rule 'type=@port:port %p:number%'
+add_rule 'rule=:a %w:word% x'
+add_rule 'rule=:a %n:number% y'
+add_rule 'rule=:b %x:@port%'
+cat > tmp.in <<'END'
+a 1 y
+a foo x
+a 2 x
+b port 7
+zz
+END
+$cmd -r tmp.rulebase -e json -f folded.out < tmp.in > test.out
+echo "Out:"; cat folded.out
+cat > expected.out <<'END'
+'a ' 5
+'a ';%n:number% [backtracked 1] 3
+'a ';%n:number% [backtracked 1];' y' 2
+'a ';%w:word% 2
+'a ';%w:word%;' x' 2
+'b ' 2
+'b ';%x:@port% 1
+'b ';%x:@port%;'port ' 1
+'b ';%x:@port%;'port ';%p:number% 1
+END
+if ! cmp -s expected.out folded.out; then
+	echo "FAIL: unexpected folded stacks, diff:"
+	diff expected.out folded.out
+	exit 1
+fi
+
+rm -f tmp.in folded.out expected.out
+cleanup_tmp_files
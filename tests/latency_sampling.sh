@@ -0,0 +1,57 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks sampled per-rule latency (ln_setLatencySampling)
+. $srcdir/exec.sh
+
+test_def $0 "sampled per-rule latency"
+add_rule 'version=2'
+add_rule 'rule=:%d:date-rfc3164% a %w:word%'
+add_rule 'rule=id=17:b %w:word%'
+cat > tmp.in <<'END'
+Oct 18 10:00:01 a x
+b y
+b z
+zzz
+END
+
+# check samples and p50 <= p99 <= max for one line of the -s output
+check_latency() {
+	line=$(grep " $2\$" stats.out)
+	if [ "x$line" == "x" ]; then
+		echo "FAIL: no latency line for '$2'"
+		cat stats.out
+		exit 1
+	fi
+	echo "$line" | awk -v samples=$1 '
+		$1 != samples || $2 > $3 || $3 > $4 || $4 == 0 { exit 1 }' || {
+		echo "FAIL: unexpected latency line: $line (expected $1 samples)"
+		exit 1
+	}
+}
+
+# with -s, all messages are timed
+$cmd -r tmp.rulebase -e json -s stats.out < tmp.in > test.out
+grep -q "^sampling\.*: every 1 message(s)$" stats.out || {
+	echo "FAIL: sampling interval missing"; cat stats.out; exit 1; }
+check_latency 2 "17 (tmp.rulebase:3)"
+check_latency 1 "(tmp.rulebase:2)"
+check_latency 1 "unparsed"
+
+# every 2nd message: "b y" and "zzz"
+$cmd -r tmp.rulebase -e json -s stats.out -l2 < tmp.in > test.out
+check_latency 1 "17 (tmp.rulebase:3)"
+check_latency 1 "unparsed"
+if grep -q "(tmp.rulebase:2)$" stats.out; then
+	echo "FAIL: rule 2 must not have been sampled"; cat stats.out; exit 1
+fi
+
+# json snapshot, latency values vary, so only samples are checked
+$cmd -r tmp.rulebase -e json -j telemetry.out -l1 < tmp.in > test.out
+echo "Out:"; cat telemetry.out
+grep -q '"sampling": 1, "unparsed": { "samples": 1,' telemetry.out &&
+grep -q '"17": { "samples": 2,.* "line": 3 }' telemetry.out || {
+	echo "FAIL: unexpected latency in telemetry snapshot"; exit 1; }
+
+rm -f tmp.in stats.out telemetry.out
+cleanup_tmp_files
@@ -0,0 +1,67 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks that normalizing via the flat result record (ln_normalizeRecord)
+# and converting it to json gives the same events as ln_normalize.
+export ln_opts='-ouseRecord -oaddRule'
+. $srcdir/exec.sh
+
+test_def $0 "flat result record API"
+add_rule 'version=2'
+add_rule 'type=@pair:%a:number%-%b:number%'
+add_rule 'type=@wrap:(%..:number%)'
+add_rule 'rule=t1,t2:a %w:word% %n:number{"format":"number"}% %f:float{"format":"number"}% %-:word% %s:rest%'
+add_rule 'rule=:p %p:@pair% %.:name-value-list%'
+add_rule 'rule=:w %x:@wrap% %r:repeat{"parser":{"type":"number","name":"."},"while":{"type":"literal","text":","}}%'
+add_rule 'rule=:m %.:@pair% %ip:ipv4%'
+add_rule 'annotate=t1:+annot="yes"'
+cat > tmp.in <<'END'
+a word 42 1.5 skipped the rest
+p 1-2 k1=v1 k2=v2
+w (7) 1,2,3
+m 3-4 10.0.0.1
+a word x unparsed
+END
+execute file tmp.in
+assert_line_json_eq 1 '{ "w": "word", "n": 42, "f": 1.5, "s": "the rest", "annot": "yes", "metadata": { "rule": { "mockup": "a %w:word% %n:number% %f:float% %-:word% %s:rest%" } } }'
+assert_line_json_eq 2 '{ "p": { "a": "1", "b": "2" }, "k1": "v1", "k2": "v2", "metadata": { "rule": { "mockup": "p %p:USER-DEFINED% %.:name-value-list%%a:number%-%b:number%" } } }'
+assert_line_json_eq 3 '{ "x": "7", "r": [ "1", "2", "3" ], "metadata": { "rule": { "mockup": "w %x:USER-DEFINED% %r:repeat%%.:number%,%.:number%,%.:number%(%..:number%)" } } }'
+assert_line_json_eq 4 '{ "a": "3", "b": "4", "ip": "10.0.0.1", "metadata": { "rule": { "mockup": "m %.:USER-DEFINED% %ip:ipv4%%a:number%-%b:number%" } } }'
+assert_line_json_eq 5 '{ "originalmsg": "a word x unparsed", "unparsed-data": "x unparsed" }'
+
+# the regular API must create exactly the same events
+mv test.out record.out
+export ln_opts='-oaddRule'
+execute file tmp.in
+# json_eq only checks the fields of its first argument, so compare both ways
+for i in 1 2 3 4 5; do
+	./json_eq "$(sed -n "${i}p" test.out)" "$(sed -n "${i}p" record.out)"
+	./json_eq "$(sed -n "${i}p" record.out)" "$(sed -n "${i}p" test.out)"
+done
+
+# member names of "." merges are kept in the record's arena; use more
+# than one arena block (4096 bytes) of them, twice, so that kept blocks
+# are reused
+reset_rules
+add_rule 'version=2'
+add_rule 'rule=:%.:name-value-list%'
+msg=""
+expected=""
+for i in $(seq 100); do
+	key=$(printf "key%03d_%050d" $i 0)
+	msg="$msg $key=v$i"
+	expected="$expected, \"$key\": \"v$i\""
+done
+expected="{ ${expected#, } }"
+printf "%s\n%s\n" "${msg# }" "${msg# }" > tmp.in
+for mode in useRecord useCallback; do
+	export ln_opts="-o$mode"
+	execute file tmp.in
+	for i in 1 2; do
+		./json_eq "$expected" "$(sed -n "${i}p" test.out)"
+		./json_eq "$(sed -n "${i}p" test.out)" "$expected"
+	done
+done
+
+rm -f tmp.in record.out
+cleanup_tmp_files
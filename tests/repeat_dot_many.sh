@@ -0,0 +1,43 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+
+. $srcdir/exec.sh
+
+test_def $0 "repeat with dot name and many elements"
+add_rule 'version=2'
+add_rule 'rule=:a %{"name":"numbers", "type":"repeat",
+			"parser":
+			  {"name":".", "type":"number"},
+			"while":
+			  {"type":"literal", "text":", "}
+       		   }% b %w:word%
+'
+add_rule 'rule=:c %{"name":"pairs", "type":"repeat",
+			"parser":[
+			  {"name":"n1", "type":"number"},
+			  {"type":"literal", "text":":"},
+			  {"name":"n2", "type":"number"}
+			  ],
+			"while":[
+			  {"type":"literal", "text":","}
+			]
+       		   }% d
+'
+msg="a 0"
+expected='"0"'
+for i in $(seq 1 59); do
+	msg="$msg, $i"
+	expected="$expected, \"$i\""
+done
+execute "$msg b test"
+assert_output_json_eq "{ \"w\": \"test\", \"numbers\": [ $expected ] }"
+
+# literal "while" must not match partially at end of input
+execute 'c 1:2,3:4,5:6 d'
+assert_output_json_eq '{ "pairs": [ { "n2": "2", "n1": "1" }, { "n2": "4", "n1": "3" }, { "n2": "6", "n1": "5" } ] }'
+
+execute 'c 1:2,3:4,'
+assert_output_json_eq '{ "originalmsg": "c 1:2,3:4,", "unparsed-data": "1:2,3:4," }'
+
+cleanup_tmp_files
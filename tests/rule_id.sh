@@ -0,0 +1,70 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks numeric rule ids: explicit ones from the tag list and ones
+# derived from the match description. Derived ids must never change,
+# as consumers store them, so the expected values are fixed here.
+export ln_opts='-oaddRuleID'
+. $srcdir/exec.sh
+
+test_def $0 "rule ids"
+add_rule 'version=2'
+add_rule 'rule=id=17,t1:a %w:word%'
+add_rule 'rule=t2:b %w:word%'
+add_rule 'rule=t3,id=5:c %w:word%'
+cat > tmp.in <<'END'
+a x
+b y
+c z
+d
+END
+execute file tmp.in
+assert_line_json_eq 1 '{ "w": "x", "metadata": { "rule": { "id": 17 } } }'
+assert_line_json_eq 2 '{ "w": "y", "metadata": { "rule": { "id": 3004003390 } } }'
+assert_line_json_eq 3 '{ "w": "z", "metadata": { "rule": { "id": 5 } } }'
+assert_line_json_eq 4 '{ "originalmsg": "d", "unparsed-data": "d" }'
+
+# the id entry is not a tag
+export ln_opts='-oaddRuleID -T'
+execute file tmp.in
+assert_line_json_eq 1 '{ "w": "x", "event.tags": [ "t1" ], "metadata": { "rule": { "id": 17 } } }'
+
+# same via the record API
+export ln_opts='-oaddRuleID -ouseRecord'
+execute file tmp.in
+assert_line_json_eq 2 '{ "w": "y", "metadata": { "rule": { "id": 3004003390 } } }'
+
+# an "id=" entry that is not a number is a regular tag
+reset_rules
+add_rule 'version=2'
+add_rule 'rule=t,id=x:a %w:word%'
+export ln_opts='-T'
+execute 'a x'
+assert_output_json_eq '{ "w": "x", "event.tags": [ "t", "id=x" ] }'
+
+# duplicate explicit ids are reported, colliding derived ids are probed;
+# the two "k..." match descriptions have the same 31-bit FNV hash
+reset_rules
+add_rule 'version=2'
+add_rule 'rule=id=7:a %w:word%'
+add_rule 'rule=id=7:b %w:word%'
+add_rule 'rule=:k32728 %w:word%'
+add_rule 'rule=:k261234 %w:word%'
+cat > tmp.in <<'END'
+a x
+b y
+k32728 z
+k261234 z
+END
+export ln_opts='-oaddRuleID'
+$cmd $ln_opts -r tmp.rulebase -e json < tmp.in > test.out 2> test.err
+cat test.out test.err
+grep -F "rule id 7 is already used by the rule at tmp.rulebase:2" test.err
+grep -F "derived rule id 2587607555 collides with the rule at tmp.rulebase:4, using 2587607556 instead" test.err
+assert_line_json_eq 1 '{ "w": "x", "metadata": { "rule": { "id": 7 } } }'
+assert_line_json_eq 2 '{ "w": "y", "metadata": { "rule": { "id": 7 } } }'
+assert_line_json_eq 3 '{ "w": "z", "metadata": { "rule": { "id": 2587607555 } } }'
+assert_line_json_eq 4 '{ "w": "z", "metadata": { "rule": { "id": 2587607556 } } }'
+
+rm -f tmp.in test.err
+cleanup_tmp_files
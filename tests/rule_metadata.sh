@@ -0,0 +1,49 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks rule mockup and location metadata, which are precomputed
+# per rule, also when user-defined types and repeat add nested parts.
+export ln_opts='-oaddRule -oaddRuleLocation'
+. $srcdir/exec.sh
+
+test_def $0 "rule metadata"
+add_rule 'version=2'
+add_rule 'type=@pair:%a:number%-%b:number%'
+add_rule 'rule=:a %b:word% c'
+add_rule 'rule=:a %b:number% d'
+add_rule 'rule=:x %v:@pair% y'
+add_rule 'rule=:r %r:repeat{"parser":{"type":"number","name":"."},"while":{"type":"literal","text":","}}%'
+cat > tmp.in <<'END'
+a x c
+a 1 d
+a y c
+x 1-2 y
+r 1,2
+END
+execute file tmp.in
+assert_line_json_eq 1 '{ "b": "x", "metadata": { "rule": { "mockup": "a %b:word% c", "location": { "file": "tmp.rulebase", "line": 3 } } } }'
+assert_line_json_eq 2 '{ "b": "1", "metadata": { "rule": { "mockup": "a %b:number% d", "location": { "file": "tmp.rulebase", "line": 4 } } } }'
+assert_line_json_eq 3 '{ "b": "y", "metadata": { "rule": { "mockup": "a %b:word% c", "location": { "file": "tmp.rulebase", "line": 3 } } } }'
+assert_line_json_eq 4 '{ "v": { "b": "2", "a": "1" }, "metadata": { "rule": { "mockup": "x %v:USER-DEFINED% y%a:number%-%b:number%", "location": { "file": "tmp.rulebase", "line": 5 } } } }'
+assert_line_json_eq 5 '{ "r": [ "1", "2" ], "metadata": { "rule": { "mockup": "r %r:repeat%%.:number%,%.:number%", "location": { "file": "tmp.rulebase", "line": 6 } } } }'
+
+# branches of alternative share the following node, so the mockup
+# depends on the branch taken
+reset_rules
+add_rule 'version=2'
+add_rule 'rule=:a %{"type":"alternative", "parser":[{"name":"num", "type":"number"}, {"name":"hex", "type":"hexnumber"}]}% b'
+add_rule 'rule=:x %{"type":"alternative", "parser":[{"name":"n", "type":"number"}, {"name":"w", "type":"word"}]}% %{"type":"alternative", "parser":[{"name":"m", "type":"number"}, {"name":"v", "type":"word"}]}% y'
+cat > tmp.in <<'END'
+a 12 b
+a 0x1f b
+x 1 q y
+x q 2 y
+END
+execute file tmp.in
+assert_line_json_eq 1 '{ "num": "12", "metadata": { "rule": { "mockup": "a %num:number% b", "location": { "file": "tmp.rulebase", "line": 2 } } } }'
+assert_line_json_eq 2 '{ "hex": "0x1f", "metadata": { "rule": { "mockup": "a %hex:hexnumber% b", "location": { "file": "tmp.rulebase", "line": 2 } } } }'
+assert_line_json_eq 3 '{ "n": "1", "v": "q", "metadata": { "rule": { "mockup": "x %n:number% %v:word% y", "location": { "file": "tmp.rulebase", "line": 3 } } } }'
+assert_line_json_eq 4 '{ "w": "q", "m": "2", "metadata": { "rule": { "mockup": "x %w:word% %m:number% y", "location": { "file": "tmp.rulebase", "line": 3 } } } }'
+
+rm -f tmp.in
+cleanup_tmp_files
@@ -0,0 +1,37 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks the runtime telemetry snapshot (ln_telemetrySnapshot)
+. $srcdir/exec.sh
+
+test_def $0 "runtime telemetry"
+add_rule 'version=2'
+add_rule 'rule=:%d:date-rfc3164% a %w:word%'
+add_rule 'rule=:%d:date-rfc3164% %h:word% y'
+cat > tmp.in <<'END'
+Oct 18 10:00:01 a x
+Oct 18 10:00:01 b y
+zzz
+END
+$cmd -r tmp.rulebase -e json -j telemetry.out < tmp.in > test.out
+echo "Out:"; cat test.out; cat telemetry.out
+./json_eq '{ "messages": 3, "parsed": 2, "unparsed": 1,
+	"parser_calls": { "total": 10, "success": 8 },
+	"parsers": {
+		"literal": { "called": 5, "success": 4 },
+		"date-rfc3164": { "called": 3, "success": 2 },
+		"word": { "called": 2, "success": 2 } },
+	"tscache": { "lookups": 3, "hits": 1 },
+	"budget_exceeded": { "parser_calls": 0, "backtracks": 0, "bytes": 0, "deadline": 0 },
+	"histograms": {
+		"path_length": { "max": 5, "counts": { "1": 1, "5": 2 } },
+		"backtracked": { "max": 0, "counts": { "0": 3 } },
+		"parser_calls": { "max": 5, "counts": { "1": 1, "4": 1, "5": 1 } },
+		"literal_parser_calls": { "max": 3, "counts": { "0": 1, "2": 1, "3": 1 } } },
+	"latency": { "sampling": 0,
+		"unparsed": { "samples": 0, "p50_ns": 0, "p99_ns": 0, "max_ns": 0 },
+		"rules": { } } }' \
+	"$(cat telemetry.out)"
+
+rm -f tmp.in telemetry.out
+cleanup_tmp_files
@@ -0,0 +1,58 @@
+#!/bin/bash
+# added 2026-10-18 by agent
+# This file is part of the liblognorm project, released under ASL 2.0
+# checks that messages exceeding the work budget are aborted as
+# unparsed, flagged in metadata and counted in telemetry
+. $srcdir/exec.sh
+
+test_def $0 "work budget"
+add_rule 'version=2'
+add_rule 'rule=:%a:word% %b:word% x'
+add_rule 'rule=:%a:number% %b:number% y'
+add_rule 'rule=:%a:char-to: % %b:char-to: % z'
+cat > tmp.in <<'END'
+1 2 y
+1 2 z
+END
+
+# without budget, the last rule matches after backtracking
+$cmd -r tmp.rulebase -e json < tmp.in > test.out
+echo "Out:"; cat test.out
+assert_line_json_eq 1 '{ "a": "1", "b": "2" }'
+assert_line_json_eq 2 '{ "a": "1", "b": "2" }'
+
+# cheap messages pass, expensive ones are aborted
+$cmd -r tmp.rulebase -e json -b5 -j telemetry.out < tmp.in > test.out
+echo "Out:"; cat test.out
+assert_line_json_eq 1 '{ "a": "1", "b": "2" }'
+assert_line_json_eq 2 '{ "originalmsg": "1 2 z", "unparsed-data": " z",
+	"metadata": { "budget-exceeded": "parser_calls" } }'
+./json_eq '{ "parser_calls": 1, "backtracks": 0, "bytes": 0, "deadline": 0 }' \
+	"$(sed 's/.*"budget_exceeded": *\({[^}]*}\).*/\1/' telemetry.out)"
+
+$cmd -r tmp.rulebase -e json -b0,1 < tmp.in > test.out
+echo "Out:"; cat test.out
+assert_line_json_eq 2 '{ "originalmsg": "1 2 z", "unparsed-data": " z",
+	"metadata": { "budget-exceeded": "backtracks" } }'
+
+# also via the record API; the match of "1 2 y" takes exactly 5 bytes,
+# which is within a budget of 5, but not of 4
+$cmd -r tmp.rulebase -e json -b0,0,5 -ouseRecord < tmp.in > test.out
+echo "Out:"; cat test.out
+assert_line_json_eq 1 '{ "a": "1", "b": "2" }'
+assert_line_json_eq 2 '{ "originalmsg": "1 2 z", "unparsed-data": " z",
+	"metadata": { "budget-exceeded": "bytes" } }'
+
+# the budget is checked again before a terminal is accepted
+$cmd -r tmp.rulebase -e json -b0,0,4 -ouseRecord < tmp.in > test.out
+echo "Out:"; cat test.out
+assert_line_json_eq 1 '{ "originalmsg": "1 2 y", "unparsed-data": "",
+	"metadata": { "budget-exceeded": "bytes" } }'
+
+# a generous deadline does not change the result
+$cmd -r tmp.rulebase -e json -b0,0,0,10000000 < tmp.in > test.out
+echo "Out:"; cat test.out
+assert_line_json_eq 2 '{ "a": "1", "b": "2" }'
+
+rm -f tmp.in telemetry.out
+cleanup_tmp_files